@@ -1,12 +1,17 @@
 #version 410
 
+// Defined to 1 by the program variant using the normal map.
+#ifndef NORMAL_MAP
+#define NORMAL_MAP 0
+#endif
+
+#include "common/normal_map.glsl"
+#include "common/shared_uniforms.glsl"
+
 uniform samplerCube cube_map;
 uniform sampler2D sphere_texture;
 uniform sampler2D specular_map;
 uniform sampler2D normal_map;
-uniform bool use_normal_mapping;
-uniform vec3 light_position;
-uniform vec3 camera_position;
 uniform vec3 ambient;
 uniform vec3 diffuse;
 uniform vec3 specular;
@@ -28,18 +33,16 @@ void main()
     vec3 texture_rgb = vec3(texture_rgba.x, texture_rgba.y, texture_rgba.z);
     vec4 specular_rgba = texture(specular_map, fs_in.texcoords);
     vec3 specular_rgb = vec3(specular_rgba.x, specular_rgba.y, specular_rgba.z);
-    vec4 normal_rgba = texture(normal_map, fs_in.texcoords);
-    vec3 normal_rgb = vec3(normal_rgba.x, normal_rgba.y, normal_rgba.z);
+    vec3 normal_rgb = decode_normal_map(texture(normal_map, fs_in.texcoords));
     
     vec3 ambient_color = ambient;
 
     mat3 tbn = mat3(fs_in.tangent, fs_in.binormal, fs_in.normal);
-    normal_rgb = normal_rgb*2 - vec3(1,1,1);
 
     vec3 new_normal = fs_in.normal;
-    if(use_normal_mapping){
-        new_normal = tbn * normal_rgb; 
-    }
+#if NORMAL_MAP
+    new_normal = tbn * normal_rgb; 
+#endif
 
     vec3 L = normalize(light_position - fs_in.vertex);
     vec3 diffuse_color = texture_rgb * 
@@ -8,7 +8,8 @@ layout (location = 4) in vec3 binormal;
 
 uniform mat4 vertex_model_to_world;
 uniform mat4 normal_model_to_world;
-uniform mat4 vertex_world_to_clip;
+
+#include "common/shared_uniforms.glsl"
 
 out VS_OUT {
 	vec3 vertex;
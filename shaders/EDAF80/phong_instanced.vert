@@ -0,0 +1,33 @@
+#version 410
+
+layout (location = 0) in vec3 vertex;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec3 texcoords;
+layout (location = 3) in vec3 tangent;
+layout (location = 4) in vec3 binormal;
+
+// Per-instance attributes; each matrix takes up four locations.
+layout (location = 5) in mat4 vertex_model_to_world;
+layout (location = 9) in mat4 normal_model_to_world;
+
+#include "common/shared_uniforms.glsl"
+
+out VS_OUT {
+	vec3 vertex;
+	vec3 normal;
+	vec2 texcoords;
+	vec3 tangent;
+	vec3 binormal;
+} vs_out;
+
+
+void main()
+{
+	vs_out.vertex = vec3(vertex_model_to_world * vec4(vertex, 1.0));
+	vs_out.normal = vec3(normal_model_to_world * vec4(normal, 0.0));
+	vs_out.tangent = vec3(normal_model_to_world * vec4(tangent, 0.0));
+	vs_out.binormal = vec3(normal_model_to_world * vec4(binormal, 0.0));
+	vs_out.texcoords = vec2(texcoords.x, texcoords.y);
+
+	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
+}
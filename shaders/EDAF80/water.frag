@@ -1,6 +1,8 @@
 #version 410
 
-uniform vec3 camera_position;
+#include "common/normal_map.glsl"
+#include "common/shared_uniforms.glsl"
+
 uniform samplerCube skybox_texture;
 uniform sampler2D normal_map;
 
@@ -21,9 +23,9 @@ void main()
     bool use_normal_mapping = true;
 
     vec3 V = normalize(camera_position - fs_in.vertex);
-    vec3 normal_rgba0 = texture(normal_map, fs_in.normal_coord0).xyz*2 - 1;
-    vec3 normal_rgba1 = texture(normal_map, fs_in.normal_coord1).xyz*2 - 1;
-    vec3 normal_rgba2 = texture(normal_map, fs_in.normal_coord2).xyz*2 - 1;
+    vec3 normal_rgba0 = decode_normal_map(texture(normal_map, fs_in.normal_coord0));
+    vec3 normal_rgba1 = decode_normal_map(texture(normal_map, fs_in.normal_coord1));
+    vec3 normal_rgba2 = decode_normal_map(texture(normal_map, fs_in.normal_coord2));
     vec3 normal_bump = normalize(normal_rgba0 + normal_rgba1 + normal_rgba2);
 
     vec3 new_normal = fs_in.normal;
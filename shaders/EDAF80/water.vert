@@ -5,8 +5,8 @@ layout (location = 2) in vec2 texcoords;
 
 uniform mat4 vertex_model_to_world;
 uniform mat4 normal_model_to_world;
-uniform mat4 vertex_world_to_clip;
-uniform float elapsed_time_s;
+
+#include "common/shared_uniforms.glsl"
 
 out VS_OUT {
 	vec3 vertex;
@@ -2,9 +2,10 @@
 
 uniform sampler2D depth_texture;
 uniform sampler2D normal_texture;
-uniform sampler2DShadow shadow_texture;
+uniform sampler2DArrayShadow shadow_texture; // One layer per shadowed light
 
 uniform vec2 inv_res;
+uniform bool use_compact_gbuffer;
 
 uniform mat4 view_projection_inverse;
 uniform vec3 camera_position;
@@ -12,18 +13,83 @@ uniform mat4 shadow_view_projection;
 
 uniform vec3 light_color;
 uniform vec3 light_position;
-uniform vec3 light_direction;
+uniform vec3 light_direction; // direction of the cone
 uniform float light_intensity;
-uniform float light_angle_falloff;
+uniform float light_angle_falloff; // half-angle at which the light starts fading out
+uniform float light_cone_angle;    // half-angle at which the light is fully faded out
+uniform float light_range;
+uniform float shininess;
 
 uniform vec2 shadowmap_texel_size;
+uniform int shadowmap_layer; // layer of |shadow_texture| holding the shadow map of this light
+
+#include "common/octahedral.glsl"
 
 layout (location = 0) out vec4 light_diffuse_contribution;
 layout (location = 1) out vec4 light_specular_contribution;
 
 
+// Decode the world-space normal stored in the G-buffer at |pixel|; with
+// the compact G-buffer, it is octahedron-encoded in the first two
+// components.
+vec3 fetch_normal(ivec2 pixel)
+{
+	vec4 encoded = texelFetch(normal_texture, pixel, 0) * 2.0 - 1.0;
+	if (!use_compact_gbuffer)
+		return normalize(encoded.xyz);
+	return octahedral_decode(encoded.xy);
+}
+
+// Fraction of the 3x3 texels around |position| in the shadow map of this
+// light which |position| is closer to the light than.
+float shadow_factor(vec3 position)
+{
+	vec4 shadow_position = shadow_view_projection * vec4(position, 1.0);
+	vec3 coords = shadow_position.xyz / shadow_position.w * 0.5 + 0.5;
+	if (any(lessThan(coords, vec3(0.0))) || any(greaterThan(coords, vec3(1.0))))
+		return 1.0;
+
+	float lit = 0.0;
+	for (int y = -1; y <= 1; ++y)
+		for (int x = -1; x <= 1; ++x)
+			lit += texture(shadow_texture, vec4(coords.xy + vec2(x, y) * shadowmap_texel_size, float(shadowmap_layer), coords.z - 0.0001));
+	return lit / 9.0;
+}
+
+// Shades the pixels covered by the cone of a single light, with the same
+// lighting model as EDAN35/shade_tiled_lights.frag.
 void main()
 {
 	light_diffuse_contribution  = vec4(0.0, 0.0, 0.0, 1.0);
 	light_specular_contribution = vec4(0.0, 0.0, 0.0, 1.0);
+
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(depth_texture, pixel, 0).r;
+	if (depth >= 1.0)
+		return;
+
+	vec4 world_position = view_projection_inverse * vec4(vec3(gl_FragCoord.xy * inv_res, depth) * 2.0 - 1.0, 1.0);
+	vec3 position = world_position.xyz / world_position.w;
+
+	vec3 to_light = light_position - position;
+	float distance_squared = dot(to_light, to_light);
+	if (distance_squared >= light_range * light_range)
+		return;
+	float light_distance = sqrt(distance_squared);
+	vec3 to_light_direction = to_light / light_distance;
+
+	// Inverse-square falloff, smoothly windowed to reach zero at the range
+	// of the light, where its cone ends.
+	float window = clamp(1.0 - pow(light_distance / light_range, 4.0), 0.0, 1.0);
+	float distance_falloff = window * window / max(distance_squared, 1.0);
+	float angular_falloff = smoothstep(cos(light_cone_angle), cos(light_angle_falloff),
+	                                   dot(-to_light_direction, light_direction));
+	vec3 radiance = light_color * (light_intensity * distance_falloff * angular_falloff * shadow_factor(position));
+
+	vec3 normal = fetch_normal(pixel);
+	vec3 view_direction = normalize(camera_position - position);
+	float n_dot_l = max(dot(normal, to_light_direction), 0.0);
+	vec3 half_vector = normalize(to_light_direction + view_direction);
+	light_diffuse_contribution.rgb  = radiance * n_dot_l;
+	light_specular_contribution.rgb = radiance * (n_dot_l > 0.0 ? pow(max(dot(normal, half_vector), 0.0), shininess) : 0.0);
 }
@@ -0,0 +1,26 @@
+#version 410
+
+uniform mat4 vertex_model_to_world;
+uniform mat4 vertex_world_to_clip;
+
+layout (location = 0) in vec3 vertex;
+layout (location = 2) in vec3 texcoord;
+
+// Same interface as fill_shadowmap.vert, so that fill_shadowmap.frag can
+// alpha-test the fragments.
+out VS_OUT {
+	vec2 texcoord;
+	flat int opacity_layer;
+} vs_out;
+
+// The G-buffer pass which follows tests for equal depths, so positions
+// have to be computed exactly as in fill_gbuffer.vert.
+invariant gl_Position;
+
+void main()
+{
+	vs_out.texcoord = texcoord.xy;
+	vs_out.opacity_layer = -1;
+
+	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 410
+
+uniform mat4 vertex_world_to_clip;
+
+layout (location = 0) in vec3 vertex;
+layout (location = 2) in vec3 texcoord;
+
+// Per-object attributes, set by `IndirectScene`; the matrix takes up
+// four locations.
+layout (location = 5) in mat4 vertex_model_to_world;
+layout (location = 13) in ivec4 material_layers;
+
+// Same interface as fill_shadowmap_indirect.vert, so that
+// fill_shadowmap_indirect.frag can alpha-test the fragments.
+out VS_OUT {
+	vec2 texcoord;
+	flat int opacity_layer;
+} vs_out;
+
+// The G-buffer pass which follows tests for equal depths, so positions
+// have to be computed exactly as in fill_gbuffer_indirect.vert.
+invariant gl_Position;
+
+void main()
+{
+	vs_out.texcoord = texcoord.xy;
+	vs_out.opacity_layer = material_layers.w;
+
+	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 410
+
+uniform mat4 vertex_model_to_world;
+uniform mat4 vertex_world_to_clip;
+
+// Opaque geometry is not alpha-tested, so only the positions are read.
+layout (location = 0) in vec3 vertex;
+
+// The G-buffer pass which follows tests for equal depths, so positions
+// have to be computed exactly as in fill_gbuffer.vert.
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
+}
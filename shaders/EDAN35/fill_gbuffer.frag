@@ -9,6 +9,10 @@ uniform sampler2D specular_texture;
 uniform sampler2D normals_texture;
 uniform sampler2D opacity_texture;
 uniform mat4 normal_model_to_world;
+uniform bool use_compact_gbuffer;
+
+#include "common/normal_map.glsl"
+#include "common/octahedral.glsl"
 
 in VS_OUT {
 	vec3 normal;
@@ -17,6 +21,9 @@ in VS_OUT {
 	vec3 binormal;
 } fs_in;
 
+// With the compact G-buffer, the specular intensity is packed in the
+// alpha of the diffuse output, the specular output is not bound, and the
+// normal is octahedron-encoded in the first two components.
 layout (location = 0) out vec4 geometry_diffuse;
 layout (location = 1) out vec4 geometry_specular;
 layout (location = 2) out vec4 geometry_normal;
@@ -37,6 +44,19 @@ void main()
 	if (has_specular_texture)
 		geometry_specular = texture(specular_texture, fs_in.texcoord);
 
-	// Worldspace normal
-	geometry_normal.xyz = vec3(0.0);
+	// Worldspace normal, perturbed by the normal map if any, and remapped
+	// from [-1, 1] to [0, 1] to fit in the texture.
+	vec3 normal = normalize(fs_in.normal);
+	if (has_normals_texture) {
+		mat3 tbn = mat3(normalize(fs_in.tangent), normalize(fs_in.binormal), normal);
+		normal = tbn * decode_normal_map(texture(normals_texture, fs_in.texcoord));
+	}
+	normal = normalize(mat3(normal_model_to_world) * normal);
+
+	if (use_compact_gbuffer) {
+		geometry_diffuse.a = dot(geometry_specular.rgb, vec3(1.0 / 3.0));
+		geometry_normal = vec4(octahedral_encode(normal) * 0.5 + 0.5, 0.0, 0.0);
+	} else {
+		geometry_normal.xyz = normal * 0.5 + 0.5;
+	}
 }
@@ -2,6 +2,7 @@
 
 uniform mat4 vertex_model_to_world;
 uniform mat4 vertex_world_to_clip;
+uniform bool has_quantized_vertices;
 
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
@@ -16,12 +17,25 @@ out VS_OUT {
 	vec3 binormal;
 } vs_out;
 
+// Must match the depth pre-pass, which writes the depths this pass tests
+// for equality.
+invariant gl_Position;
+
+
+#include "common/octahedral.glsl"
 
 void main() {
-	vs_out.normal   = normalize(normal);
+	if (has_quantized_vertices) {
+		// The handedness of the tangent frame is stored in tangent.z.
+		vs_out.normal   = octahedral_decode(normal.xy);
+		vs_out.tangent  = octahedral_decode(tangent.xy);
+		vs_out.binormal = cross(vs_out.normal, vs_out.tangent) * tangent.z;
+	} else {
+		vs_out.normal   = normalize(normal);
+		vs_out.tangent  = normalize(tangent);
+		vs_out.binormal = normalize(binormal);
+	}
 	vs_out.texcoord = texcoord.xy;
-	vs_out.tangent  = normalize(tangent);
-	vs_out.binormal = normalize(binormal);
 
 	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
 }
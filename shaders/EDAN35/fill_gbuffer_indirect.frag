@@ -0,0 +1,60 @@
+#version 410
+
+// Same as fill_gbuffer.frag, except that textures are layers of texture
+// arrays, selected per mesh by |material_layers|: diffuse, specular,
+// normals and opacity, -1 meaning the mesh has no such texture. See
+// `IndirectScene`.
+uniform sampler2DArray diffuse_texture;
+uniform sampler2DArray specular_texture;
+uniform sampler2DArray normals_texture;
+uniform sampler2DArray opacity_texture;
+uniform bool use_compact_gbuffer;
+
+#include "common/normal_map.glsl"
+#include "common/octahedral.glsl"
+
+in VS_OUT {
+	vec3 normal;
+	vec2 texcoord;
+	vec3 tangent;
+	vec3 binormal;
+	flat ivec4 material_layers;
+} fs_in;
+
+layout (location = 0) out vec4 geometry_diffuse;
+layout (location = 1) out vec4 geometry_specular;
+layout (location = 2) out vec4 geometry_normal;
+
+
+void main()
+{
+	ivec4 layers = fs_in.material_layers;
+
+	if (layers.w >= 0 && texture(opacity_texture, vec3(fs_in.texcoord, float(layers.w))).r < 1.0)
+		discard;
+
+	// Diffuse color
+	geometry_diffuse = vec4(0.0f);
+	if (layers.x >= 0)
+		geometry_diffuse = texture(diffuse_texture, vec3(fs_in.texcoord, float(layers.x)));
+
+	// Specular color
+	geometry_specular = vec4(0.0f);
+	if (layers.y >= 0)
+		geometry_specular = texture(specular_texture, vec3(fs_in.texcoord, float(layers.y)));
+
+	// Worldspace normal, perturbed by the normal map if any, and remapped
+	// from [-1, 1] to [0, 1] to fit in the texture.
+	vec3 normal = normalize(fs_in.normal);
+	if (layers.z >= 0) {
+		mat3 tbn = mat3(normalize(fs_in.tangent), normalize(fs_in.binormal), normal);
+		normal = normalize(tbn * decode_normal_map(texture(normals_texture, vec3(fs_in.texcoord, float(layers.z)))));
+	}
+
+	if (use_compact_gbuffer) {
+		geometry_diffuse.a = dot(geometry_specular.rgb, vec3(1.0 / 3.0));
+		geometry_normal = vec4(octahedral_encode(normal) * 0.5 + 0.5, 0.0, 0.0);
+	} else {
+		geometry_normal.xyz = normal * 0.5 + 0.5;
+	}
+}
@@ -0,0 +1,53 @@
+#version 410
+
+uniform mat4 vertex_world_to_clip;
+uniform bool has_quantized_vertices;
+
+layout (location = 0) in vec3 vertex;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec3 texcoord;
+layout (location = 3) in vec3 tangent;
+layout (location = 4) in vec3 binormal;
+
+// Per-object attributes, set by `IndirectScene`; each matrix takes up
+// four locations.
+layout (location = 5) in mat4 vertex_model_to_world;
+layout (location = 9) in mat4 normal_model_to_world;
+layout (location = 13) in ivec4 material_layers;
+
+// The tangent frame is output in world space.
+out VS_OUT {
+	vec3 normal;
+	vec2 texcoord;
+	vec3 tangent;
+	vec3 binormal;
+	flat ivec4 material_layers;
+} vs_out;
+
+// Must match the depth pre-pass, which writes the depths this pass tests
+// for equality.
+invariant gl_Position;
+
+
+#include "common/octahedral.glsl"
+
+void main() {
+	vec3 model_normal, model_tangent, model_binormal;
+	if (has_quantized_vertices) {
+		// The handedness of the tangent frame is stored in tangent.z.
+		model_normal   = octahedral_decode(normal.xy);
+		model_tangent  = octahedral_decode(tangent.xy);
+		model_binormal = cross(model_normal, model_tangent) * tangent.z;
+	} else {
+		model_normal   = normalize(normal);
+		model_tangent  = normalize(tangent);
+		model_binormal = normalize(binormal);
+	}
+	vs_out.normal   = mat3(normal_model_to_world) * model_normal;
+	vs_out.tangent  = mat3(vertex_model_to_world) * model_tangent;
+	vs_out.binormal = mat3(vertex_model_to_world) * model_binormal;
+	vs_out.texcoord = texcoord.xy;
+	vs_out.material_layers = material_layers;
+
+	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
+}
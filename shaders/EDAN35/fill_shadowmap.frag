@@ -5,6 +5,7 @@ uniform sampler2D opacity_texture;
 
 in VS_OUT {
 	vec2 texcoord;
+	flat int opacity_layer;
 } fs_in;
 
 void main()
@@ -1,18 +1,22 @@
 #version 410
 
 uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
 
 layout (location = 0) in vec3 vertex;
 layout (location = 2) in vec3 texcoord;
 
+// The opacity layer is only used by fill_shadowmap_indirect.frag.
 out VS_OUT {
 	vec2 texcoord;
+	flat int opacity_layer;
 } vs_out;
 
+// Positions are left in world space: fill_shadowmap.geom projects them
+// once for each light.
 void main()
 {
 	vs_out.texcoord = texcoord.xy;
+	vs_out.opacity_layer = -1;
 
-	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
+	gl_Position = vertex_model_to_world * vec4(vertex, 1.0);
 }
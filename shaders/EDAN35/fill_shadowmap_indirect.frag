@@ -0,0 +1,16 @@
+#version 410
+
+uniform sampler2DArray opacity_texture;
+
+// |opacity_layer| is the layer of |opacity_texture| to sample, or -1 if
+// the mesh has no opacity texture; see `IndirectScene`.
+in VS_OUT {
+	vec2 texcoord;
+	flat int opacity_layer;
+} fs_in;
+
+void main()
+{
+	if (fs_in.opacity_layer >= 0 && texture(opacity_texture, vec3(fs_in.texcoord, float(fs_in.opacity_layer))).r < 1.0)
+		discard;
+}
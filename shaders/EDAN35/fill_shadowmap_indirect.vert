@@ -0,0 +1,24 @@
+#version 410
+
+layout (location = 0) in vec3 vertex;
+layout (location = 2) in vec3 texcoord;
+
+// Per-object attributes, set by `IndirectScene`; the matrix takes up
+// four locations.
+layout (location = 5) in mat4 vertex_model_to_world;
+layout (location = 13) in ivec4 material_layers;
+
+out VS_OUT {
+	vec2 texcoord;
+	flat int opacity_layer;
+} vs_out;
+
+// Positions are left in world space: fill_shadowmap.geom projects them
+// once for each light.
+void main()
+{
+	vs_out.texcoord = texcoord.xy;
+	vs_out.opacity_layer = material_layers.w;
+
+	gl_Position = vertex_model_to_world * vec4(vertex, 1.0);
+}
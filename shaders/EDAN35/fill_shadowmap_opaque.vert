@@ -0,0 +1,22 @@
+#version 410
+
+uniform mat4 vertex_model_to_world;
+
+layout (location = 0) in vec3 vertex;
+
+// Same interface as fill_shadowmap.vert, for fill_shadowmap.geom; opaque
+// casters are not alpha-tested, so only the positions are read.
+out VS_OUT {
+	vec2 texcoord;
+	flat int opacity_layer;
+} vs_out;
+
+// Positions are left in world space: fill_shadowmap.geom projects them
+// once for each light.
+void main()
+{
+	vs_out.texcoord = vec2(0.0);
+	vs_out.opacity_layer = -1;
+
+	gl_Position = vertex_model_to_world * vec4(vertex, 1.0);
+}
@@ -4,6 +4,7 @@ uniform sampler2D diffuse_texture;
 uniform sampler2D specular_texture;
 uniform sampler2D light_d_texture;
 uniform sampler2D light_s_texture;
+uniform bool use_compact_gbuffer; // The specular intensity is then in the alpha of diffuse_texture.
 
 in VS_OUT {
 	vec2 texcoord;
@@ -13,8 +14,10 @@ out vec4 frag_color;
 
 void main()
 {
-	vec3 diffuse  = texture(diffuse_texture,  fs_in.texcoord).rgb;
-	vec3 specular = texture(specular_texture, fs_in.texcoord).rgb;
+	vec4 diffuse_sample = texture(diffuse_texture, fs_in.texcoord);
+	vec3 diffuse  = diffuse_sample.rgb;
+	vec3 specular = use_compact_gbuffer ? vec3(diffuse_sample.a)
+	                                    : texture(specular_texture, fs_in.texcoord).rgb;
 
 	vec3 light_d  = texture(light_d_texture,  fs_in.texcoord).rgb;
 	vec3 light_s  = texture(light_s_texture,  fs_in.texcoord).rgb;
@@ -0,0 +1,121 @@
+#version 430
+
+// Must match `constant::light_tile_size`, `constant::max_lights_per_tile`
+// and `constant::shadowed_lights_nb` in EDAN35/assignment2.cpp.
+#define TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 1024
+#define SHADOWED_LIGHTS_NB 4
+
+struct Light {
+	vec4 position_range;      // apex of the cone, in world space, and distance at which the light fades out
+	vec4 direction_cos_outer; // direction of the cone, and cosine of its half-angle
+	vec4 color_cos_inner;     // color, and cosine of the angle at which the light starts fading out
+	vec4 bounding_sphere;     // sphere enclosing the cone, in world space
+};
+
+layout (std430, binding = 0) readonly buffer LightBuffer {
+	Light lights[];
+};
+layout (std430, binding = 1) readonly buffer TileLightCountBuffer {
+	uint tile_light_counts[];
+};
+layout (std430, binding = 2) readonly buffer TileLightIndexBuffer {
+	uint tile_light_indices[];
+};
+
+uniform sampler2D depth_texture;
+uniform sampler2D normal_texture;
+uniform sampler2DArrayShadow shadow_texture; // One layer per shadowed light
+
+uniform vec2 inv_res;
+uniform uint tiles_per_row;
+
+uniform mat4 view_projection_inverse;
+uniform vec3 camera_position;
+
+uniform float light_intensity;
+uniform float shininess;
+uniform bool use_compact_gbuffer;
+
+// The first lights cast shadows, using the layer of the shadow map array
+// with the same index.
+uniform mat4 shadow_view_projections[SHADOWED_LIGHTS_NB];
+uniform vec2 shadowmap_texel_size;
+
+#include "common/octahedral.glsl"
+
+layout (location = 0) out vec4 light_diffuse_contribution;
+layout (location = 1) out vec4 light_specular_contribution;
+
+
+// Decode the world-space normal stored in the G-buffer at |pixel|; with
+// the compact G-buffer, it is octahedron-encoded in the first two
+// components.
+vec3 fetch_normal(ivec2 pixel)
+{
+	vec4 encoded = texelFetch(normal_texture, pixel, 0) * 2.0 - 1.0;
+	if (!use_compact_gbuffer)
+		return normalize(encoded.xyz);
+	return octahedral_decode(encoded.xy);
+}
+
+// Fraction of the 3x3 texels around |position| in the shadow map of light
+// |layer| which |position| is closer to the light than.
+float shadow_factor(uint layer, vec3 position)
+{
+	vec4 shadow_position = shadow_view_projections[layer] * vec4(position, 1.0);
+	vec3 coords = shadow_position.xyz / shadow_position.w * 0.5 + 0.5;
+	if (any(lessThan(coords, vec3(0.0))) || any(greaterThan(coords, vec3(1.0))))
+		return 1.0;
+
+	float lit = 0.0;
+	for (int y = -1; y <= 1; ++y)
+		for (int x = -1; x <= 1; ++x)
+			lit += texture(shadow_texture, vec4(coords.xy + vec2(x, y) * shadowmap_texel_size, float(layer), coords.z - 0.0001));
+	return lit / 9.0;
+}
+
+void main()
+{
+	light_diffuse_contribution  = vec4(0.0, 0.0, 0.0, 1.0);
+	light_specular_contribution = vec4(0.0, 0.0, 0.0, 1.0);
+
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float depth = texelFetch(depth_texture, pixel, 0).r;
+	if (depth >= 1.0)
+		return;
+
+	vec4 world_position = view_projection_inverse * vec4(vec3(gl_FragCoord.xy * inv_res, depth) * 2.0 - 1.0, 1.0);
+	vec3 position = world_position.xyz / world_position.w;
+	vec3 normal = fetch_normal(pixel);
+	vec3 view_direction = normalize(camera_position - position);
+
+	uint tile_index = uint(pixel.y / TILE_SIZE) * tiles_per_row + uint(pixel.x / TILE_SIZE);
+	uint count = tile_light_counts[tile_index];
+	for (uint i = 0u; i < count; ++i) {
+		uint light_index = tile_light_indices[tile_index * MAX_LIGHTS_PER_TILE + i];
+		Light light = lights[light_index];
+
+		vec3 to_light = light.position_range.xyz - position;
+		float distance_squared = dot(to_light, to_light);
+		float range = light.position_range.w;
+		if (distance_squared >= range * range)
+			continue;
+		float light_distance = sqrt(distance_squared);
+		vec3 light_direction = to_light / light_distance;
+
+		// Inverse-square falloff, smoothly windowed to reach zero at the
+		// range of the light so that culling does not cut it off.
+		float window = clamp(1.0 - pow(light_distance / range, 4.0), 0.0, 1.0);
+		float distance_falloff = window * window / max(distance_squared, 1.0);
+		float angular_falloff = smoothstep(light.direction_cos_outer.w, light.color_cos_inner.w,
+		                                   dot(-light_direction, light.direction_cos_outer.xyz));
+		float shadow = light_index < SHADOWED_LIGHTS_NB ? shadow_factor(light_index, position) : 1.0;
+		vec3 radiance = light.color_cos_inner.rgb * (light_intensity * distance_falloff * angular_falloff * shadow);
+
+		float n_dot_l = max(dot(normal, light_direction), 0.0);
+		vec3 half_vector = normalize(light_direction + view_direction);
+		light_diffuse_contribution.rgb  += radiance * n_dot_l;
+		light_specular_contribution.rgb += radiance * (n_dot_l > 0.0 ? pow(max(dot(normal, half_vector), 0.0), shininess) : 0.0);
+	}
+}
@@ -0,0 +1,7 @@
+#version 410
+
+// For passes which only write depth, or stencil: there is nothing to
+// output.
+void main()
+{
+}
@@ -7,6 +7,9 @@ in VS_OUT {
 out vec4 result;
 
 uniform sampler2D tex;
+uniform sampler2DArray tex_array;
+uniform bool is_layered;
+uniform int layer;
 uniform ivec4 swizzle;
 uniform bool linearise;
 uniform float near;
@@ -19,7 +22,8 @@ float lineariseDepth(float value)
 
 void main()
 {
-	vec4 value = texture(tex, fs_in.texcoord);
+	vec4 value = is_layered ? texture(tex_array, vec3(fs_in.texcoord, float(layer)))
+	                        : texture(tex, fs_in.texcoord);
 	for (int i = 0; i < 4; ++i)
 		result[i] = (0 <= swizzle[i]) && (swizzle[i] <= 3)
 		          ? (linearise ? lineariseDepth(value[swizzle[i]]) : value[swizzle[i]])
@@ -0,0 +1,8 @@
+// Compressed normal maps only keep the X and Y components of the normals,
+// as BC5 textures have no third channel; Z is rebuilt from those, as
+// tangent-space normals always point away from the surface.
+vec3 decode_normal_map(vec4 texel)
+{
+	vec2 xy = texel.xy * 2.0 - 1.0;
+	return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
@@ -0,0 +1,22 @@
+// Octahedral encoding of unit vectors, used for the quantized vertex
+// normals and tangents written by `bonobo::packVertices()`, and for the
+// normals of the compact G-buffer.
+
+// Project |n| onto the octahedron |x| + |y| + |z| = 1 and unfold it onto
+// the [-1, 1]² square.
+vec2 octahedral_encode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.xy;
+}
+
+// Inverse of `octahedral_encode()`.
+vec3 octahedral_decode(vec2 encoded)
+{
+	vec3 v = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(v);
+}
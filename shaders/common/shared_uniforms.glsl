@@ -0,0 +1,13 @@
+// Uniforms shared by all draws of a frame, or of a view, uploaded once by
+// `SharedUniforms` (see src/core/SharedUniforms.hpp); both declarations
+// have to be kept in sync.
+
+layout (std140) uniform FrameData {
+	vec3 light_position;
+	float elapsed_time_s;
+};
+
+layout (std140) uniform ViewData {
+	mat4 vertex_world_to_clip;
+	vec3 camera_position;
+};
@@ -4,7 +4,8 @@ layout (location = 0) in vec3 vertex;
 layout (location = 2) in vec3 texcoord;
 
 uniform mat4 vertex_model_to_world;
-uniform mat4 vertex_world_to_clip;
+
+#include "common/shared_uniforms.glsl"
 
 out VS_OUT {
 	vec2 texcoord;
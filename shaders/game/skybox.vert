@@ -6,7 +6,8 @@ layout (location = 2) in vec3 texcoords;
 
 uniform mat4 vertex_model_to_world;
 uniform mat4 normal_model_to_world;
-uniform mat4 vertex_world_to_clip;
+
+#include "common/shared_uniforms.glsl"
 
 out VS_OUT {
 	vec3 vertex;
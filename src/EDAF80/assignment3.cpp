@@ -7,6 +7,7 @@
 #include "core/FPSCamera.h"
 #include "core/node.hpp"
 #include "core/ShaderProgramManager.hpp"
+#include "core/SharedUniforms.hpp"
 
 #include <imgui.h>
 #include <glm/glm.hpp>
@@ -110,8 +111,13 @@ edaf80::Assignment3::run()
 	auto diffuse = glm::vec3(0.7f, 0.2f, 0.4f);
 	auto specular = glm::vec3(1.0f, 1.0f, 1.0f);
 	auto shininess = 10.0f;
-	auto const phong_set_uniforms = [&use_normal_mapping,&light_position,&camera_position,&ambient,&diffuse,&specular,&shininess](GLuint program){
-		glUniform1i(glGetUniformLocation(program, "use_normal_mapping"), use_normal_mapping ? 1 : 0);
+
+	// The Phong program reads the light and camera from shared uniform
+	// blocks, while the other programs still use the uniforms above.
+	SharedUniforms shared_uniforms;
+	SharedUniforms::FrameData frame_data;
+	SharedUniforms::ViewData view_data;
+	auto const phong_set_uniforms = [&light_position,&camera_position,&ambient,&diffuse,&specular,&shininess](GLuint program){
 		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
 		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
 		glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient));
@@ -129,7 +135,7 @@ edaf80::Assignment3::run()
 
 	auto sphere_texture = bonobo::loadTexture2D(config::resources_path("textures/leather_red_02_coll1_2k.jpg"));
 	auto sphere_specular_map = bonobo::loadTexture2D(config::resources_path("textures/leather_red_02_rough_2k.jpg"));
-	auto sphere_normal_map = bonobo::loadTexture2D(config::resources_path("textures/leather_red_02_nor_2k.jpg"));
+	auto sphere_normal_map = bonobo::loadTexture2D(config::resources_path("textures/leather_red_02_nor_2k.jpg"), true, TextureCache::Usage::normal_map);
 
 	//
 	// Set up the two spheres used.
@@ -224,6 +230,12 @@ edaf80::Assignment3::run()
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 		bonobo::changePolygonMode(polygon_mode);
 
+		frame_data.light_position = light_position;
+		shared_uniforms.SetFrameData(frame_data);
+		view_data.vertex_world_to_clip = mCamera.GetWorldToClipMatrix();
+		view_data.camera_position = camera_position;
+		shared_uniforms.SetViewData(view_data);
+
 		skybox.get_transform().SetTranslate(camera_position);
 		skybox.render(mCamera.GetWorldToClipMatrix());
 		demo_sphere.render(mCamera.GetWorldToClipMatrix());
@@ -238,11 +250,16 @@ edaf80::Assignment3::run()
 			}
 			bonobo::uiSelectPolygonMode("Polygon mode", polygon_mode);
 			auto demo_sphere_selection_result = program_manager.SelectProgram("Demo sphere", demo_sphere_program_index);
-			if (demo_sphere_selection_result.was_selection_changed) {
-				demo_sphere.set_program(demo_sphere_selection_result.program, phong_set_uniforms);
-			}
 			ImGui::Separator();
-			ImGui::Checkbox("Use normal mapping", &use_normal_mapping);
+			auto const was_normal_mapping_toggled = ImGui::Checkbox("Use normal mapping", &use_normal_mapping);
+			if (demo_sphere_selection_result.was_selection_changed || was_normal_mapping_toggled) {
+				// Normal mapping is compiled into its own variant of the
+				// Phong program, rather than toggled by a uniform.
+				auto program = demo_sphere_selection_result.program;
+				if (program == &phong_shader && use_normal_mapping)
+					program = &program_manager.GetProgramPermutation("Phong", { { "NORMAL_MAP", "1" } });
+				demo_sphere.set_program(program, phong_set_uniforms);
+			}
 			ImGui::ColorEdit3("Ambient", glm::value_ptr(ambient));
 			ImGui::ColorEdit3("Diffuse", glm::value_ptr(diffuse));
 			ImGui::ColorEdit3("Specular", glm::value_ptr(specular));
@@ -7,6 +7,7 @@
 #include "core/helpers.hpp"
 #include "core/node.hpp"
 #include "core/ShaderProgramManager.hpp"
+#include "core/SharedUniforms.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
@@ -83,7 +84,7 @@ edaf80::Assignment4::run()
                                                               cubemap_texture_path + "posz.jpg",
                                                               cubemap_texture_path + "negz.jpg" );
 	
-	auto water_normal_map = bonobo::loadTexture2D(config::resources_path("textures/waves.png"));
+	auto water_normal_map = bonobo::loadTexture2D(config::resources_path("textures/waves.png"), true, TextureCache::Usage::normal_map);
 	//
 	// Todo: Insert the creation of other shader programs.
 	//       (Check how it was done in assignment 3.)
@@ -96,6 +97,12 @@ edaf80::Assignment4::run()
 		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position)),
 		glUniform1f(glGetUniformLocation(program, "elapsed_time_s"), elapsed_time_s);
 	};
+
+	// The water program reads the time and camera from shared uniform
+	// blocks instead.
+	SharedUniforms shared_uniforms;
+	SharedUniforms::FrameData frame_data;
+	SharedUniforms::ViewData view_data;
 	
 	//
 	// Todo: Load your geometry
@@ -193,6 +200,13 @@ edaf80::Assignment4::run()
 		bonobo::changePolygonMode(polygon_mode);
 
 		if (!shader_reload_failed) {
+			frame_data.light_position = light_position;
+			frame_data.elapsed_time_s = elapsed_time_s;
+			shared_uniforms.SetFrameData(frame_data);
+			view_data.vertex_world_to_clip = mCamera.GetWorldToClipMatrix();
+			view_data.camera_position = camera_position;
+			shared_uniforms.SetViewData(view_data);
+
 			skybox.get_transform().SetTranslate(camera_position);
 			skybox.render(mCamera.GetWorldToClipMatrix());
 			
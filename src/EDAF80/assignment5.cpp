@@ -6,8 +6,13 @@
 #include "core/Bonobo.h"
 #include "core/FPSCamera.h"
 #include "core/helpers.hpp"
+#include "core/instanced_node.hpp"
 #include "core/node.hpp"
+#include "core/render_queue.hpp"
 #include "core/ShaderProgramManager.hpp"
+#include "core/SharedUniforms.hpp"
+#include "core/terrain.hpp"
+#include "core/UniformCache.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
@@ -149,51 +154,61 @@ edaf80::Assignment5::run()
 	if (shader_phong == 0u)
 		LogError("Failed to load phong shader");
 
+	GLuint shader_phong_instanced = 0u;
+	program_manager.CreateAndRegisterProgram("Phong (instanced)",
+	                                         { { ShaderType::vertex, "EDAF80/phong_instanced.vert" },
+	                                           { ShaderType::fragment, "EDAF80/phong.frag" } },
+	                                         shader_phong_instanced);
+	if (shader_phong_instanced == 0u)
+		LogError("Failed to load instanced phong shader");
+
+	// Everything drawn with Phong shading uses normal mapping.
+	GLuint const& shader_phong_normal_mapped = program_manager.GetProgramPermutation("Phong", { { "NORMAL_MAP", "1" } });
+	GLuint const& shader_phong_instanced_normal_mapped = program_manager.GetProgramPermutation("Phong (instanced)", { { "NORMAL_MAP", "1" } });
+
 	//
 	// Set uniforms
 	//
-	float elapsed_time_s = 0.0f;
-	auto light_position = glm::vec3(-8.0f, -15.0f, 2.0f);
-	auto const uniforms_skybox = [&light_position,&camera_position,&elapsed_time_s](GLuint program){
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position)),
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position)),
-		glUniform1f(glGetUniformLocation(program, "elapsed_time_s"), elapsed_time_s);
-	};
+	// The light, time and camera are shared by all programs, and uploaded
+	// once per frame rather than by each node.
+	SharedUniforms shared_uniforms;
+	SharedUniforms::FrameData frame_data;
+	frame_data.light_position = glm::vec3(-8.0f, -15.0f, 2.0f);
+	SharedUniforms::ViewData view_data;
+
+	UniformLocation const ambient_location("ambient");
+	UniformLocation const diffuse_location("diffuse");
+	UniformLocation const specular_location("specular");
+	UniformLocation const shininess_location("shininess");
 
-	bool use_normal_mapping = true;
 	auto ambient_player = glm::vec3(0.1f, 0.3f, 0.2f);
 	auto diffuse_player = glm::vec3(0.4f, 0.6f, 0.3f);
 	auto specular_player = glm::vec3(0.3f, 1.0f, 0.5f);
 	auto shininess_player = 5.0f;
-	auto const uniforms_phong_player = [&use_normal_mapping,&light_position,&camera_position,&ambient_player,&diffuse_player,&specular_player,&shininess_player](GLuint program){
-		glUniform1i(glGetUniformLocation(program, "use_normal_mapping"), use_normal_mapping ? 1 : 0);
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-		glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient_player));
-		glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse_player));
-		glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular_player));
-		glUniform1f(glGetUniformLocation(program, "shininess"), shininess_player);
+	auto const uniforms_phong_player = [&ambient_player,&diffuse_player,&specular_player,&shininess_player,
+	                                    &ambient_location,&diffuse_location,&specular_location,&shininess_location](GLuint program){
+		glUniform3fv(ambient_location(program), 1, glm::value_ptr(ambient_player));
+		glUniform3fv(diffuse_location(program), 1, glm::value_ptr(diffuse_player));
+		glUniform3fv(specular_location(program), 1, glm::value_ptr(specular_player));
+		glUniform1f(shininess_location(program), shininess_player);
 	};
 
 	auto ambient_point = glm::vec3(0.5f, 0.1f, 0.1f);
 	auto diffuse_point = glm::vec3(0.0f, 0.0f, 0.8f);
 	auto specular_point = glm::vec3(0.1f, 0.1f, 0.1f);
 	auto shininess_point = 0.75f;
-	auto const uniforms_phong_point = [&use_normal_mapping,&light_position,&camera_position,&ambient_point,&diffuse_point,&specular_point,&shininess_point](GLuint program){
-		glUniform1i(glGetUniformLocation(program, "use_normal_mapping"), use_normal_mapping ? 1 : 0);
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-		glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient_point));
-		glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse_point));
-		glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular_point));
-		glUniform1f(glGetUniformLocation(program, "shininess"), shininess_point);
+	auto const uniforms_phong_point = [&ambient_point,&diffuse_point,&specular_point,&shininess_point,
+	                                   &ambient_location,&diffuse_location,&specular_location,&shininess_location](GLuint program){
+		glUniform3fv(ambient_location(program), 1, glm::value_ptr(ambient_point));
+		glUniform3fv(diffuse_location(program), 1, glm::value_ptr(diffuse_point));
+		glUniform3fv(specular_location(program), 1, glm::value_ptr(specular_point));
+		glUniform1f(shininess_location(program), shininess_point);
 	};
 
 	//
 	// Load your geometry
 	//
 	auto const shape_skybox = parametric_shapes::createSphere(75.0f, 100u, 100u);
-	auto const shape_ground = parametric_shapes::createRandomQuad(400, 400, 1500, 1500, 0.075);
 	auto const shape_player = parametric_shapes::createSphere(player_diameter / 2.0f, 10, 10);
 	auto const shape_point = parametric_shapes::createSphere(point_diameter / 2.0f, 20, 20);
 
@@ -207,22 +222,35 @@ edaf80::Assignment5::run()
                                                     	cubemap_texture_path + "negy.jpg",
                                                         cubemap_texture_path + "posz.jpg",
                                                         cubemap_texture_path + "negz.jpg" );
-	auto map_normal_water = bonobo::loadTexture2D(config::resources_path("textures/waves.png"));
+	auto map_normal_water = bonobo::loadTexture2D(config::resources_path("textures/waves.png"), true, TextureCache::Usage::normal_map);
 	auto texture_ground = bonobo::loadTexture2D(config::resources_path("textures/leather_red_02_coll1_2k.jpg"));
 	auto map_specular_ground = bonobo::loadTexture2D(config::resources_path("textures/leather_red_02_rough_2k.jpg"));
-	auto map_normal_ground = bonobo::loadTexture2D(config::resources_path("textures/leather_red_02_nor_2k.jpg"));
+	auto map_normal_ground = bonobo::loadTexture2D(config::resources_path("textures/leather_red_02_nor_2k.jpg"), true, TextureCache::Usage::normal_map);
 
 	//
 	// Nodes
 	//
 	Node skybox;
 	skybox.set_geometry(shape_skybox);
-	skybox.set_program(&shader_skybox, uniforms_skybox);
+	skybox.set_program(&shader_skybox);
 	skybox.add_texture("cube_map", map_cube_skybox, GL_TEXTURE_CUBE_MAP);
 	skybox.get_transform().SetTranslate(skybox_position);
 	
-	Node ground;
-	ground.set_geometry(shape_ground);
+	// The ground is as dense as a 1500×1500 split quad, but only the tiles
+	// in view are drawn, and far away ones at a coarser resolution. Its
+	// shader only reads positions and texture coordinates, which do not
+	// need any decoding when quantized.
+	Terrain::Settings ground_settings;
+	ground_settings.width = 400.0f;
+	ground_settings.height = 400.0f;
+	ground_settings.tiles_per_side = 16u;
+	ground_settings.tile_edges_nb = 96u;
+	ground_settings.lods_nb = 5u;
+	ground_settings.max_random = 0.075f;
+	ground_settings.seed = 0x5eedu;
+	Terrain ground;
+	ground.create(ground_settings);
+	ground.set_name("Ground");
 	ground.get_transform().SetTranslate(glm::vec3(-100.0f, ground_y, 0.0f));
 	ground.set_program(&shader_ground, uniforms_phong_player);
 	ground.add_texture("my_texture", texture_ground, GL_TEXTURE_2D);
@@ -233,22 +261,36 @@ edaf80::Assignment5::run()
 	Node player;
 	player.set_geometry(shape_player);
 	player.get_transform().SetTranslate(player_position);
-	player.set_program(&shader_phong, uniforms_phong_player);
+	player.set_program(&shader_phong_normal_mapped, uniforms_phong_player);
 	player.add_texture("sphere_texture", texture_ground, GL_TEXTURE_2D);
 	player.add_texture("skybox_texture", map_cube_skybox, GL_TEXTURE_CUBE_MAP);
 	player.add_texture("specular_map", map_specular_ground, GL_TEXTURE_2D);
 	player.add_texture("normal_map", map_normal_ground, GL_TEXTURE_2D);
 	
+	// The body segments and the points only hold transforms; all segments,
+	// and all points, are drawn at once by their instanced counterparts.
+	InstancedNode body_instances;
+	body_instances.set_geometry(shape_player);
+	body_instances.set_name("Body segments");
+	body_instances.set_program(&shader_phong_instanced_normal_mapped, uniforms_phong_player);
+	body_instances.add_texture("sphere_texture", texture_ground, GL_TEXTURE_2D);
+	body_instances.add_texture("skybox_texture", map_cube_skybox, GL_TEXTURE_CUBE_MAP);
+	body_instances.add_texture("specular_map", map_specular_ground, GL_TEXTURE_2D);
+	body_instances.add_texture("normal_map", map_normal_ground, GL_TEXTURE_2D);
+
+	InstancedNode point_instances;
+	point_instances.set_geometry(shape_point);
+	point_instances.set_name("Points");
+	point_instances.set_program(&shader_phong_instanced_normal_mapped, uniforms_phong_point);
+	point_instances.add_texture("sphere_texture", texture_ground, GL_TEXTURE_2D);
+	point_instances.add_texture("skybox_texture", map_cube_skybox, GL_TEXTURE_CUBE_MAP);
+	point_instances.add_texture("specular_map", map_specular_ground, GL_TEXTURE_2D);
+	point_instances.add_texture("normal_map", map_normal_ground, GL_TEXTURE_2D);
+
 	array<Node, body_segments> body;
 	for (size_t i = 0; i < body.size(); i++)
 	{
-		body[i].set_geometry(shape_player);
 		body[i].get_transform().SetTranslate(player_position + glm::vec3(0.0f,0.0f,segment_displacement*static_cast<float>(i+1)));
-		body[i].set_program(&shader_phong, uniforms_phong_player);
-		body[i].add_texture("sphere_texture", texture_ground, GL_TEXTURE_2D);
-		body[i].add_texture("skybox_texture", map_cube_skybox, GL_TEXTURE_CUBE_MAP);
-		body[i].add_texture("specular_map", map_specular_ground, GL_TEXTURE_2D);
-		body[i].add_texture("normal_map", map_normal_ground, GL_TEXTURE_2D);
 		player.add_child(&body[i]);
 		
 		current_segment_positions[i] = body[i].get_transform().GetTranslation();
@@ -259,15 +301,11 @@ edaf80::Assignment5::run()
 
 	for (size_t i = 0; i < points.size(); i++)
 	{
-		points[i].set_geometry(shape_point);
 		points[i].get_transform().SetTranslate(glm::vec3(0.0f, point_y, -20.0f));
-		points[i].set_program(&shader_phong, uniforms_phong_point);
-		points[i].add_texture("sphere_texture", texture_ground, GL_TEXTURE_2D);
-		points[i].add_texture("skybox_texture", map_cube_skybox, GL_TEXTURE_CUBE_MAP);
-		points[i].add_texture("specular_map", map_specular_ground, GL_TEXTURE_2D);
-		points[i].add_texture("normal_map", map_normal_ground, GL_TEXTURE_2D);	
 	}
 
+	RenderQueue render_queue;
+
 	glClearDepthf(1.0f);
 	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 	glEnable(GL_DEPTH_TEST);
@@ -288,7 +326,7 @@ edaf80::Assignment5::run()
 		auto const nowTime = std::chrono::high_resolution_clock::now();
 		auto const deltaTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(nowTime - lastTime);
 		lastTime = nowTime;
-		elapsed_time_s += std::chrono::duration<float>(deltaTimeUs).count();
+		frame_data.elapsed_time_s += std::chrono::duration<float>(deltaTimeUs).count();
 		delay_counter += std::chrono::duration<float>(deltaTimeUs).count();
 		point_counter += std::chrono::duration<float>(deltaTimeUs).count();
 		
@@ -370,7 +408,7 @@ edaf80::Assignment5::run()
 		//
 		mCamera.mWorld.SetTranslate(camera_position);
 		mCamera.mWorld.SetRotateX(camera_rotation);
-		ground.get_transform().SetRotateY(-elapsed_time_s * 0.020 * pi);
+		ground.get_transform().SetRotateY(-frame_data.elapsed_time_s * 0.020 * pi);
 		skybox.get_transform().SetTranslate(skybox_position);
 		player.get_transform().SetTranslate(player_position);
 		if(update_body_segments){
@@ -434,21 +472,35 @@ edaf80::Assignment5::run()
 		bonobo::changePolygonMode(polygon_mode);
 
 		if (!shader_reload_failed) {
+			view_data.vertex_world_to_clip = mCamera.GetWorldToClipMatrix();
+			view_data.camera_position = mCamera.mWorld.GetTranslation();
+			shared_uniforms.SetFrameData(frame_data);
+			shared_uniforms.SetViewData(view_data);
+
 			//
 			// Render all geometry
 			//	
-			skybox.render(mCamera.GetWorldToClipMatrix());
+			render_queue.add(skybox);
+			render_queue.add(player);
+			render_queue.flush(mCamera.GetWorldToClipMatrix());
+
+			ground.update(mCamera.GetWorldToClipMatrix(), mCamera.mWorld.GetTranslation());
 			ground.render(mCamera.GetWorldToClipMatrix());
-			player.render(mCamera.GetWorldToClipMatrix());
+
+			body_instances.clear_instances();
 			for (size_t i = 0; i < body.size(); i++)
 			{
-				body[i].render(mCamera.GetWorldToClipMatrix());
+				body_instances.add_instance(body[i].get_transform().GetMatrix());
 			}
+			body_instances.render(mCamera.GetWorldToClipMatrix());
+
+			point_instances.clear_instances();
 			for (size_t i = 0; i < points.size(); i++)
 			{
 				if(points_alive[i])
-					points[i].render(mCamera.GetWorldToClipMatrix());
+					point_instances.add_instance(points[i].get_transform().GetMatrix());
 			}
+			point_instances.render(mCamera.GetWorldToClipMatrix());
 		}
 
 
@@ -463,6 +515,25 @@ edaf80::Assignment5::run()
 		}
 		ImGui::End();
 
+		if (ImGui::Begin("Render Queue")) {
+			auto const& stats = render_queue.get_stats();
+			ImGui::Text("Draws: %zu (%zu frustum culled)", stats.draws_nb, stats.culled_nb);
+			ImGui::Text("Program binds: %zu (%zu saved)", stats.program_binds_nb, stats.program_binds_saved_nb);
+			ImGui::Text("Texture binds: %zu (%zu saved)", stats.texture_binds_nb, stats.texture_binds_saved_nb);
+			ImGui::Text("VAO binds: %zu (%zu saved)", stats.vao_binds_nb, stats.vao_binds_saved_nb);
+		}
+		ImGui::End();
+
+		if (ImGui::Begin("Terrain")) {
+			auto const& stats = ground.get_stats();
+			ImGui::Text("Tiles drawn: %zu / %zu", stats.tiles_drawn_nb, stats.tiles_nb);
+			for (size_t lod = 0u; lod < ground_settings.lods_nb; ++lod)
+				ImGui::Text("  LOD %zu: %zu", lod, stats.tiles_per_lod_nb[lod]);
+			ImGui::Text("Vertices submitted: %zu / %zu", stats.vertices_submitted_nb, stats.vertices_nb);
+			ImGui::Text("Triangles submitted: %zu", stats.triangles_submitted_nb);
+		}
+		ImGui::End();
+
 		if (show_basis)
 			bonobo::renderBasis(basis_thickness_scale, basis_length_scale, mCamera.GetWorldToClipMatrix());
 		if (show_logs)
@@ -1,5 +1,6 @@
 #include "parametric_shapes.hpp"
 #include "core/Log.h"
+#include "core/MeshOptimizer.hpp"
 
 #include <glm/glm.hpp>
 
@@ -7,14 +8,50 @@
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <initializer_list>
 #include <iostream>
 #include <vector>
 
+namespace
+{
+	//! \brief Optimise the order of the triangles and vertices of a
+	//!        shape, and log how much better it uses the post-transform
+	//!        cache.
+	//!
+	//! @param [in] name of the shape, used in the log
+	//! @param [in] index_sets the triangles of the shape
+	//! @param [in,out] attributes the vertex attributes used by the shape,
+	//!                 starting with the positions; they are reordered to
+	//!                 match the returned indices
+	//! @return the optimised indices
+	std::vector<GLuint> optimizeShape(char const* name, std::vector<glm::uvec3> const& index_sets,
+	                                  std::initializer_list<std::vector<glm::vec3>*> attributes)
+	{
+		auto const& vertices = **attributes.begin();
+		std::vector<GLuint> indices(3u * index_sets.size());
+		for (size_t i = 0u; i < index_sets.size(); ++i)
+			for (glm::uvec3::length_type k = 0; k < 3; ++k)
+				indices[3u * i + k] = index_sets[i][k];
+
+		auto const optimization = MeshOptimizer::Optimize(indices, vertices.size(), vertices.data(), sizeof(glm::vec3));
+		for (auto const attribute : attributes)
+			MeshOptimizer::RemapVertices(*attribute, optimization.remap);
+
+		LogTrivia("Shape \"%s\" optimised in %.3f ms: ACMR %.3f → %.3f, ATVR %.3f → %.3f",
+		          name, optimization.optimization_time_ms,
+		          optimization.before.acmr, optimization.after.acmr,
+		          optimization.before.atvr, optimization.after.atvr);
+
+		return indices;
+	}
+}
+
 bonobo::mesh_data
 parametric_shapes::createRandomQuad(float const width, float const height,
                               unsigned int const horizontal_split_count,
                               unsigned int const vertical_split_count,
-							  float const max_random)
+							  float const max_random,
+                              bonobo::vertex_format_t const format)
 {
 
 	auto const vertical_slice_edges_count = vertical_split_count + 1u;
@@ -68,29 +105,20 @@ parametric_shapes::createRandomQuad(float const width, float const height,
 		}
 	}
 
+	auto const indices = optimizeShape("random quad", index_sets, { &vertices, &texcoords });
+
 	bonobo::mesh_data data;
 	glGenVertexArrays(1, &data.vao);
 
 	glBindVertexArray(data.vao);
 
-	auto const vertices_offset = 0u;
-	auto const vertices_size = vertices.size() * sizeof(glm::vec3);
-	auto const indices_size = index_sets.size() * sizeof(glm::uvec3);
-	auto const texcoords_offset = vertices_offset + vertices_size;
-	auto const texcoords_size = texcoords.size() * sizeof(glm::vec3);
-	auto const bo_size = vertices_size + texcoords_size;
-	
-	glGenBuffers(1, &data.bo);
-	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-	glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-	glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, vertices.data());
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+	auto const indices_size = indices.size() * sizeof(GLuint);
 
-	glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, texcoords.data());
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
+	bonobo::vertex_attributes_view attributes;
+	attributes.vertices_nb = vertices.size();
+	attributes.vertices = vertices.data();
+	attributes.texcoords = texcoords.data();
+	bonobo::uploadVertices(data, format, attributes);
 
 	glGenBuffers(1, /*! \todo fill me */ &data.ibo);
 
@@ -99,10 +127,10 @@ parametric_shapes::createRandomQuad(float const width, float const height,
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */ data.ibo);
 
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */ indices_size,
-	             /* where is the data stored on the CPU? */index_sets.data(),
+	             /* where is the data stored on the CPU? */indices.data(),
 	             /* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
 
-	data.indices_nb = /*! \todo how many indices do we have? */ index_sets.size() * 3;
+	data.indices_nb = /*! \todo how many indices do we have? */ static_cast<GLsizei>(indices.size());
 
 	// All the data has been recorded, we can unbind them.
 	glBindVertexArray(0u);
@@ -115,7 +143,8 @@ parametric_shapes::createRandomQuad(float const width, float const height,
 bonobo::mesh_data
 parametric_shapes::createQuad(float const width, float const height,
                               unsigned int const horizontal_split_count,
-                              unsigned int const vertical_split_count)
+                              unsigned int const vertical_split_count,
+                              bonobo::vertex_format_t const format)
 {
 
 	auto const vertical_slice_edges_count = vertical_split_count + 1u;
@@ -167,29 +196,20 @@ parametric_shapes::createQuad(float const width, float const height,
 		}
 	}
 
+	auto const indices = optimizeShape("quad", index_sets, { &vertices, &texcoords });
+
 	bonobo::mesh_data data;
 	glGenVertexArrays(1, &data.vao);
 
 	glBindVertexArray(data.vao);
 
-	auto const vertices_offset = 0u;
-	auto const vertices_size = vertices.size() * sizeof(glm::vec3);
-	auto const indices_size = index_sets.size() * sizeof(glm::uvec3);
-	auto const texcoords_offset = vertices_offset + vertices_size;
-	auto const texcoords_size = texcoords.size() * sizeof(glm::vec3);
-	auto const bo_size = vertices_size + texcoords_size;
-	
-	glGenBuffers(1, &data.bo);
-	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-	glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-	glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, vertices.data());
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+	auto const indices_size = indices.size() * sizeof(GLuint);
 
-	glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, texcoords.data());
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
+	bonobo::vertex_attributes_view attributes;
+	attributes.vertices_nb = vertices.size();
+	attributes.vertices = vertices.data();
+	attributes.texcoords = texcoords.data();
+	bonobo::uploadVertices(data, format, attributes);
 
 	glGenBuffers(1, /*! \todo fill me */ &data.ibo);
 
@@ -198,10 +218,10 @@ parametric_shapes::createQuad(float const width, float const height,
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, /*! \todo bind the previously generated Buffer */ data.ibo);
 
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, /*! \todo how many bytes should the buffer contain? */ indices_size,
-	             /* where is the data stored on the CPU? */index_sets.data(),
+	             /* where is the data stored on the CPU? */indices.data(),
 	             /* inform OpenGL that the data is modified once, but used often */GL_STATIC_DRAW);
 
-	data.indices_nb = /*! \todo how many indices do we have? */ index_sets.size() * 3;
+	data.indices_nb = /*! \todo how many indices do we have? */ static_cast<GLsizei>(indices.size());
 
 	// All the data has been recorded, we can unbind them.
 	glBindVertexArray(0u);
@@ -214,7 +234,8 @@ parametric_shapes::createQuad(float const width, float const height,
 bonobo::mesh_data
 parametric_shapes::createSphere(float const radius,
                                 unsigned int const longitude_split_count,
-                                unsigned int const latitude_split_count) {	
+                                unsigned int const latitude_split_count,
+                                bonobo::vertex_format_t const format) {	
 	auto const longitude_slice_edges_count = longitude_split_count + 1u;
 	auto const latitude_slice_edges_count = latitude_split_count + 1u;
 	auto const longitude_slice_vertices_count = longitude_slice_edges_count + 1u;
@@ -283,53 +304,25 @@ parametric_shapes::createSphere(float const radius,
 		}
 	}
 
+	auto const indices = optimizeShape("sphere", index_sets, { &vertices, &normals, &texcoords, &tangents, &binormals });
+
 	bonobo::mesh_data data;
 	glGenVertexArrays(1, &data.vao);
 	glBindVertexArray(data.vao);
 
-	auto const vertices_offset = 0u;
-	auto const vertices_size = vertices.size() * sizeof(glm::vec3);
-	auto const indices_size = index_sets.size() * sizeof(glm::uvec3);
-	auto const normals_offset = vertices_size;
-	auto const normals_size = normals.size() * sizeof(glm::vec3);
-	auto const texcoords_offset = normals_offset + normals_size;
-	auto const texcoords_size = texcoords.size() * sizeof(glm::vec3);
-	auto const tangents_offset = texcoords_offset + texcoords_size;
-	auto const tangents_size = tangents.size() * sizeof(glm::vec3);
-	auto const binormals_offset = tangents_offset + tangents_size;
-	auto const binormals_size = binormals.size() * sizeof(glm::vec3);
-	auto const bo_size = vertices_size + normals_size + texcoords_size + tangents_size + binormals_size;
-	
-	glGenBuffers(1, &data.bo);
-	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-	glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-	glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, vertices.data());
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-	glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, normals.data());
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, tangents.data());
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, binormals.data());
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-	
-	glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, texcoords.data());
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	bonobo::vertex_attributes_view attributes;
+	attributes.vertices_nb = vertices.size();
+	attributes.vertices = vertices.data();
+	attributes.normals = normals.data();
+	attributes.texcoords = texcoords.data();
+	attributes.tangents = tangents.data();
+	attributes.binormals = binormals.data();
+	bonobo::uploadVertices(data, format, attributes);
 
-	data.indices_nb = index_sets.size() * 3u;
+	data.indices_nb = static_cast<GLsizei>(indices.size());
 	glGenBuffers(1, &data.ibo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_sets.size() * sizeof(glm::uvec3), index_sets.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
 	glBindVertexArray(0u);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
@@ -341,7 +334,8 @@ bonobo::mesh_data
 parametric_shapes::createTorus(float const major_radius,
                                float const minor_radius,
                                unsigned int const major_split_count,
-                               unsigned int const minor_split_count)
+                               unsigned int const minor_split_count,
+                               bonobo::vertex_format_t const /*format*/)
 {
 	//! \todo (Optional) Implement this function
 	return bonobo::mesh_data();
@@ -351,7 +345,8 @@ bonobo::mesh_data
 parametric_shapes::createCircleRing(float const radius,
                                     float const spread_length,
                                     unsigned int const circle_split_count,
-                                    unsigned int const spread_split_count)
+                                    unsigned int const spread_split_count,
+                                    bonobo::vertex_format_t const format)
 {
 	auto const circle_slice_edges_count = circle_split_count + 1u;
 	auto const spread_slice_edges_count = spread_split_count + 1u;
@@ -428,59 +423,27 @@ parametric_shapes::createCircleRing(float const radius,
 		}
 	}
 
+	auto const indices = optimizeShape("circle ring", index_sets, { &vertices, &normals, &texcoords, &tangents, &binormals });
+
 	bonobo::mesh_data data;
 	glGenVertexArrays(1, &data.vao);
 	assert(data.vao != 0u);
 	glBindVertexArray(data.vao);
 
-	auto const vertices_offset = 0u;
-	auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-	auto const normals_offset = vertices_size;
-	auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-	auto const texcoords_offset = normals_offset + normals_size;
-	auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-	auto const tangents_offset = texcoords_offset + texcoords_size;
-	auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-	auto const binormals_offset = tangents_offset + tangents_size;
-	auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-	auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-	                                            +normals_size
-	                                            +texcoords_size
-	                                            +tangents_size
-	                                            +binormals_size
-	                                            );
-	glGenBuffers(1, &data.bo);
-	assert(data.bo != 0u);
-	glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-	glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-	glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-	glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-
-	glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-	glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-	glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	bonobo::vertex_attributes_view attributes;
+	attributes.vertices_nb = vertices.size();
+	attributes.vertices = vertices.data();
+	attributes.normals = normals.data();
+	attributes.texcoords = texcoords.data();
+	attributes.tangents = tangents.data();
+	attributes.binormals = binormals.data();
+	bonobo::uploadVertices(data, format, attributes);
 
-	data.indices_nb = static_cast<GLsizei>(index_sets.size() * 3u);
+	data.indices_nb = static_cast<GLsizei>(indices.size());
 	glGenBuffers(1, &data.ibo);
 	assert(data.ibo != 0u);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(index_sets.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(index_sets.data()), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(GLuint)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
 
 	glBindVertexArray(0u);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
@@ -17,12 +17,14 @@ namespace parametric_shapes
 	//!                             should be split: 0 means each vertical
 	//!                             line consist of a single edge, 1 gives
 	//!                             you two edges, and so on.
+	//! @param format in which to store the vertex attributes
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	bonobo::mesh_data createRandomQuad(float const width, float const height,
 	                             unsigned int const horizontal_split_count = 0u,
 	                             unsigned int const vertical_split_count = 0u, 
-								 float const max_random = 0.0);
+								 float const max_random = 0.0,
+	                             bonobo::vertex_format_t const format = bonobo::vertex_format_t::float32);
 	//! \brief Create a quad a given tesselation level and make it
 	//!        available to OpenGL.
 	//!
@@ -36,11 +38,13 @@ namespace parametric_shapes
 	//!                             should be split: 0 means each vertical
 	//!                             line consist of a single edge, 1 gives
 	//!                             you two edges, and so on.
+	//! @param format in which to store the vertex attributes
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	bonobo::mesh_data createQuad(float const width, float const height,
 	                             unsigned int const horizontal_split_count = 0u,
-	                             unsigned int const vertical_split_count = 0u);
+	                             unsigned int const vertical_split_count = 0u,
+	                             bonobo::vertex_format_t const format = bonobo::vertex_format_t::float32);
 
 	//! \brief Create a sphere for a given tesselation level and make it
 	//!        available to OpenGL.
@@ -59,11 +63,13 @@ namespace parametric_shapes
 	//!                             edge spanning the full 180°, with 1 you
 	//!                             get two edges (each spanning 90°); 1 is
 	//!                             the minimum for getting a 3-D shape.
+	//! @param format in which to store the vertex attributes
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	bonobo::mesh_data createSphere(float const radius,
 	                               unsigned int const longitude_split_count,
-	                               unsigned int const latitude_split_count);
+	                               unsigned int const latitude_split_count,
+	                               bonobo::vertex_format_t const format = bonobo::vertex_format_t::float32);
 
 	//! \brief Create a torus for a given tesselation level and make it
 	//!        available to OpenGL.
@@ -86,12 +92,14 @@ namespace parametric_shapes
 	//!                          with 1 you get two edges (each spanning
 	//!                          180°); 2 is the minimum for getting a 3-D
 	//!                          shape.
+	//! @param format in which to store the vertex attributes
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	bonobo::mesh_data createTorus(float const major_radius,
 	                              float const minor_radius,
 	                              unsigned int const major_split_count,
-	                              unsigned int const minor_split_count);
+	                              unsigned int const minor_split_count,
+	                              bonobo::vertex_format_t const format = bonobo::vertex_format_t::float32);
 
 	//! \brief Create a circle ring for a given tesselation level and make it
 	//!        available to OpenGL.
@@ -112,10 +120,12 @@ namespace parametric_shapes
 	//!                           single edge spanning the full spread,
 	//!                           with 1 you get two edges (each spanning
 	//!                           half the spread).
+	//! @param format in which to store the vertex attributes
 	//! @return wrapper around OpenGL objects' name containing the geometry
 	//!         data
 	bonobo::mesh_data createCircleRing(float const radius,
 	                                   float const spread_length,
 	                                   unsigned int const circle_split_count,
-	                                   unsigned int const spread_split_count);
+	                                   unsigned int const spread_split_count,
+	                                   bonobo::vertex_format_t const format = bonobo::vertex_format_t::float32);
 }
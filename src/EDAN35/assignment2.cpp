@@ -7,7 +7,9 @@
 #include "config.hpp"
 #include "core/Bonobo.h"
 #include "core/FPSCamera.h"
+#include "core/frustum.hpp"
 #include "core/helpers.hpp"
+#include "core/indirect_scene.hpp"
 #include "core/node.hpp"
 #include "core/opengl.hpp"
 #include "core/ShaderProgramManager.hpp"
@@ -18,10 +20,15 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <tinyfiledialogs.h>
 
+#include <algorithm>
 #include <array>
 #include <clocale>
+#include <cmath>
 #include <cstdlib>
+#include <functional>
+#include <limits>
 #include <stdexcept>
+#include <vector>
 
 namespace constant
 {
@@ -30,9 +37,26 @@ namespace constant
 
 	constexpr float  scale_lengths       = 100.0f; // The scene is expressed in centimetres rather than metres, hence the x100.
 
-	constexpr size_t lights_nb           = 4;
+	constexpr size_t max_lights_nb       = 1024;
+	constexpr size_t shadowed_lights_nb  = 4;    // The first lights, rotating in the middle of the scene, which cast shadows; has to match the define in EDAN35/fill_shadowmap.geom and EDAN35/shade_tiled_lights.frag.
 	constexpr float  light_intensity     = 72.0f * (scale_lengths * scale_lengths);
 	constexpr float  light_angle_falloff = glm::radians(37.0f);
+	constexpr float  light_cone_angle    = glm::radians(45.0f); // Half-angle of the cone from `loadCone()`.
+
+	// How far a shadowed light can move away from the pose its cached
+	// shadow map was rendered with, before that map gets re-rendered.
+	constexpr float  shadow_cache_distance_tolerance = 0.01f * scale_lengths;
+	constexpr float  shadow_cache_angle_tolerance    = glm::radians(0.25f);
+
+	// Tiled shading; these have to match the defines in
+	// EDAN35/cull_lights.comp and EDAN35/shade_tiled_lights.frag.
+	// Each tile list can hold every light, so that none gets dropped
+	// however many of them overlap a tile.
+	constexpr uint32_t light_tile_size     = 16;
+	constexpr uint32_t max_lights_per_tile = static_cast<uint32_t>(max_lights_nb);
+
+	// Work group size of EDAN35/build_hiz.comp; has to match its define.
+	constexpr uint32_t hiz_group_size      = 8;
 }
 
 namespace
@@ -45,11 +69,17 @@ namespace
 	enum class Texture : uint32_t {
 		DepthBuffer = 0u,
 		ShadowMap,
+		StaticShadowMaps,
 		GBufferDiffuse,
 		GBufferSpecular,
 		GBufferWorldSpaceNormal,
 		LightDiffuseContribution,
 		LightSpecularContribution,
+		CompactGBufferDiffuseSpecular,
+		CompactGBufferNormal,
+		CompactLightDiffuseContribution,
+		CompactLightSpecularContribution,
+		HiZ,
 		Result,
 		Count
 	};
@@ -69,7 +99,12 @@ namespace
 	enum class FBO : uint32_t {
 		GBuffer = 0u,
 		ShadowMap,
+		StaticShadowMaps,
+		ShadowMapLayer,
+		StaticShadowMapLayer,
 		LightAccumulation,
+		CompactGBuffer,
+		CompactLightAccumulation,
 		Resolve,
 		FinalWithDepth,
 		Count
@@ -77,11 +112,32 @@ namespace
 	using FBOs = std::array<GLuint, toU(FBO::Count)>;
 	FBOs createFramebufferObjects(Textures const& textures);
 
+	enum class Buffer : uint32_t {
+		Lights = 0u,
+		TileLightCounts,
+		TileLightIndices,
+		Count
+	};
+	using Buffers = std::array<GLuint, toU(Buffer::Count)>;
+	Buffers createBuffers(GLsizei framebuffer_width, GLsizei framebuffer_height);
+
+	//! \brief A spotlight, as laid out in the `LightBuffer` of
+	//!        EDAN35/cull_lights.comp and EDAN35/shade_tiled_lights.frag.
+	struct GPULight {
+		glm::vec4 position_range;
+		glm::vec4 direction_cos_outer;
+		glm::vec4 color_cos_inner;
+		glm::vec4 bounding_sphere;
+	};
+
 	enum class ElapsedTimeQuery : uint32_t {
-		GbufferGeneration = 0u,
-		ShadowMap0Generation,
-		Light0Accumulation = ShadowMap0Generation + static_cast<uint32_t>(constant::lights_nb),
-		Resolve = Light0Accumulation + static_cast<uint32_t>(constant::lights_nb),
+		DepthPrePass = 0u,
+		GbufferGeneration,
+		ShadowMapsGeneration,
+		Light0Accumulation,
+		LightCulling = Light0Accumulation + static_cast<uint32_t>(constant::shadowed_lights_nb),
+		TiledShading,
+		Resolve,
 		ConeWireframe,
 		GUI,
 		CopyToFramebuffer,
@@ -91,6 +147,13 @@ namespace
 	ElapsedTimeQueries createElapsedTimeQueries();
 
 	bonobo::mesh_data loadCone();
+
+	//! \brief Return the smallest pixel rectangle, as (x, y, width,
+	//!        height), enclosing the projection of |bounds|; it covers the
+	//!        whole framebuffer if |bounds| crosses the near plane, and is
+	//!        empty if |bounds| is off-screen.
+	glm::ivec4 computeScissorBox(bonobo::bounding_volume const& bounds, glm::mat4 const& world_to_clip,
+	                             GLsizei framebuffer_width, GLsizei framebuffer_height);
 } // namespace
 
 edan35::Assignment2::Assignment2(WindowManager& windowManager) :
@@ -117,19 +180,41 @@ edan35::Assignment2::~Assignment2()
 void
 edan35::Assignment2::run()
 {
-	// Load the geometry of Sponza
-	auto const sponza_geometry = bonobo::loadObjects(config::resources_path("sponza/sponza.obj"));
-	if (sponza_geometry.empty()) {
-		LogError("Failed to load the Sponza model");
-		return;
-	}
+	// Load the geometry of Sponza in the background; until it is ready,
+	// only the lights are rendered. Its vertices are quantized, which
+	// `fill_gbuffer.vert` decodes.
+	//
+	// With OpenGL 4.3, Sponza is also packed into shared buffers, and its
+	// textures into texture arrays, to be culled on the GPU and drawn with
+	// a few indirect multi-draws.
+	//
+	// Depth-only passes draw the opaque elements from position-only
+	// vertex streams, and the alpha-tested ones, which need their texture
+	// coordinates and opacity texture, separately.
 	std::vector<Node> sponza_elements;
-	sponza_elements.reserve(sponza_geometry.size());
-	for (auto const& shape : sponza_geometry) {
-		Node node;
-		node.set_geometry(shape);
-		sponza_elements.push_back(node);
-	}
+	std::vector<size_t> sponza_opaque_indices;
+	std::vector<size_t> sponza_alpha_tested_indices;
+	IndirectScene sponza_indirect;
+	bool is_sponza_loaded = false;
+	auto sponza_loading = bonobo::loadObjectsAsync(config::resources_path("sponza/sponza.obj"),
+	                                               [&sponza_elements,&sponza_opaque_indices,&sponza_alpha_tested_indices,&sponza_indirect](std::vector<bonobo::mesh_data> const& sponza_geometry){
+		if (sponza_geometry.empty()) {
+			LogError("Failed to load the Sponza model");
+			return;
+		}
+		sponza_elements.reserve(sponza_geometry.size());
+		std::vector<glm::mat4> sponza_transforms;
+		sponza_transforms.reserve(sponza_geometry.size());
+		for (auto const& shape : sponza_geometry) {
+			Node node;
+			node.set_geometry(shape);
+			(node.has_texture("opacity_texture") ? sponza_alpha_tested_indices : sponza_opaque_indices).push_back(sponza_elements.size());
+			sponza_elements.push_back(node);
+			sponza_transforms.push_back(node.get_transform().GetMatrix());
+		}
+		if (GLAD_GL_VERSION_4_3)
+			sponza_indirect.set_geometry(sponza_geometry, sponza_transforms);
+	}, bonobo::vertex_format_t::quantized, GLAD_GL_VERSION_4_3 != 0, true);
 
 	auto const cone_geometry = loadCone();
 	Node cone;
@@ -166,9 +251,34 @@ edan35::Assignment2::run()
 		return;
 	}
 
+	// The depth pre-pass reads the positions of the alpha-tested elements
+	// along with their texture coordinates, reusing the fragment shader
+	// of the shadow maps for the alpha test, and those of the opaque ones
+	// alone.
+	GLuint fill_depth_shader = 0u;
+	program_manager.CreateAndRegisterProgram("Fill depth",
+	                                         { { ShaderType::vertex, "EDAN35/fill_depth.vert" },
+	                                           { ShaderType::fragment, "EDAN35/fill_shadowmap.frag" } },
+	                                         fill_depth_shader);
+	if (fill_depth_shader == 0u) {
+		LogError("Failed to load depth filling shader");
+		return;
+	}
+
+	GLuint fill_depth_opaque_shader = 0u;
+	program_manager.CreateAndRegisterProgram("Fill depth (opaque)",
+	                                         { { ShaderType::vertex, "EDAN35/fill_depth_opaque.vert" },
+	                                           { ShaderType::fragment, "common/depth_only.frag" } },
+	                                         fill_depth_opaque_shader);
+	if (fill_depth_opaque_shader == 0u) {
+		LogError("Failed to load opaque depth filling shader");
+		return;
+	}
+
 	GLuint fill_shadowmap_shader = 0u;
 	program_manager.CreateAndRegisterProgram("Fill shadow map",
 	                                         { { ShaderType::vertex, "EDAN35/fill_shadowmap.vert" },
+	                                           { ShaderType::geometry, "EDAN35/fill_shadowmap.geom" },
 	                                           { ShaderType::fragment, "EDAN35/fill_shadowmap.frag" } },
 	                                         fill_shadowmap_shader);
 	if (fill_shadowmap_shader == 0u) {
@@ -176,6 +286,17 @@ edan35::Assignment2::run()
 		return;
 	}
 
+	GLuint fill_shadowmap_opaque_shader = 0u;
+	program_manager.CreateAndRegisterProgram("Fill shadow map (opaque)",
+	                                         { { ShaderType::vertex, "EDAN35/fill_shadowmap_opaque.vert" },
+	                                           { ShaderType::geometry, "EDAN35/fill_shadowmap.geom" },
+	                                           { ShaderType::fragment, "common/depth_only.frag" } },
+	                                         fill_shadowmap_opaque_shader);
+	if (fill_shadowmap_opaque_shader == 0u) {
+		LogError("Failed to load opaque shadowmap filling shader");
+		return;
+	}
+
 	GLuint accumulate_lights_shader = 0u;
 	program_manager.CreateAndRegisterProgram("Accumulate light",
 	                                         { { ShaderType::vertex, "EDAN35/accumulate_lights.vert" },
@@ -186,6 +307,16 @@ edan35::Assignment2::run()
 		return;
 	}
 
+	GLuint mark_light_volume_shader = 0u;
+	program_manager.CreateAndRegisterProgram("Mark light volume",
+	                                         { { ShaderType::vertex, "EDAN35/accumulate_lights.vert" },
+	                                           { ShaderType::fragment, "common/depth_only.frag" } },
+	                                         mark_light_volume_shader);
+	if (mark_light_volume_shader == 0u) {
+		LogError("Failed to load light volume marking shader");
+		return;
+	}
+
 	GLuint resolve_deferred_shader = 0u;
 	program_manager.CreateAndRegisterProgram("Resolve deferred",
 	                                         { { ShaderType::vertex, "EDAN35/resolve_deferred.vert" },
@@ -206,8 +337,169 @@ edan35::Assignment2::run()
 		return;
 	}
 
+	// Tiled shading culls all lights per screen tile in a compute pass,
+	// then accumulates them in a single full-screen pass; it needs
+	// OpenGL 4.3, otherwise each light is accumulated by rasterising its
+	// cone.
+	GLuint cull_lights_shader = 0u;
+	GLuint shade_tiled_lights_shader = 0u;
+	if (GLAD_GL_VERSION_4_3) {
+		program_manager.CreateAndRegisterComputeProgram("Cull lights",
+		                                                "EDAN35/cull_lights.comp",
+		                                                cull_lights_shader);
+		program_manager.CreateAndRegisterProgram("Shade tiled lights",
+		                                         { { ShaderType::vertex, "common/fullscreen.vert" },
+		                                           { ShaderType::fragment, "EDAN35/shade_tiled_lights.frag" } },
+		                                         shade_tiled_lights_shader);
+	}
+	bool const is_tiled_shading_supported = cull_lights_shader != 0u && shade_tiled_lights_shader != 0u;
+	if (!is_tiled_shading_supported)
+		LogInfo("Tiled shading needs OpenGL 4.3: lights will be accumulated one cone at a time, and limited to %zu.", constant::shadowed_lights_nb);
+
+	// GPU-driven submission culls Sponza in a compute pass, which writes
+	// the commands of `glMultiDrawElementsIndirect()`; it also needs
+	// OpenGL 4.3.
+	GLuint cull_indirect_draws_shader = 0u;
+	GLuint fill_gbuffer_indirect_shader = 0u;
+	GLuint fill_shadowmap_indirect_shader = 0u;
+	GLuint fill_depth_indirect_shader = 0u;
+	if (GLAD_GL_VERSION_4_3) {
+		program_manager.CreateAndRegisterComputeProgram("Cull indirect draws",
+		                                                "common/cull_indirect_draws.comp",
+		                                                cull_indirect_draws_shader);
+		program_manager.CreateAndRegisterProgram("Fill G-Buffer (indirect)",
+		                                         { { ShaderType::vertex, "EDAN35/fill_gbuffer_indirect.vert" },
+		                                           { ShaderType::fragment, "EDAN35/fill_gbuffer_indirect.frag" } },
+		                                         fill_gbuffer_indirect_shader);
+		program_manager.CreateAndRegisterProgram("Fill shadow map (indirect)",
+		                                         { { ShaderType::vertex, "EDAN35/fill_shadowmap_indirect.vert" },
+		                                           { ShaderType::geometry, "EDAN35/fill_shadowmap.geom" },
+		                                           { ShaderType::fragment, "EDAN35/fill_shadowmap_indirect.frag" } },
+		                                         fill_shadowmap_indirect_shader);
+		program_manager.CreateAndRegisterProgram("Fill depth (indirect)",
+		                                         { { ShaderType::vertex, "EDAN35/fill_depth_indirect.vert" },
+		                                           { ShaderType::fragment, "EDAN35/fill_shadowmap_indirect.frag" } },
+		                                         fill_depth_indirect_shader);
+	}
+	bool const is_gpu_driven_supported = cull_indirect_draws_shader != 0u
+	                                  && fill_gbuffer_indirect_shader != 0u
+	                                  && fill_shadowmap_indirect_shader != 0u
+	                                  && fill_depth_indirect_shader != 0u;
+	if (!is_gpu_driven_supported)
+		LogInfo("GPU-driven submission needs OpenGL 4.3: Sponza will be culled and drawn one element at a time.");
+
+	// Occlusion culling tests the elements drawn with GPU-driven
+	// submission against a depth pyramid, built in a compute pass.
+	GLuint build_hiz_shader = 0u;
+	if (is_gpu_driven_supported) {
+		program_manager.CreateAndRegisterComputeProgram("Build Hi-Z",
+		                                                "EDAN35/build_hiz.comp",
+		                                                build_hiz_shader);
+	}
+	bool const is_occlusion_culling_supported = build_hiz_shader != 0u;
+
+	// Which passes are available depends on the programs above, which were
+	// therefore built right away; reloads are built in the background
+	// instead, the current programs being used until then. Programs are
+	// rebuilt as soon as one of their files is saved, and R rebuilds them
+	// all.
+	program_manager.SetCompilationMode(ShaderProgramManager::CompilationMode::asynchronous);
+	program_manager.EnableHotReload();
+
 	auto const set_uniforms = [](GLuint /*program*/){};
 
+	//
+	// Frustum culling of Sponza, for the camera as well as for the lights
+	//
+	std::vector<bonobo::bounding_volume> sponza_world_bounds;
+	bool use_frustum_culling = true;
+	size_t gbuffer_culled_nb = 0u;
+	size_t shadowmap_culled_nb = 0u;
+	size_t gbuffer_indirect_nb = 0u;
+	size_t shadowmap_indirect_nb = 0u;
+
+	// With GPU-driven submission, the elements packed in `sponza_indirect`
+	// are culled on the GPU, and the culled counts above only cover the
+	// others; the camera and the shadow maps use separate sets of
+	// commands.
+	bool use_gpu_driven_submission = is_gpu_driven_supported;
+	constexpr size_t camera_commands_set = 0u;
+	constexpr size_t shadowmap_commands_set = 1u;
+	auto const is_drawn_indirectly = [&sponza_indirect,&use_gpu_driven_submission](size_t j){
+		return use_gpu_driven_submission && sponza_indirect.is_packed(j);
+	};
+
+	// Occlusion culling happens in two phases. The first one draws the
+	// elements which were visible in the depth pyramid built from the
+	// previous frame, `Texture::HiZ`, as seen by |hiz_world_to_clip|.
+	// The pyramid is then rebuilt from the resulting depth buffer, and the
+	// second phase draws the elements the first one rejected and which
+	// turn out to be visible after all, e.g. because they were disoccluded
+	// by the camera moving. The rebuilt pyramid is kept for the next
+	// frame.
+	bool use_occlusion_culling = is_occlusion_culling_supported;
+	bool is_hiz_valid = false;
+	glm::mat4 hiz_world_to_clip(1.0f);
+	constexpr size_t camera_late_commands_set = 2u;
+	size_t gbuffer_early_occluded_nb = 0u;
+	size_t gbuffer_occluded_nb = 0u;
+	bool is_late_phase_drawn = false;
+
+	// The depth pre-pass fills the depth buffer first, culling Sponza as
+	// the G-buffer pass would; the G-buffer pass then reuses that culling
+	// and only writes the fragments whose depth equals the stored one,
+	// i.e. each pixel at most once.
+	bool use_depth_prepass = false;
+
+	// Render the elements j of Sponza for which |should_render(j)| holds,
+	// and return how many were skipped.
+	auto const render_sponza = [&sponza_elements](glm::mat4 const& world_to_clip, GLuint program,
+	                                              std::function<bool (size_t)> const& should_render,
+	                                              std::function<void (GLuint)> const& program_set_uniforms){
+		size_t culled_nb = 0u;
+		for (size_t j = 0u; j < sponza_elements.size(); ++j) {
+			if (!should_render(j)) {
+				++culled_nb;
+				continue;
+			}
+			auto const& element = sponza_elements[j];
+			element.render(world_to_clip, element.get_transform().GetMatrix(), program, program_set_uniforms);
+		}
+		return culled_nb;
+	};
+
+	// Same as `render_sponza()`, for depth-only passes: the opaque
+	// elements are drawn with `Node::render_depth()` and |opaque_program|,
+	// bound and set up once for all of them, and the alpha-tested ones
+	// with |alpha_tested_program|, as usual.
+	auto const render_sponza_depth = [&sponza_elements,&sponza_opaque_indices,&sponza_alpha_tested_indices]
+	                                 (glm::mat4 const& world_to_clip, GLuint opaque_program, GLuint alpha_tested_program,
+	                                  std::function<bool (size_t)> const& should_render,
+	                                  std::function<void (GLuint)> const& program_set_uniforms){
+		size_t culled_nb = 0u;
+		glUseProgram(opaque_program);
+		program_set_uniforms(opaque_program);
+		for (auto const j : sponza_opaque_indices) {
+			if (!should_render(j)) {
+				++culled_nb;
+				continue;
+			}
+			auto const& element = sponza_elements[j];
+			element.render_depth(world_to_clip, element.get_transform().GetMatrix(), opaque_program);
+		}
+		glUseProgram(0u);
+
+		for (auto const j : sponza_alpha_tested_indices) {
+			if (!should_render(j)) {
+				++culled_nb;
+				continue;
+			}
+			auto const& element = sponza_elements[j];
+			element.render(world_to_clip, element.get_transform().GetMatrix(), alpha_tested_program, program_set_uniforms);
+		}
+		return culled_nb;
+	};
+
 	int framebuffer_width, framebuffer_height;
 	glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
 
@@ -219,6 +511,9 @@ edan35::Assignment2::run()
 	FBOs const fbos = createFramebufferObjects(textures);
 	Samplers const samplers = createSamplers();
 	ElapsedTimeQueries const elapsed_time_queries = createElapsedTimeQueries();
+	Buffers const buffers = is_tiled_shading_supported ? createBuffers(framebuffer_width, framebuffer_height) : Buffers{};
+	auto const tiles_per_row = (static_cast<uint32_t>(framebuffer_width) + constant::light_tile_size - 1u) / constant::light_tile_size;
+	auto const tiles_per_column = (static_cast<uint32_t>(framebuffer_height) + constant::light_tile_size - 1u) / constant::light_tile_size;
 
 	auto const bind_texture_with_sampler = [](GLenum target, unsigned int slot, GLuint program, std::string const& name, GLuint texture, GLuint sampler){
 		glActiveTexture(GL_TEXTURE0 + slot);
@@ -231,30 +526,194 @@ edan35::Assignment2::run()
 	//
 	// Setup lights properties
 	//
-	std::array<TRSTransformf, constant::lights_nb> lightTransforms;
-	std::array<glm::vec3, constant::lights_nb> lightColors;
-	int lights_nb = static_cast<int>(constant::lights_nb);
-	bool are_lights_paused = false;
-
-	for (size_t i = 0; i < static_cast<size_t>(lights_nb); ++i) {
-		lightTransforms[i].SetTranslate(glm::vec3(0.0f, 1.25f, 0.0f) * constant::scale_lengths);
-		lightColors[i] = glm::vec3(0.5f + 0.5f * (static_cast<float>(rand()) / static_cast<float>(RAND_MAX)),
-		                           0.5f + 0.5f * (static_cast<float>(rand()) / static_cast<float>(RAND_MAX)),
-		                           0.5f + 0.5f * (static_cast<float>(rand()) / static_cast<float>(RAND_MAX)));
-	}
-
 	float const lightProjectionNearPlane = 0.01f * constant::scale_lengths;
 	float const lightProjectionFarPlane = 20.0f * constant::scale_lengths;
 	auto lightProjection = glm::perspective(0.5f * glm::pi<float>(),
 	                                        static_cast<float>(constant::shadowmap_res_x) / static_cast<float>(constant::shadowmap_res_y),
 	                                        lightProjectionNearPlane, lightProjectionFarPlane);
 
-	TRSTransformf coneScaleTransform;
-	coneScaleTransform.SetScale(glm::vec3(lightProjectionFarPlane * 0.8f));
-
 	TRSTransformf lightOffsetTransform;
 	lightOffsetTransform.SetTranslate(glm::vec3(0.0f, 0.0f, -0.4f) * constant::scale_lengths);
 
+	// The shadowed lights rotate in the middle of the scene, and reach as
+	// far as their shadow maps; the other ones are scattered around, with
+	// a much shorter range.
+	std::vector<TRSTransformf> lightTransforms(constant::max_lights_nb);
+	std::vector<glm::vec3> lightColors(constant::max_lights_nb);
+	std::vector<float> lightRanges(constant::max_lights_nb);
+	int lights_nb = static_cast<int>(constant::shadowed_lights_nb);
+	bool are_lights_paused = false;
+	bool use_tiled_shading = is_tiled_shading_supported;
+
+	// When lights are accumulated one cone at a time, each cone can first
+	// mark in the stencil buffer the pixels whose depth lies inside it,
+	// within the rectangle its bounds project to; only those pixels are
+	// then shaded, rather than all those the cone covers.
+	bool use_light_volume_stencil = true;
+
+	auto const random_unit = [](){
+		return static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+	};
+	for (size_t i = 0; i < constant::max_lights_nb; ++i) {
+		if (i < constant::shadowed_lights_nb) {
+			lightTransforms[i].SetTranslate(glm::vec3(0.0f, 1.25f, 0.0f) * constant::scale_lengths);
+			lightRanges[i] = lightProjectionFarPlane * 0.8f;
+		} else {
+			lightTransforms[i].SetTranslate(glm::vec3(-11.0f + 22.0f * random_unit(),
+			                                          0.5f + 6.0f * random_unit(),
+			                                          -4.0f + 8.0f * random_unit()) * constant::scale_lengths);
+			lightRanges[i] = (2.0f + 2.0f * random_unit()) * constant::scale_lengths;
+		}
+		lightColors[i] = glm::vec3(0.5f + 0.5f * random_unit(),
+		                           0.5f + 0.5f * random_unit(),
+		                           0.5f + 0.5f * random_unit());
+	}
+
+	// Transforms the cone from `loadCone()` onto the volume lit by light i.
+	auto const get_light_cone_matrix = [&lightTransforms,&lightRanges,&lightOffsetTransform](size_t i){
+		return lightTransforms[i].GetMatrix() * lightOffsetTransform.GetMatrix() * glm::scale(glm::mat4(1.0f), glm::vec3(lightRanges[i]));
+	};
+
+	// Smallest sphere enclosing a cone of half-angle
+	// `constant::light_cone_angle`, relative to its apex and length.
+	auto const cone_sphere_offset = constant::light_cone_angle >= glm::quarter_pi<float>() ? 1.0f : 0.5f / (std::cos(constant::light_cone_angle) * std::cos(constant::light_cone_angle));
+	auto const cone_sphere_radius = constant::light_cone_angle >= glm::quarter_pi<float>() ? std::tan(constant::light_cone_angle) : cone_sphere_offset;
+	std::vector<GPULight> gpu_lights;
+	gpu_lights.reserve(constant::max_lights_nb);
+
+	// All shadow maps are rendered in a single pass, each light using the
+	// layer of `Texture::ShadowMap` with the same index.
+	std::array<glm::mat4, constant::shadowed_lights_nb> shadow_world_to_clip_matrices;
+	shadow_world_to_clip_matrices.fill(glm::mat4(1.0f));
+	std::vector<Frustum> shadow_frusta;
+	shadow_frusta.reserve(constant::shadowed_lights_nb);
+	std::vector<Frustum> dirty_shadow_frusta;
+	dirty_shadow_frusta.reserve(constant::shadowed_lights_nb);
+
+	// Shadows of static casters are cached in `Texture::StaticShadowMaps`,
+	// and only re-rendered when a light moves further than the tolerances
+	// from the pose they were rendered with; meanwhile, lighting keeps
+	// using that pose's matrix, in `shadow_world_to_clip_matrices`.
+	// Dynamic casters are drawn every frame into `Texture::ShadowMap`, on
+	// top of a copy of the cached maps.
+	bool use_shadow_cache = true;
+	float shadow_cache_distance_tolerance = constant::shadow_cache_distance_tolerance;
+	float shadow_cache_angle_tolerance = constant::shadow_cache_angle_tolerance;
+	std::array<bool, constant::shadowed_lights_nb> is_shadow_cache_valid{};
+	std::array<glm::mat4, constant::shadowed_lights_nb> cached_light_world_matrices;
+	cached_light_world_matrices.fill(glm::mat4(1.0f));
+	std::vector<bool> is_sponza_element_dynamic;
+	std::vector<bonobo::bounding_volume> invalidated_bounds;
+	size_t dynamic_casters_nb = 0u;
+	size_t shadowmaps_reused_nb = 0u;
+	size_t shadowmaps_rendered_nb = 0u;
+
+	auto const is_visible_from_any = [&sponza_world_bounds,&use_frustum_culling](std::vector<Frustum> const& frusta, size_t j){
+		return !use_frustum_culling
+		    || std::any_of(frusta.begin(), frusta.end(),
+		                   [&sponza_world_bounds,j](Frustum const& frustum){ return frustum.intersects(sponza_world_bounds[j]); });
+	};
+
+	// Fill `Texture::HiZ` from the depth buffer, each level keeping the
+	// furthest depth of the level above it.
+	auto const build_hiz = [&build_hiz_shader,&bind_texture_with_sampler,&textures,&samplers,framebuffer_width,framebuffer_height](){
+		utils::opengl::debug::beginDebugGroup("Build Hi-Z");
+		glUseProgram(build_hiz_shader);
+
+		GLint level = 0;
+		for (GLsizei width = framebuffer_width, height = framebuffer_height; ; width = std::max(width / 2, 1), height = std::max(height / 2, 1), ++level) {
+			if (level == 0) {
+				bind_texture_with_sampler(GL_TEXTURE_2D, 0, build_hiz_shader, "source_texture", textures[toU(Texture::DepthBuffer)], samplers[toU(Sampler::Nearest)]);
+				glUniform1i(glGetUniformLocation(build_hiz_shader, "source_level"), 0);
+			} else {
+				bind_texture_with_sampler(GL_TEXTURE_2D, 0, build_hiz_shader, "source_texture", textures[toU(Texture::HiZ)], 0u);
+				glUniform1i(glGetUniformLocation(build_hiz_shader, "source_level"), level - 1);
+			}
+			glBindImageTexture(0u, textures[toU(Texture::HiZ)], level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+			glUniform1i(glGetUniformLocation(build_hiz_shader, "destination_image"), 0);
+			glDispatchCompute((static_cast<GLuint>(width) + constant::hiz_group_size - 1u) / constant::hiz_group_size,
+			                  (static_cast<GLuint>(height) + constant::hiz_group_size - 1u) / constant::hiz_group_size,
+			                  1u);
+
+			// The next level reads this one, and so does the culling.
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			if (width == 1 && height == 1)
+				break;
+		}
+
+		glBindImageTexture(0u, 0u, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glBindTexture(GL_TEXTURE_2D, 0u);
+		glUseProgram(0u);
+		utils::opengl::debug::endDebugGroup();
+	};
+
+	// Render Sponza from the camera, using |indirect_program| for the
+	// elements drawn with GPU-driven submission and |program| for the
+	// others, and return how many of the latter were culled; for
+	// depth-only passes, |opaque_program| is used for the opaque ones,
+	// see `render_sponza_depth()`, and is 0 otherwise. If |should_cull| is
+	// false, the indirect draw commands of the previous call are reused,
+	// so that both passes draw the same elements.
+	auto const render_camera_view = [this,&sponza_indirect,&use_gpu_driven_submission,&use_frustum_culling,&use_occlusion_culling,
+	                                 &is_hiz_valid,&hiz_world_to_clip,&is_late_phase_drawn,&textures,&cull_indirect_draws_shader,
+	                                 &build_hiz,&render_sponza,&render_sponza_depth,&sponza_world_bounds,&is_drawn_indirectly]
+	                                (GLuint program, GLuint opaque_program, GLuint indirect_program,
+	                                 std::function<void (GLuint)> const& program_set_uniforms, bool should_cull){
+		if (use_gpu_driven_submission && !should_cull) {
+			sponza_indirect.render(mCamera.GetWorldToClipMatrix(), indirect_program,
+			                       program_set_uniforms, camera_commands_set);
+			if (is_late_phase_drawn)
+				sponza_indirect.render(mCamera.GetWorldToClipMatrix(), indirect_program,
+				                       program_set_uniforms, camera_late_commands_set);
+		} else if (use_gpu_driven_submission) {
+			auto const camera_world_to_clip_matrices = use_frustum_culling ? std::vector<glm::mat4>{ mCamera.GetWorldToClipMatrix() } : std::vector<glm::mat4>{};
+
+			IndirectScene::occlusion_test early_occlusion;
+			if (use_occlusion_culling && is_hiz_valid) {
+				early_occlusion.hiz_texture = textures[toU(Texture::HiZ)];
+				early_occlusion.hiz_world_to_clip = hiz_world_to_clip;
+			}
+			sponza_indirect.cull(cull_indirect_draws_shader, camera_world_to_clip_matrices,
+			                     camera_commands_set, early_occlusion);
+			glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+			sponza_indirect.render(mCamera.GetWorldToClipMatrix(), indirect_program,
+			                       program_set_uniforms, camera_commands_set);
+
+			is_late_phase_drawn = false;
+			if (use_occlusion_culling) {
+				build_hiz();
+				hiz_world_to_clip = mCamera.GetWorldToClipMatrix();
+
+				// Without a pyramid from the previous frame, the first
+				// phase drew everything in view, and there is nothing
+				// left to draw.
+				if (is_hiz_valid) {
+					IndirectScene::occlusion_test late_occlusion;
+					late_occlusion.hiz_texture = textures[toU(Texture::HiZ)];
+					late_occlusion.hiz_world_to_clip = hiz_world_to_clip;
+					late_occlusion.drawn_commands_set = camera_commands_set;
+					sponza_indirect.cull(cull_indirect_draws_shader, camera_world_to_clip_matrices,
+					                     camera_late_commands_set, late_occlusion);
+					glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+					sponza_indirect.render(mCamera.GetWorldToClipMatrix(), indirect_program,
+					                       program_set_uniforms, camera_late_commands_set);
+					is_late_phase_drawn = true;
+				}
+				is_hiz_valid = true;
+			}
+		}
+
+		Frustum const camera_frustum(mCamera.GetWorldToClipMatrix());
+		auto const is_visible = [&camera_frustum,&sponza_world_bounds,&use_frustum_culling,&is_drawn_indirectly](size_t j){
+			return !is_drawn_indirectly(j)
+			    && (!use_frustum_culling || camera_frustum.intersects(sponza_world_bounds[j]));
+		};
+		auto const indirect_nb = use_gpu_driven_submission ? sponza_indirect.get_objects_nb() : 0u;
+		if (opaque_program != 0u)
+			return render_sponza_depth(mCamera.GetWorldToClipMatrix(), opaque_program, program, is_visible, program_set_uniforms) - indirect_nb;
+		return render_sponza(mCamera.GetWorldToClipMatrix(), program, is_visible, program_set_uniforms) - indirect_nb;
+	};
+
 
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClearDepthf(1.0f);
@@ -265,6 +724,15 @@ edan35::Assignment2::run()
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
 
 
+	// The compact G-buffer packs the specular intensity in the alpha of
+	// the diffuse target, stores octahedron-encoded normals in RG16, and
+	// accumulates lights in R11G11B10F.
+	bool use_compact_gbuffer = false;
+	auto const gbuffer_set_uniforms = [&use_compact_gbuffer](GLuint program){
+		glUniform1i(glGetUniformLocation(program, "use_compact_gbuffer"), use_compact_gbuffer ? 1 : 0);
+	};
+
+
 	auto seconds_nb = 0.0f;
 	std::array<GLuint64, toU(ElapsedTimeQuery::Count)> pass_elapsed_times;
 	auto lastTime = std::chrono::high_resolution_clock::now();
@@ -273,7 +741,6 @@ edan35::Assignment2::run()
 
 	bool show_logs = true;
 	bool show_gui = true;
-	bool shader_reload_failed = false;
 	bool copy_elapsed_times = true;
 	bool first_frame = true;
 	bool show_basis = false;
@@ -294,14 +761,26 @@ edan35::Assignment2::run()
 		inputHandler.Advance();
 		mCamera.Update(deltaTimeUs, inputHandler);
 
-		if (inputHandler.GetKeycodeState(GLFW_KEY_R) & JUST_PRESSED) {
+		if (!is_sponza_loaded)
+			is_sponza_loaded = sponza_loading.poll();
+
+		// Reloaded programs are swapped in as they get built, possibly over
+		// several frames; those which fail to build keep their previous
+		// version.
+		bool shader_reload_failed = false;
+		if (inputHandler.GetKeycodeState(GLFW_KEY_R) & JUST_PRESSED)
 			shader_reload_failed = !program_manager.ReloadAllPrograms();
-			if (shader_reload_failed)
-				tinyfd_notifyPopup("Shader Program Reload Error",
-				                   "An error occurred while reloading shader programs; see the logs for details.\n"
-				                   "Rendering is suspended until the issue is solved. Once fixed, just reload the shaders again.",
-				                   "error");
+		auto const builds_nb = program_manager.GetBuildsNb();
+		shader_reload_failed |= !program_manager.Update();
+		if (program_manager.GetBuildsNb() != builds_nb) {
+			is_shadow_cache_valid.fill(false);
+			is_hiz_valid = false;
 		}
+		if (shader_reload_failed)
+			tinyfd_notifyPopup("Shader Program Reload Error",
+			                   "An error occurred while reloading shader programs; see the logs for details.\n"
+			                   "The previous version of the affected programs is used until the issue is solved.",
+			                   "error");
 		if (inputHandler.GetKeycodeState(GLFW_KEY_F3) & JUST_RELEASED)
 			show_logs = !show_logs;
 		if (inputHandler.GetKeycodeState(GLFW_KEY_F2) & JUST_RELEASED)
@@ -314,6 +793,10 @@ edan35::Assignment2::run()
 			for (GLuint i = 0; i < pass_elapsed_times.size(); ++i) {
 				glGetQueryObjectui64v(elapsed_time_queries[i], GL_QUERY_RESULT, pass_elapsed_times.data() + i);
 			}
+			if (use_gpu_driven_submission && use_occlusion_culling) {
+				gbuffer_early_occluded_nb = sponza_indirect.get_occluded_nb(camera_commands_set);
+				gbuffer_occluded_nb = sponza_indirect.get_occluded_nb(camera_late_commands_set);
+			}
 		}
 
 
@@ -321,55 +804,299 @@ edan35::Assignment2::run()
 			lightTransforms[i].SetRotate(seconds_nb * 0.1f + i * 1.57f, glm::vec3(0.0f, 1.0f, 0.0f));
 		}
 
+		// Elements whose bounds changed since the previous frame are
+		// dynamic shadow casters. When an element switches between static
+		// and dynamic, the cached shadow maps which contain it, or should
+		// now contain it, are invalidated.
+		invalidated_bounds.clear();
+		if (sponza_world_bounds.size() != sponza_elements.size()) {
+			sponza_world_bounds.resize(sponza_elements.size());
+			is_sponza_element_dynamic.assign(sponza_elements.size(), false);
+			for (size_t j = 0u; j < sponza_elements.size(); ++j)
+				sponza_world_bounds[j] = sponza_elements[j].get_world_bounds();
+			is_shadow_cache_valid.fill(false);
+		} else {
+			for (size_t j = 0u; j < sponza_elements.size(); ++j) {
+				auto const bounds = sponza_elements[j].get_world_bounds();
+				auto const& previous_bounds = sponza_world_bounds[j];
+				bool const is_dynamic = bounds.min_corner != previous_bounds.min_corner
+				                     || bounds.max_corner != previous_bounds.max_corner;
+				if (is_dynamic != is_sponza_element_dynamic[j]) {
+					invalidated_bounds.push_back(is_dynamic ? previous_bounds : bounds);
+					is_sponza_element_dynamic[j] = is_dynamic;
+				}
+				if (is_dynamic)
+					sponza_indirect.set_transform(j, sponza_elements[j].get_transform().GetMatrix());
+				sponza_world_bounds[j] = bounds;
+			}
+		}
+		dynamic_casters_nb = static_cast<size_t>(std::count(is_sponza_element_dynamic.begin(), is_sponza_element_dynamic.end(), true));
+		auto const shadow_texture = textures[toU(dynamic_casters_nb > 0u ? Texture::ShadowMap : Texture::StaticShadowMaps)];
 
-		if (!shader_reload_failed) {
-			//
-			// Pass 1: Render scene into the g-buffer
-			//
-			utils::opengl::debug::beginDebugGroup("Fill G-buffer");
-			glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::GbufferGeneration)]);
+		auto const gbuffer_fbo = fbos[toU(use_compact_gbuffer ? FBO::CompactGBuffer : FBO::GBuffer)];
+		auto const light_accumulation_fbo = fbos[toU(use_compact_gbuffer ? FBO::CompactLightAccumulation : FBO::LightAccumulation)];
+		auto const gbuffer_diffuse_texture = textures[toU(use_compact_gbuffer ? Texture::CompactGBufferDiffuseSpecular : Texture::GBufferDiffuse)];
+		auto const gbuffer_specular_texture = textures[toU(use_compact_gbuffer ? Texture::CompactGBufferDiffuseSpecular : Texture::GBufferSpecular)];
+		auto const gbuffer_normal_texture = textures[toU(use_compact_gbuffer ? Texture::CompactGBufferNormal : Texture::GBufferWorldSpaceNormal)];
+		auto const light_diffuse_texture = textures[toU(use_compact_gbuffer ? Texture::CompactLightDiffuseContribution : Texture::LightDiffuseContribution)];
+		auto const light_specular_texture = textures[toU(use_compact_gbuffer ? Texture::CompactLightSpecularContribution : Texture::LightSpecularContribution)];
 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::GBuffer)]);
-			glViewport(0, 0, framebuffer_width, framebuffer_height);
-			glClear(GL_DEPTH_BUFFER_BIT);
-			// XXX: Is any other clearing needed?
 
-			for (auto const& element : sponza_elements)
-				element.render(mCamera.GetWorldToClipMatrix(), element.get_transform().GetMatrix(), fill_gbuffer_shader, set_uniforms);
+		gbuffer_indirect_nb = use_gpu_driven_submission ? sponza_indirect.get_objects_nb() : 0u;
+
+		//
+		// Pass 1.0: Fill the depth buffer, if using a depth pre-pass
+		//
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gbuffer_fbo);
+		glViewport(0, 0, framebuffer_width, framebuffer_height);
+		if (use_depth_prepass) {
+			utils::opengl::debug::beginDebugGroup("Depth pre-pass");
+			glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::DepthPrePass)]);
+
+			glClear(GL_DEPTH_BUFFER_BIT);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			gbuffer_culled_nb = render_camera_view(fill_depth_shader, fill_depth_opaque_shader, fill_depth_indirect_shader, set_uniforms, true);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
 			glEndQuery(GL_TIME_ELAPSED);
 			utils::opengl::debug::endDebugGroup();
+		}
+
+		//
+		// Pass 1.1: Render scene into the g-buffer
+		//
+		utils::opengl::debug::beginDebugGroup("Fill G-buffer");
+		glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::GbufferGeneration)]);
+
+		if (use_depth_prepass) {
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+			render_camera_view(fill_gbuffer_shader, 0u, fill_gbuffer_indirect_shader, gbuffer_set_uniforms, false);
+			glDepthMask(GL_TRUE);
+			glDepthFunc(GL_LESS);
+		} else {
+			glClear(GL_DEPTH_BUFFER_BIT);
+			// XXX: Is any other clearing needed?
+			gbuffer_culled_nb = render_camera_view(fill_gbuffer_shader, 0u, fill_gbuffer_indirect_shader, gbuffer_set_uniforms, true);
+		}
+
+		glEndQuery(GL_TIME_ELAPSED);
+		utils::opengl::debug::endDebugGroup();
+
+
 
+		//
+		// Pass 2: Generate shadowmaps and accumulate lights' contribution
+		//
+		auto const shadowed_lights_nb = std::min(static_cast<size_t>(lights_nb), constant::shadowed_lights_nb);
+		GLint dirty_lights_mask = 0;
+		shadow_frusta.clear();
+		dirty_shadow_frusta.clear();
+		for (size_t i = 0; i < shadowed_lights_nb; ++i) {
+			auto const light_world_matrix = lightTransforms[i].GetMatrix() * lightOffsetTransform.GetMatrix();
+			auto const& cached_world_matrix = cached_light_world_matrices[i];
+			auto const min_cos_angle = std::cos(shadow_cache_angle_tolerance);
+			bool const has_moved = glm::distance(glm::vec3(light_world_matrix[3]), glm::vec3(cached_world_matrix[3])) > shadow_cache_distance_tolerance
+			                    || glm::dot(glm::normalize(glm::vec3(light_world_matrix[1])), glm::normalize(glm::vec3(cached_world_matrix[1]))) < min_cos_angle
+			                    || glm::dot(glm::normalize(glm::vec3(light_world_matrix[2])), glm::normalize(glm::vec3(cached_world_matrix[2]))) < min_cos_angle;
+			bool const is_invalidated = !invalidated_bounds.empty()
+			                         && std::any_of(invalidated_bounds.begin(), invalidated_bounds.end(),
+			                                        [&shadow_world_to_clip_matrices,i](bonobo::bounding_volume const& bounds){
+			                                        	return Frustum(shadow_world_to_clip_matrices[i]).intersects(bounds);
+			                                        });
+			if (!use_shadow_cache || !is_shadow_cache_valid[i] || has_moved || is_invalidated) {
+				auto const light_view_matrix = lightOffsetTransform.GetMatrixInverse() * lightTransforms[i].GetMatrixInverse();
+				shadow_world_to_clip_matrices[i] = lightProjection * light_view_matrix;
+				cached_light_world_matrices[i] = light_world_matrix;
+				is_shadow_cache_valid[i] = true;
+				dirty_lights_mask |= 1 << i;
+				dirty_shadow_frusta.emplace_back(shadow_world_to_clip_matrices[i]);
+			}
+			shadow_frusta.emplace_back(shadow_world_to_clip_matrices[i]);
+		}
+		shadowmaps_rendered_nb = dirty_shadow_frusta.size();
+		shadowmaps_reused_nb = shadowed_lights_nb - shadowmaps_rendered_nb;
+
+		//
+		// Pass 2.0: Generate the shadow maps of all lights at once,
+		//           fill_shadowmap.geom replicating each triangle
+		//           into the layer of each light selected by
+		//           `lights_mask`; elements are only culled if
+		//           outside of all those lights' frusta.
+		//
+		utils::opengl::debug::beginDebugGroup("Create shadow maps");
+		glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::ShadowMapsGeneration)]);
+
+		auto const shadowmap_set_uniforms = [&shadow_world_to_clip_matrices](GLint lights_mask){
+			return [&shadow_world_to_clip_matrices,lights_mask](GLuint program){
+				glUniformMatrix4fv(glGetUniformLocation(program, "lights_world_to_clip"), static_cast<GLsizei>(shadow_world_to_clip_matrices.size()), GL_FALSE,
+				                   glm::value_ptr(shadow_world_to_clip_matrices.front()));
+				glUniform1i(glGetUniformLocation(program, "lights_mask"), lights_mask);
+			};
+		};
+
+		// Re-render the static casters of the lights which moved.
+		// Clearing a layered attachment clears all of its layers, so
+		// the layers being re-rendered are cleared one at a time.
+		if (dirty_lights_mask != 0) {
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::StaticShadowMapLayer)]);
+			for (size_t i = 0; i < shadowed_lights_nb; ++i) {
+				if ((dirty_lights_mask & (1 << i)) == 0)
+					continue;
+				glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[toU(Texture::StaticShadowMaps)], 0, static_cast<GLint>(i));
+				glClear(GL_DEPTH_BUFFER_BIT);
+			}
+
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::StaticShadowMaps)]);
+			glViewport(0, 0, constant::shadowmap_res_x, constant::shadowmap_res_y);
+
+			// The packed elements can only be drawn indirectly when
+			// they are all static, as commands do not tell static
+			// and dynamic elements apart.
+			bool const draw_static_indirectly = use_gpu_driven_submission && dynamic_casters_nb == 0u;
+			shadowmap_indirect_nb = draw_static_indirectly ? sponza_indirect.get_objects_nb() : 0u;
+			if (draw_static_indirectly) {
+				std::vector<glm::mat4> dirty_world_to_clip_matrices;
+				if (use_frustum_culling) {
+					for (size_t i = 0; i < shadowed_lights_nb; ++i)
+						if ((dirty_lights_mask & (1 << i)) != 0)
+							dirty_world_to_clip_matrices.push_back(shadow_world_to_clip_matrices[i]);
+				}
+				sponza_indirect.cull(cull_indirect_draws_shader, dirty_world_to_clip_matrices, shadowmap_commands_set);
+				glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+				sponza_indirect.render(shadow_world_to_clip_matrices.front(), fill_shadowmap_indirect_shader,
+				                       shadowmap_set_uniforms(dirty_lights_mask), shadowmap_commands_set);
+			}
+			shadowmap_culled_nb = render_sponza_depth(shadow_world_to_clip_matrices.front(), fill_shadowmap_opaque_shader, fill_shadowmap_shader,
+			                                          [&is_sponza_element_dynamic,&is_visible_from_any,&dirty_shadow_frusta,&is_drawn_indirectly,draw_static_indirectly](size_t j){
+			                                          	return !(draw_static_indirectly && is_drawn_indirectly(j))
+			                                          	    && !is_sponza_element_dynamic[j] && is_visible_from_any(dirty_shadow_frusta, j);
+			                                          },
+			                                          shadowmap_set_uniforms(dirty_lights_mask)) - shadowmap_indirect_nb;
+		}
 
+		// Composite the dynamic casters of all lights on top of a copy
+		// of the static ones.
+		if (dynamic_casters_nb > 0u) {
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[toU(FBO::StaticShadowMapLayer)]);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::ShadowMapLayer)]);
+			for (size_t i = 0; i < shadowed_lights_nb; ++i) {
+				glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[toU(Texture::StaticShadowMaps)], 0, static_cast<GLint>(i));
+				glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[toU(Texture::ShadowMap)], 0, static_cast<GLint>(i));
+				glBlitFramebuffer(0, 0, constant::shadowmap_res_x, constant::shadowmap_res_y,
+				                  0, 0, constant::shadowmap_res_x, constant::shadowmap_res_y,
+				                  GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			}
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
+
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)]);
+			glViewport(0, 0, constant::shadowmap_res_x, constant::shadowmap_res_y);
+			render_sponza_depth(shadow_world_to_clip_matrices.front(), fill_shadowmap_opaque_shader, fill_shadowmap_shader,
+			                    [&is_sponza_element_dynamic,&is_visible_from_any,&shadow_frusta](size_t j){
+			                    	return is_sponza_element_dynamic[j] && is_visible_from_any(shadow_frusta, j);
+			                    },
+			                    shadowmap_set_uniforms((1 << shadowed_lights_nb) - 1));
+		}
 
+		glEndQuery(GL_TIME_ELAPSED);
+		utils::opengl::debug::endDebugGroup();
+
+
+		if (use_tiled_shading) {
 			//
-			// Pass 2: Generate shadowmaps and accumulate lights' contribution
+			// Pass 2.1: Find the lights affecting each screen tile
 			//
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
-			glViewport(0, 0, framebuffer_width, framebuffer_height);
-			// XXX: Is any clearing needed?
+			gpu_lights.clear();
 			for (size_t i = 0; i < static_cast<size_t>(lights_nb); ++i) {
-				auto const& lightTransform = lightTransforms[i];
-				auto const light_view_matrix = lightOffsetTransform.GetMatrixInverse() * lightTransform.GetMatrixInverse();
-				auto const light_world_matrix = glm::inverse(light_view_matrix) * coneScaleTransform.GetMatrix();
-				auto const light_world_to_clip_matrix = lightProjection * light_view_matrix;
+				auto const light_world_matrix = lightTransforms[i].GetMatrix() * lightOffsetTransform.GetMatrix();
+				auto const position = glm::vec3(light_world_matrix[3]);
+				auto const direction = -glm::normalize(glm::vec3(light_world_matrix[2]));
+				auto const range = lightRanges[i];
+				gpu_lights.push_back({ glm::vec4(position, range),
+				                       glm::vec4(direction, std::cos(constant::light_cone_angle)),
+				                       glm::vec4(lightColors[i], std::cos(constant::light_angle_falloff)),
+				                       glm::vec4(position + direction * (cone_sphere_offset * range), cone_sphere_radius * range) });
+			}
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[toU(Buffer::Lights)]);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(gpu_lights.size() * sizeof(GPULight)), gpu_lights.data());
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0u, buffers[toU(Buffer::Lights)]);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1u, buffers[toU(Buffer::TileLightCounts)]);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2u, buffers[toU(Buffer::TileLightIndices)]);
+
+			utils::opengl::debug::beginDebugGroup("Cull lights");
+			glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::LightCulling)]);
+
+			glUseProgram(cull_lights_shader);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 0, cull_lights_shader, "depth_texture", textures[toU(Texture::DepthBuffer)], samplers[toU(Sampler::Nearest)]);
+			glUniformMatrix4fv(glGetUniformLocation(cull_lights_shader, "world_to_view"), 1, GL_FALSE,
+			                   glm::value_ptr(mCamera.GetWorldToViewMatrix()));
+			glUniformMatrix4fv(glGetUniformLocation(cull_lights_shader, "view_to_clip"), 1, GL_FALSE,
+			                   glm::value_ptr(mCamera.GetViewToClipMatrix()));
+			glUniformMatrix4fv(glGetUniformLocation(cull_lights_shader, "clip_to_view"), 1, GL_FALSE,
+			                   glm::value_ptr(mCamera.GetClipToViewMatrix()));
+			glUniform1ui(glGetUniformLocation(cull_lights_shader, "lights_nb"), static_cast<GLuint>(lights_nb));
+			glDispatchCompute(tiles_per_row, tiles_per_column, 1u);
+			glBindSampler(0u, 0u);
+
+			// The light lists are read as shader storage buffers by
+			// the next pass.
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-				//
-				// Pass 2.1: Generate shadow map for light i
-				//
-				utils::opengl::debug::beginDebugGroup("Create shadow map " + std::to_string(i));
-				glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::ShadowMap0Generation) + i]);
+			glEndQuery(GL_TIME_ELAPSED);
+			utils::opengl::debug::endDebugGroup();
 
-				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)]);
-				glViewport(0, 0, constant::shadowmap_res_x, constant::shadowmap_res_y);
-				// XXX: Is any clearing needed?
+			//
+			// Pass 2.2: Accumulate the contribution of all lights at
+			//           once, looping over the lights of each tile;
+			//           every pixel is written, so no clearing is
+			//           needed.
+			//
+			utils::opengl::debug::beginDebugGroup("Shade tiled lights");
+			glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::TiledShading)]);
 
-				for (auto const& element : sponza_elements)
-					element.render(light_world_to_clip_matrix, element.get_transform().GetMatrix(), fill_shadowmap_shader, set_uniforms);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, light_accumulation_fbo);
+			glViewport(0, 0, framebuffer_width, framebuffer_height);
+			glDisable(GL_DEPTH_TEST);
+			glUseProgram(shade_tiled_lights_shader);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 0, shade_tiled_lights_shader, "depth_texture", textures[toU(Texture::DepthBuffer)], samplers[toU(Sampler::Nearest)]);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 1, shade_tiled_lights_shader, "normal_texture", gbuffer_normal_texture, samplers[toU(Sampler::Nearest)]);
+			bind_texture_with_sampler(GL_TEXTURE_2D_ARRAY, 2, shade_tiled_lights_shader, "shadow_texture", shadow_texture, samplers[toU(Sampler::Shadow)]);
+			glUniform2f(glGetUniformLocation(shade_tiled_lights_shader, "inv_res"),
+			            1.0f / static_cast<float>(framebuffer_width),
+			            1.0f / static_cast<float>(framebuffer_height));
+			glUniform1ui(glGetUniformLocation(shade_tiled_lights_shader, "tiles_per_row"), tiles_per_row);
+			glUniformMatrix4fv(glGetUniformLocation(shade_tiled_lights_shader, "view_projection_inverse"), 1, GL_FALSE,
+			                   glm::value_ptr(mCamera.GetClipToWorldMatrix()));
+			glUniform3fv(glGetUniformLocation(shade_tiled_lights_shader, "camera_position"), 1,
+			             glm::value_ptr(mCamera.mWorld.GetTranslation()));
+			glUniform1f(glGetUniformLocation(shade_tiled_lights_shader, "light_intensity"), constant::light_intensity);
+			glUniform1f(glGetUniformLocation(shade_tiled_lights_shader, "shininess"), 100.0f);
+			gbuffer_set_uniforms(shade_tiled_lights_shader);
+			glUniformMatrix4fv(glGetUniformLocation(shade_tiled_lights_shader, "shadow_view_projections"), static_cast<GLsizei>(shadow_world_to_clip_matrices.size()), GL_FALSE,
+			                   glm::value_ptr(shadow_world_to_clip_matrices.front()));
+			glUniform2f(glGetUniformLocation(shade_tiled_lights_shader, "shadowmap_texel_size"),
+			            1.0f / static_cast<float>(constant::shadowmap_res_x),
+			            1.0f / static_cast<float>(constant::shadowmap_res_y));
 
-				glEndQuery(GL_TIME_ELAPSED);
-				utils::opengl::debug::endDebugGroup();
+			bonobo::drawFullscreen();
+
+			glBindSampler(2u, 0u);
+			glBindSampler(1u, 0u);
+			glBindSampler(0u, 0u);
+			glUseProgram(0u);
+			glEnable(GL_DEPTH_TEST);
 
+			glEndQuery(GL_TIME_ELAPSED);
+			utils::opengl::debug::endDebugGroup();
+		} else {
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, light_accumulation_fbo);
+			glViewport(0, 0, framebuffer_width, framebuffer_height);
+			// XXX: Is any clearing needed?
+			for (size_t i = 0; i < shadowed_lights_nb; ++i) {
+				auto const light_world_matrix = get_light_cone_matrix(i);
+				auto const& light_world_to_clip_matrix = shadow_world_to_clip_matrices[i];
 
 				glCullFace(GL_FRONT);
 				glEnable(GL_BLEND);
@@ -378,16 +1105,55 @@ edan35::Assignment2::run()
 				glBlendEquationSeparate(GL_FUNC_ADD, GL_MIN);
 				glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
 				//
-				// Pass 2.2: Accumulate light i contribution
+				// Pass 2.1: Accumulate light i contribution
 				utils::opengl::debug::beginDebugGroup("Accumulate light " + std::to_string(i));
 				glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::Light0Accumulation) + i]);
 
-				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
+				glBindFramebuffer(GL_DRAW_FRAMEBUFFER, light_accumulation_fbo);
 				glUseProgram(accumulate_lights_shader);
 				glViewport(0, 0, framebuffer_width, framebuffer_height);
 				// XXX: Is any clearing needed?
 
-				auto const spotlight_set_uniforms = [framebuffer_width,framebuffer_height,this,&light_world_to_clip_matrix,&lightColors,&lightTransform,&i](GLuint program){
+				bool is_light_volume_visible = true;
+				if (use_light_volume_stencil) {
+					auto const scissor_box = computeScissorBox(bonobo::transformBounds(cone.get_bounds(), light_world_matrix),
+					                                           mCamera.GetWorldToClipMatrix(), framebuffer_width, framebuffer_height);
+					is_light_volume_visible = scissor_box.z > 0 && scissor_box.w > 0;
+					glEnable(GL_SCISSOR_TEST);
+					glScissor(scissor_box.x, scissor_box.y, scissor_box.z, scissor_box.w);
+					glClear(GL_STENCIL_BUFFER_BIT);
+
+					// Count, for each pixel, the back faces behind the
+					// G-buffer depth minus the front faces behind it
+					// ("z-fail"): only pixels whose depth lies inside
+					// the cone end up non-zero, which holds even when
+					// the camera is inside the cone and its front
+					// faces are clipped by the near plane.
+					utils::opengl::debug::beginDebugGroup("Mark light volume " + std::to_string(i));
+					glEnable(GL_STENCIL_TEST);
+					glStencilFunc(GL_ALWAYS, 0, 0xFF);
+					glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+					glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+					glDisable(GL_CULL_FACE);
+					glDepthFunc(GL_LESS);
+					glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+					if (is_light_volume_visible)
+						cone.render(mCamera.GetWorldToClipMatrix(), light_world_matrix,
+						            mark_light_volume_shader, set_uniforms);
+					glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+					glEnable(GL_CULL_FACE);
+					utils::opengl::debug::endDebugGroup();
+
+					// The stencil test now does the depth test's job,
+					// and the back faces are drawn whether they are in
+					// front of the G-buffer depth or not.
+					glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+					glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+					glDisable(GL_DEPTH_TEST);
+					glUseProgram(accumulate_lights_shader);
+				}
+
+				auto const spotlight_set_uniforms = [framebuffer_width,framebuffer_height,this,&light_world_to_clip_matrix,&lightColors,&lightRanges,&light_world_matrix,&i,&gbuffer_set_uniforms](GLuint program){
 					glUniform2f(glGetUniformLocation(program, "inv_res"),
 					            1.0f / static_cast<float>(framebuffer_width),
 					            1.0f / static_cast<float>(framebuffer_height));
@@ -398,26 +1164,39 @@ edan35::Assignment2::run()
 					glUniformMatrix4fv(glGetUniformLocation(program, "shadow_view_projection"), 1, GL_FALSE,
 					                   glm::value_ptr(light_world_to_clip_matrix));
 					glUniform3fv(glGetUniformLocation(program, "light_color"), 1, glm::value_ptr(lightColors[i]));
-					glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(lightTransform.GetTranslation()));
-					glUniform3fv(glGetUniformLocation(program, "light_direction"), 1, glm::value_ptr(lightTransform.GetFront()));
+					// Apex and direction of the cone, as for tiled shading.
+					glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(glm::vec3(light_world_matrix[3])));
+					glUniform3fv(glGetUniformLocation(program, "light_direction"), 1, glm::value_ptr(-glm::normalize(glm::vec3(light_world_matrix[2]))));
 					glUniform1f(glGetUniformLocation(program, "light_intensity"), constant::light_intensity);
 					glUniform1f(glGetUniformLocation(program, "light_angle_falloff"), constant::light_angle_falloff);
+					glUniform1f(glGetUniformLocation(program, "light_cone_angle"), constant::light_cone_angle);
+					glUniform1f(glGetUniformLocation(program, "light_range"), lightRanges[i]);
+					glUniform1f(glGetUniformLocation(program, "shininess"), 100.0f);
 					glUniform2f(glGetUniformLocation(program, "shadowmap_texel_size"),
 					            1.0f / static_cast<float>(constant::shadowmap_res_x),
 					            1.0f / static_cast<float>(constant::shadowmap_res_y));
+					glUniform1i(glGetUniformLocation(program, "shadowmap_layer"), static_cast<GLint>(i));
+					gbuffer_set_uniforms(program);
 				};
 
 				bind_texture_with_sampler(GL_TEXTURE_2D, 0, accumulate_lights_shader, "depth_texture", textures[toU(Texture::DepthBuffer)], samplers[toU(Sampler::Nearest)]);
-				bind_texture_with_sampler(GL_TEXTURE_2D, 1, accumulate_lights_shader, "normal_texture", textures[toU(Texture::GBufferWorldSpaceNormal)], samplers[toU(Sampler::Nearest)]);
-				bind_texture_with_sampler(GL_TEXTURE_2D, 2, accumulate_lights_shader, "shadow_texture", textures[toU(Texture::ShadowMap)], samplers[toU(Sampler::Shadow)]);
+				bind_texture_with_sampler(GL_TEXTURE_2D, 1, accumulate_lights_shader, "normal_texture", gbuffer_normal_texture, samplers[toU(Sampler::Nearest)]);
+				bind_texture_with_sampler(GL_TEXTURE_2D_ARRAY, 2, accumulate_lights_shader, "shadow_texture", shadow_texture, samplers[toU(Sampler::Shadow)]);
 
-				cone.render(mCamera.GetWorldToClipMatrix(), light_world_matrix,
-				            accumulate_lights_shader, spotlight_set_uniforms);
+				if (is_light_volume_visible)
+					cone.render(mCamera.GetWorldToClipMatrix(), light_world_matrix,
+					            accumulate_lights_shader, spotlight_set_uniforms);
 
 				glBindSampler(2u, 0u);
 				glBindSampler(1u, 0u);
 				glBindSampler(0u, 0u);
 
+				if (use_light_volume_stencil) {
+					glEnable(GL_DEPTH_TEST);
+					glDisable(GL_STENCIL_TEST);
+					glDisable(GL_SCISSOR_TEST);
+				}
+
 				glEndQuery(GL_TIME_ELAPSED);
 				utils::opengl::debug::endDebugGroup();
 
@@ -426,35 +1205,36 @@ edan35::Assignment2::run()
 				glDisable(GL_BLEND);
 				glCullFace(GL_BACK);
 			}
+		}
 
 
-			//
-			// Pass 3: Compute final image using both the g-buffer and  the light accumulation buffer
-			//
-			utils::opengl::debug::beginDebugGroup("Resolve");
-			glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::Resolve)]);
+		//
+		// Pass 3: Compute final image using both the g-buffer and  the light accumulation buffer
+		//
+		utils::opengl::debug::beginDebugGroup("Resolve");
+		glBeginQuery(GL_TIME_ELAPSED, elapsed_time_queries[toU(ElapsedTimeQuery::Resolve)]);
 
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
-			glUseProgram(resolve_deferred_shader);
-			glViewport(0, 0, framebuffer_width, framebuffer_height);
-			// XXX: Is any clearing needed?
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
+		glUseProgram(resolve_deferred_shader);
+		glViewport(0, 0, framebuffer_width, framebuffer_height);
+		// XXX: Is any clearing needed?
 
-			bind_texture_with_sampler(GL_TEXTURE_2D, 0, resolve_deferred_shader, "diffuse_texture", textures[toU(Texture::GBufferDiffuse)], samplers[toU(Sampler::Nearest)]);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 1, resolve_deferred_shader, "specular_texture", textures[toU(Texture::GBufferSpecular)], samplers[toU(Sampler::Nearest)]);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 2, resolve_deferred_shader, "light_d_texture", textures[toU(Texture::LightDiffuseContribution)], samplers[toU(Sampler::Nearest)]);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 3, resolve_deferred_shader, "light_s_texture", textures[toU(Texture::LightSpecularContribution)], samplers[toU(Sampler::Nearest)]);
+		bind_texture_with_sampler(GL_TEXTURE_2D, 0, resolve_deferred_shader, "diffuse_texture", gbuffer_diffuse_texture, samplers[toU(Sampler::Nearest)]);
+		bind_texture_with_sampler(GL_TEXTURE_2D, 1, resolve_deferred_shader, "specular_texture", gbuffer_specular_texture, samplers[toU(Sampler::Nearest)]);
+		bind_texture_with_sampler(GL_TEXTURE_2D, 2, resolve_deferred_shader, "light_d_texture", light_diffuse_texture, samplers[toU(Sampler::Nearest)]);
+		bind_texture_with_sampler(GL_TEXTURE_2D, 3, resolve_deferred_shader, "light_s_texture", light_specular_texture, samplers[toU(Sampler::Nearest)]);
+		gbuffer_set_uniforms(resolve_deferred_shader);
 
-			bonobo::drawFullscreen();
+		bonobo::drawFullscreen();
 
-			glBindSampler(3, 0u);
-			glBindSampler(2, 0u);
-			glBindSampler(1, 0u);
-			glBindSampler(0, 0u);
-			glUseProgram(0u);
+		glBindSampler(3, 0u);
+		glBindSampler(2, 0u);
+		glBindSampler(1, 0u);
+		glBindSampler(0, 0u);
+		glUseProgram(0u);
 
-			glEndQuery(GL_TIME_ELAPSED);
-			utils::opengl::debug::endDebugGroup();
-		}
+		glEndQuery(GL_TIME_ELAPSED);
+		utils::opengl::debug::endDebugGroup();
 
 
 		auto const show_debug_elements = show_cone_wireframe || show_basis;
@@ -473,8 +1253,7 @@ edan35::Assignment2::run()
 			glDisable(GL_CULL_FACE);
 			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 			for (size_t i = 0; i < lights_nb; ++i) {
-				cone.render(mCamera.GetWorldToClipMatrix(),
-				            lightTransforms[i].GetMatrix() * lightOffsetTransform.GetMatrix() * coneScaleTransform.GetMatrix(),
+				cone.render(mCamera.GetWorldToClipMatrix(), get_light_cone_matrix(i),
 				            render_light_cones_shader, set_uniforms);
 			}
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -504,13 +1283,15 @@ edan35::Assignment2::run()
 		// Output content of the g-buffer as well as of the shadowmap, for debugging purposes
 		//
 		if (show_textures) {
-			bonobo::displayTexture({-0.95f, -0.95f}, {-0.55f, -0.55f}, textures[toU(Texture::GBufferDiffuse)],            samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
-			bonobo::displayTexture({-0.45f, -0.95f}, {-0.05f, -0.55f}, textures[toU(Texture::GBufferSpecular)],           samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
-			bonobo::displayTexture({ 0.05f, -0.95f}, { 0.45f, -0.55f}, textures[toU(Texture::GBufferWorldSpaceNormal)],   samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
+			auto const specular_swizzle = use_compact_gbuffer ? glm::ivec4(3, 3, 3, -1) : glm::ivec4(0, 1, 2, -1);
+			auto const normal_swizzle = use_compact_gbuffer ? glm::ivec4(0, 1, -1, -1) : glm::ivec4(0, 1, 2, -1);
+			bonobo::displayTexture({-0.95f, -0.95f}, {-0.55f, -0.55f}, gbuffer_diffuse_texture,                           samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
+			bonobo::displayTexture({-0.45f, -0.95f}, {-0.05f, -0.55f}, gbuffer_specular_texture,                          samplers[toU(Sampler::Linear)], specular_swizzle, glm::uvec2(framebuffer_width, framebuffer_height));
+			bonobo::displayTexture({ 0.05f, -0.95f}, { 0.45f, -0.55f}, gbuffer_normal_texture,                            samplers[toU(Sampler::Linear)], normal_swizzle, glm::uvec2(framebuffer_width, framebuffer_height));
 			bonobo::displayTexture({ 0.55f, -0.95f}, { 0.95f, -0.55f}, textures[toU(Texture::DepthBuffer)],               samplers[toU(Sampler::Linear)], {0, 0, 0, -1}, glm::uvec2(framebuffer_width, framebuffer_height), true, mCamera.mNear, mCamera.mFar);
-			bonobo::displayTexture({-0.95f,  0.55f}, {-0.55f,  0.95f}, textures[toU(Texture::ShadowMap)],                 samplers[toU(Sampler::Linear)], {0, 0, 0, -1}, glm::uvec2(framebuffer_width, framebuffer_height), true, lightProjectionNearPlane, lightProjectionFarPlane);
-			bonobo::displayTexture({-0.45f,  0.55f}, {-0.05f,  0.95f}, textures[toU(Texture::LightDiffuseContribution)],  samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
-			bonobo::displayTexture({ 0.05f,  0.55f}, { 0.45f,  0.95f}, textures[toU(Texture::LightSpecularContribution)], samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
+			bonobo::displayTextureLayer({-0.95f,  0.55f}, {-0.55f,  0.95f}, shadow_texture, 0,                       samplers[toU(Sampler::Linear)], {0, 0, 0, -1}, glm::uvec2(framebuffer_width, framebuffer_height), true, lightProjectionNearPlane, lightProjectionFarPlane);
+			bonobo::displayTexture({-0.45f,  0.55f}, {-0.05f,  0.95f}, light_diffuse_texture,                             samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
+			bonobo::displayTexture({ 0.05f,  0.55f}, { 0.45f,  0.95f}, light_specular_texture,                            samplers[toU(Sampler::Linear)], {0, 1, 2, -1}, glm::uvec2(framebuffer_width, framebuffer_height));
 		}
 
 		//
@@ -530,24 +1311,38 @@ edan35::Assignment2::run()
 				ImGui::TableSetupColumn("GPU time [ms]");
 				ImGui::TableHeadersRow();
 
+				if (use_depth_prepass) {
+					ImGui::TableNextColumn();
+					ImGui::Text("Depth pre-pass");
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::DepthPrePass)] / 1000000.0f);
+				}
+
 				ImGui::TableNextColumn();
 				ImGui::Text("Gbuffer gen.");
 				ImGui::TableNextColumn();
 				ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::GbufferGeneration)] / 1000000.0f);
 
-				for (std::size_t i = 0; i < lights_nb; ++i) {
+				ImGui::TableNextColumn();
+				ImGui::Text("Shadow maps (%zu, 1 pass)", std::min(static_cast<size_t>(lights_nb), constant::shadowed_lights_nb));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::ShadowMapsGeneration)] / 1000000.0f);
+
+				if (use_tiled_shading) {
 					ImGui::TableNextColumn();
-					ImGui::Text("Light %zu", i);
+					ImGui::Text("Light culling");
 					ImGui::TableNextColumn();
-					ImGui::Text("");
+					ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::LightCulling)] / 1000000.0f);
 
 					ImGui::TableNextColumn();
-					ImGui::Text("  Shadow map");
+					ImGui::Text("Tiled shading");
 					ImGui::TableNextColumn();
-					ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::ShadowMap0Generation) + i] / 1000000.0f);
+					ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::TiledShading)] / 1000000.0f);
+				}
 
+				for (std::size_t i = 0; !use_tiled_shading && i < std::min(static_cast<size_t>(lights_nb), constant::shadowed_lights_nb); ++i) {
 					ImGui::TableNextColumn();
-					ImGui::Text("  Light accumulation");
+					ImGui::Text("Light %zu accumulation", i);
 					ImGui::TableNextColumn();
 					ImGui::Text("%.3f", pass_elapsed_times[toU(ElapsedTimeQuery::Light0Accumulation) + i] / 1000000.0f);
 				}
@@ -574,16 +1369,77 @@ edan35::Assignment2::run()
 
 				ImGui::EndTable();
 			}
+
+			//
+			// Rough estimate of the traffic to and from the G-buffer and
+			// light accumulation targets, assuming that every pass touches
+			// each pixel exactly once: overdraw, early depth rejection
+			// and caches are ignored.
+			//
+			std::size_t const depth_size = 4u;                                      // DEPTH24_STENCIL8
+			std::size_t const material_size = use_compact_gbuffer ? 4u : 4u + 4u;   // RGBA8 packed, or RGBA8 diffuse and specular
+			std::size_t const normal_size = 4u;                                     // RG16, or RGBA8
+			std::size_t const lights_size = 4u + 4u;                                // diffuse and specular, R11G11B10F or RGBA8
+			std::size_t const accumulation_passes_nb = use_tiled_shading ? 1u : std::min(static_cast<std::size_t>(lights_nb), constant::shadowed_lights_nb);
+			std::size_t const written_size = (depth_size + material_size + normal_size)                          // G-buffer
+			                               + accumulation_passes_nb * lights_size                                // Light accumulation
+			                               + 4u;                                                                 // Resolve
+			// Tiled shading reads depth twice (culling and shading), while
+			// blended cones read back the light targets.
+			std::size_t const read_size = (use_tiled_shading ? 2u * depth_size + normal_size
+			                                                 : accumulation_passes_nb * (depth_size + normal_size + lights_size))
+			                            + material_size + lights_size;                                           // Resolve
+			auto const pixels_nb = static_cast<std::size_t>(framebuffer_width) * static_cast<std::size_t>(framebuffer_height);
+			ImGui::Text("G-buffer traffic estimate: %.1f MiB written, %.1f MiB read",
+			            static_cast<float>(written_size * pixels_nb) / (1024.0f * 1024.0f),
+			            static_cast<float>(read_size * pixels_nb) / (1024.0f * 1024.0f));
 		}
 		ImGui::End();
 
 		opened = ImGui::Begin("Scene Controls", nullptr, ImGuiWindowFlags_None);
 		if (opened) {
+			if (!is_sponza_loaded)
+				ImGui::Text("Loading Sponza…");
 			ImGui::Checkbox("Pause lights", &are_lights_paused);
-			ImGui::SliderInt("Number of lights", &lights_nb, 1, static_cast<int>(constant::lights_nb));
+			if (is_tiled_shading_supported && ImGui::Checkbox("Use tiled shading", &use_tiled_shading) && !use_tiled_shading)
+				lights_nb = std::min(lights_nb, static_cast<int>(constant::shadowed_lights_nb));
+			ImGui::SliderInt("Number of lights", &lights_nb, 1, static_cast<int>(use_tiled_shading ? constant::max_lights_nb : constant::shadowed_lights_nb));
+			if (use_tiled_shading) {
+				ImGui::Text("Tiles: %u x %u, of %u x %u pixels", tiles_per_row, tiles_per_column, constant::light_tile_size, constant::light_tile_size);
+				ImGui::Text("Tile light lists: %.1f MiB",
+				            static_cast<float>(static_cast<std::size_t>(tiles_per_row) * tiles_per_column * constant::max_lights_per_tile * sizeof(GLuint)) / (1024.0f * 1024.0f));
+			} else {
+				ImGui::Checkbox("Use stencil-masked light volumes", &use_light_volume_stencil);
+			}
 			ImGui::Checkbox("Show textures", &show_textures);
 			ImGui::Checkbox("Show light cones wireframe", &show_cone_wireframe);
 			ImGui::Separator();
+			ImGui::Checkbox("Use compact G-buffer", &use_compact_gbuffer);
+			ImGui::Checkbox("Use depth pre-pass", &use_depth_prepass);
+			ImGui::Checkbox("Use frustum culling", &use_frustum_culling);
+			if (is_gpu_driven_supported) {
+				if (ImGui::Checkbox("Use GPU-driven submission", &use_gpu_driven_submission))
+					is_hiz_valid = false;
+				if (use_gpu_driven_submission)
+					ImGui::Text("Indirect: %zu elements and %zu materials in %zu multi-draws per pass, culled on the GPU",
+					            sponza_indirect.get_objects_nb(), sponza_indirect.get_materials_nb(), sponza_indirect.get_batches_nb());
+			}
+			if (is_occlusion_culling_supported && use_gpu_driven_submission) {
+				if (ImGui::Checkbox("Use Hi-Z occlusion culling", &use_occlusion_culling))
+					is_hiz_valid = false;
+				if (use_occlusion_culling)
+					ImGui::Text("Hi-Z: %zu occluded after the first phase, %zu still occluded after the second",
+					            gbuffer_early_occluded_nb, gbuffer_occluded_nb);
+			}
+			ImGui::Text("G-buffer: %zu drawn, %zu culled, %zu tested on the GPU", sponza_elements.size() - gbuffer_indirect_nb - gbuffer_culled_nb, gbuffer_culled_nb, gbuffer_indirect_nb);
+			ImGui::Text("Shadow maps, last re-render: %zu drawn, %zu culled, %zu tested on the GPU", sponza_elements.size() - shadowmap_indirect_nb - shadowmap_culled_nb, shadowmap_culled_nb, shadowmap_indirect_nb);
+			ImGui::Separator();
+			ImGui::Checkbox("Cache static shadow maps", &use_shadow_cache);
+			ImGui::SliderFloat("Cache distance tolerance", &shadow_cache_distance_tolerance, 0.0f, 0.1f * constant::scale_lengths, "%.2f cm");
+			ImGui::SliderAngle("Cache angle tolerance", &shadow_cache_angle_tolerance, 0.0f, 5.0f);
+			ImGui::Text("Shadow maps: %zu reused, %zu re-rendered", shadowmaps_reused_nb, shadowmaps_rendered_nb);
+			ImGui::Text("Dynamic shadow casters: %zu", dynamic_casters_nb);
+			ImGui::Separator();
 			ImGui::Checkbox("Show basis", &show_basis);
 			ImGui::SliderFloat("Basis thickness scale", &basis_thickness_scale, 0.0f, 100.0f);
 			ImGui::SliderFloat("Basis length scale", &basis_length_scale, 0.0f, 100.0f);
@@ -616,17 +1472,40 @@ edan35::Assignment2::run()
 		first_frame = false;
 	}
 
+	glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
 	glDeleteQueries(static_cast<GLsizei>(elapsed_time_queries.size()), elapsed_time_queries.data());
 	glDeleteSamplers(static_cast<GLsizei>(samplers.size()), samplers.data());
 	glDeleteFramebuffers(static_cast<GLsizei>(fbos.size()), fbos.data());
 	glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
 
+	glDeleteProgram(build_hiz_shader);
+	build_hiz_shader = 0u;
+	glDeleteProgram(fill_shadowmap_indirect_shader);
+	fill_shadowmap_indirect_shader = 0u;
+	glDeleteProgram(fill_depth_indirect_shader);
+	fill_depth_indirect_shader = 0u;
+	glDeleteProgram(fill_gbuffer_indirect_shader);
+	fill_gbuffer_indirect_shader = 0u;
+	glDeleteProgram(cull_indirect_draws_shader);
+	cull_indirect_draws_shader = 0u;
+	glDeleteProgram(shade_tiled_lights_shader);
+	shade_tiled_lights_shader = 0u;
+	glDeleteProgram(cull_lights_shader);
+	cull_lights_shader = 0u;
 	glDeleteProgram(resolve_deferred_shader);
 	resolve_deferred_shader = 0u;
+	glDeleteProgram(mark_light_volume_shader);
+	mark_light_volume_shader = 0u;
 	glDeleteProgram(accumulate_lights_shader);
 	accumulate_lights_shader = 0u;
+	glDeleteProgram(fill_shadowmap_opaque_shader);
+	fill_shadowmap_opaque_shader = 0u;
 	glDeleteProgram(fill_shadowmap_shader);
 	fill_shadowmap_shader = 0u;
+	glDeleteProgram(fill_depth_opaque_shader);
+	fill_depth_opaque_shader = 0u;
+	glDeleteProgram(fill_depth_shader);
+	fill_depth_shader = 0u;
 	glDeleteProgram(fill_gbuffer_shader);
 	fill_gbuffer_shader = 0u;
 	glDeleteProgram(fallback_shader);
@@ -658,9 +1537,16 @@ Textures createTextures(GLsizei framebuffer_width, GLsizei framebuffer_height)
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, framebuffer_width, framebuffer_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::DepthBuffer)], "Depth buffer");
 
-	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)]);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, constant::shadowmap_res_x, constant::shadowmap_res_y, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::ShadowMap)], "Shadow map");
+	// One layer per shadowed light.
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textures[toU(Texture::ShadowMap)]);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, constant::shadowmap_res_x, constant::shadowmap_res_y, static_cast<GLsizei>(constant::shadowed_lights_nb), 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0u);
+	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::ShadowMap)], "Shadow maps");
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textures[toU(Texture::StaticShadowMaps)]);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, constant::shadowmap_res_x, constant::shadowmap_res_y, static_cast<GLsizei>(constant::shadowed_lights_nb), 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0u);
+	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::StaticShadowMaps)], "Static shadow maps");
 
 	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::GBufferDiffuse)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
@@ -682,6 +1568,36 @@ Textures createTextures(GLsizei framebuffer_width, GLsizei framebuffer_height)
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::LightSpecularContribution)], "Light specular contribution");
 
+	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::CompactGBufferDiffuseSpecular)]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::CompactGBufferDiffuseSpecular)], "Compact GBuffer diffuse and specular");
+
+	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::CompactGBufferNormal)]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16, framebuffer_width, framebuffer_height, 0, GL_RG, GL_UNSIGNED_SHORT, nullptr);
+	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::CompactGBufferNormal)], "Compact GBuffer normals");
+
+	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::CompactLightDiffuseContribution)]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, framebuffer_width, framebuffer_height, 0, GL_RGB, GL_FLOAT, nullptr);
+	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::CompactLightDiffuseContribution)], "Compact light diffuse contribution");
+
+	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::CompactLightSpecularContribution)]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, framebuffer_width, framebuffer_height, 0, GL_RGB, GL_FLOAT, nullptr);
+	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::CompactLightSpecularContribution)], "Compact light specular contribution");
+
+	// Depth pyramid, with every level down to 1x1; it is only ever read
+	// with `texelFetch()`.
+	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::HiZ)]);
+	GLint hiz_level = 0;
+	for (GLsizei width = framebuffer_width, height = framebuffer_height; ; width = std::max(width / 2, 1), height = std::max(height / 2, 1), ++hiz_level) {
+		glTexImage2D(GL_TEXTURE_2D, hiz_level, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
+		if (width == 1 && height == 1)
+			break;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, hiz_level);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::HiZ)], "Hi-Z");
+
 	glBindTexture(GL_TEXTURE_2D, textures[toU(Texture::Result)]);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 	utils::opengl::debug::nameObject(GL_TEXTURE, textures[toU(Texture::Result)], "Final result");
@@ -758,14 +1674,33 @@ FBOs createFramebufferObjects(Textures const& textures)
 	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::GBuffer)], "GBuffer");
 
 	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)]);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::ShadowMap)], 0);
+	// Attach all layers, for fill_shadowmap.geom to select one per light.
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[toU(Texture::ShadowMap)], 0);
 	validate_fbo("Shadow map generation");
 	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowMap)], "Shadow map generation");
 
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::StaticShadowMaps)]);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[toU(Texture::StaticShadowMaps)], 0);
+	validate_fbo("Static shadow maps generation");
+	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::StaticShadowMaps)], "Static shadow maps generation");
+
+	// Single layers of the shadow maps, for clearing and copying them one
+	// at a time; the layer attached changes while rendering.
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowMapLayer)]);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[toU(Texture::ShadowMap)], 0, 0);
+	validate_fbo("Shadow map layer");
+	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::ShadowMapLayer)], "Shadow map layer");
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::StaticShadowMapLayer)]);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textures[toU(Texture::StaticShadowMaps)], 0, 0);
+	validate_fbo("Static shadow map layer");
+	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::StaticShadowMapLayer)], "Static shadow map layer");
+
 	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)]);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::LightDiffuseContribution)], 0);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[toU(Texture::LightSpecularContribution)], 0);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)], 0);
+	// The stencil is used for masking light volumes.
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)], 0);
 	glReadBuffer(GL_NONE); // Disable reading back from the colour attachments, as unnecessary in this assignment.
 	// Configure the mapping from fragment shader outputs to colour attachments.
 	std::array<GLenum, 2> const light_accumulation_draws = {
@@ -776,6 +1711,31 @@ FBOs createFramebufferObjects(Textures const& textures)
 	validate_fbo("Light accumulation");
 	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::LightAccumulation)], "Light acccumulation");
 
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::CompactGBuffer)]);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::CompactGBufferDiffuseSpecular)], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[toU(Texture::CompactGBufferNormal)], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)], 0);
+	glReadBuffer(GL_NONE); // Disable reading back from the colour attachments, as unnecessary in this assignment.
+	// The specular output of EDAN35/fill_gbuffer.frag is packed in the
+	// alpha of the diffuse one, so it is not written anywhere.
+	std::array<GLenum, 3> const compact_gbuffer_draws = {
+		GL_COLOR_ATTACHMENT0, // The fragment shader output at location 0 will be written to colour attachment 0 (i.e. the diffuse and specular texture).
+		GL_NONE,              // The fragment shader output at location 1 will be discarded.
+		GL_COLOR_ATTACHMENT1  // The fragment shader output at location 2 will be written to colour attachment 1 (i.e. the octahedral normal texture).
+	};
+	glDrawBuffers(static_cast<GLsizei>(compact_gbuffer_draws.size()), compact_gbuffer_draws.data());
+	validate_fbo("Compact GBuffer");
+	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::CompactGBuffer)], "Compact GBuffer");
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::CompactLightAccumulation)]);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::CompactLightDiffuseContribution)], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, textures[toU(Texture::CompactLightSpecularContribution)], 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, textures[toU(Texture::DepthBuffer)], 0);
+	glReadBuffer(GL_NONE); // Disable reading back from the colour attachments, as unnecessary in this assignment.
+	glDrawBuffers(static_cast<GLsizei>(light_accumulation_draws.size()), light_accumulation_draws.data());
+	validate_fbo("Compact light accumulation");
+	utils::opengl::debug::nameObject(GL_FRAMEBUFFER, fbos[toU(FBO::CompactLightAccumulation)], "Compact light acccumulation");
+
 	glBindFramebuffer(GL_FRAMEBUFFER, fbos[toU(FBO::Resolve)]);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[toU(Texture::Result)], 0);
 	glReadBuffer(GL_COLOR_ATTACHMENT0); // Colour attachment result 0 (i.e. the rendering result texture) will be blitted to the screen.
@@ -795,41 +1755,64 @@ FBOs createFramebufferObjects(Textures const& textures)
 	return fbos;
 }
 
+Buffers createBuffers(GLsizei framebuffer_width, GLsizei framebuffer_height)
+{
+	auto const tiles_nb = static_cast<size_t>((framebuffer_width + constant::light_tile_size - 1u) / constant::light_tile_size)
+	                    * static_cast<size_t>((framebuffer_height + constant::light_tile_size - 1u) / constant::light_tile_size);
+
+	Buffers buffers;
+	glGenBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+
+	// Updated every frame with the lights in use.
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[toU(Buffer::Lights)]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, constant::max_lights_nb * sizeof(GPULight), nullptr, GL_DYNAMIC_DRAW);
+	utils::opengl::debug::nameObject(GL_BUFFER, buffers[toU(Buffer::Lights)], "Lights");
+
+	// Written by EDAN35/cull_lights.comp, and read by
+	// EDAN35/shade_tiled_lights.frag: the number of lights affecting each
+	// tile, and their indices, `constant::max_lights_per_tile` per tile.
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[toU(Buffer::TileLightCounts)]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, tiles_nb * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	utils::opengl::debug::nameObject(GL_BUFFER, buffers[toU(Buffer::TileLightCounts)], "Tile light counts");
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[toU(Buffer::TileLightIndices)]);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, tiles_nb * constant::max_lights_per_tile * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	utils::opengl::debug::nameObject(GL_BUFFER, buffers[toU(Buffer::TileLightIndices)], "Tile light indices");
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+	return buffers;
+}
+
 ElapsedTimeQueries createElapsedTimeQueries()
 {
 	ElapsedTimeQueries queries;
 	glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
 
+	// Queries (like any other OpenGL object) need to have been used at least
+	// once for their resources to be allocated, so that `glObjectLabel()`
+	// can be called on them. Their results are also read every frame,
+	// including for passes which are not run in the current configuration,
+	// so they all need to hold one from the start.
+	for (auto const query : queries) {
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		glEndQuery(GL_TIME_ELAPSED);
+	}
+
 	if (utils::opengl::debug::isSupported())
 	{
-		// Queries (like any other OpenGL object) need to have been used at least
-		// once to ensure their resources have been allocated so we can call
-		// `glObjectLabel()` on them.
-		auto const register_query = [](GLuint const query) {
-			glBeginQuery(GL_TIME_ELAPSED, query);
-			glEndQuery(GL_TIME_ELAPSED);
-		};
-
-		register_query(queries[toU(ElapsedTimeQuery::GbufferGeneration)]);
+		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::DepthPrePass)], "Depth pre-pass");
 		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::GbufferGeneration)], "GBuffer generation");
-
-		for (size_t i = 0; i < constant::lights_nb; ++i)
+		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::ShadowMapsGeneration)], "Shadow maps generation");
+		for (size_t i = 0; i < constant::shadowed_lights_nb; ++i)
 		{
-			register_query(queries[toU(ElapsedTimeQuery::ShadowMap0Generation) + i]);
-			utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::ShadowMap0Generation) + i], "Shadow map " + std::to_string(i) + " generation");
-
-			register_query(queries[toU(ElapsedTimeQuery::Light0Accumulation) + i]);
 			utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::Light0Accumulation) + i], "Light" + std::to_string(i) + " accumulation");
 		}
-
-		register_query(queries[toU(ElapsedTimeQuery::Resolve)]);
+		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::LightCulling)], "Light culling");
+		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::TiledShading)], "Tiled shading");
 		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::Resolve)], "Resolve");
-
-		register_query(queries[toU(ElapsedTimeQuery::ConeWireframe)]);
 		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::ConeWireframe)], "Cone wireframe");
-
-		register_query(queries[toU(ElapsedTimeQuery::GUI)]);
 		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::GUI)], "GUI");
+		utils::opengl::debug::nameObject(GL_QUERY, queries[toU(ElapsedTimeQuery::CopyToFramebuffer)], "Copy to framebuffer");
 	}
 
 	return queries;
@@ -928,6 +1911,39 @@ loadCone()
 	}
 	glBindVertexArray(0u);
 
+	cone.bounds = bonobo::computeBounds(vertexArrayData, 3u * sizeof(float), static_cast<size_t>(cone.vertices_nb));
+
 	return cone;
 }
+
+glm::ivec4
+computeScissorBox(bonobo::bounding_volume const& bounds, glm::mat4 const& world_to_clip,
+                  GLsizei const framebuffer_width, GLsizei const framebuffer_height)
+{
+	glm::ivec4 const full_box(0, 0, framebuffer_width, framebuffer_height);
+	if (bounds.is_empty())
+		return full_box;
+
+	glm::vec2 ndc_min(std::numeric_limits<float>::max());
+	glm::vec2 ndc_max(std::numeric_limits<float>::lowest());
+	for (int i = 0; i < 8; ++i) {
+		auto const corner = glm::vec3((i & 1) ? bounds.max_corner.x : bounds.min_corner.x,
+		                              (i & 2) ? bounds.max_corner.y : bounds.min_corner.y,
+		                              (i & 4) ? bounds.max_corner.z : bounds.min_corner.z);
+		auto const clip = world_to_clip * glm::vec4(corner, 1.0f);
+		// Corners behind the camera do not project sensibly.
+		if (clip.w <= 0.0f)
+			return full_box;
+		auto const ndc = glm::vec2(clip) / clip.w;
+		ndc_min = glm::min(ndc_min, ndc);
+		ndc_max = glm::max(ndc_max, ndc);
+	}
+
+	ndc_min = glm::clamp(ndc_min, glm::vec2(-1.0f), glm::vec2(1.0f));
+	ndc_max = glm::clamp(ndc_max, glm::vec2(-1.0f), glm::vec2(1.0f));
+	auto const size = glm::vec2(framebuffer_width, framebuffer_height);
+	auto const pixel_min = glm::ivec2(glm::floor((ndc_min * 0.5f + 0.5f) * size));
+	auto const pixel_max = glm::ivec2(glm::ceil((ndc_max * 0.5f + 0.5f) * size));
+	return glm::ivec4(pixel_min, glm::max(pixel_max - pixel_min, glm::ivec2(0)));
+}
 } // namespace
@@ -0,0 +1,140 @@
+#include "FileWatcher.hpp"
+
+#include "core/Log.h"
+
+#include <sys/stat.h>
+#if defined(__linux__)
+#	include <sys/inotify.h>
+#	include <cerrno>
+#	include <cstring>
+#	include <unistd.h>
+#endif
+
+#if defined(__linux__)
+
+FileWatcher::FileWatcher() : _inotify_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+	if (_inotify_fd < 0)
+		LogWarning("Failed to initialise inotify (%s): files will not be watched.", std::strerror(errno));
+}
+
+FileWatcher::~FileWatcher()
+{
+	if (_inotify_fd >= 0)
+		::close(_inotify_fd);
+}
+
+void
+FileWatcher::Watch(std::string const& path)
+{
+	if (_inotify_fd < 0 || !_files.insert(path).second)
+		return;
+
+	// Keep the directory as written in |path|, so that the paths rebuilt
+	// from the events match the watched ones.
+	auto const separator = path.find_last_of('/');
+	auto const directory = separator != std::string::npos ? path.substr(0u, separator + 1u) : std::string();
+	if (_watch_descriptors.find(directory) != _watch_descriptors.end())
+		return;
+
+	// Files are reported once fully written, either in place or, as
+	// editors commonly save, as a new file renamed over the previous one;
+	// IN_CREATE is left out as it fires before anything was written.
+	int const wd = inotify_add_watch(_inotify_fd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd < 0) {
+		LogWarning("Failed to watch directory \"%s\" (%s).", directory.c_str(), std::strerror(errno));
+		return;
+	}
+	// Different spellings of the same directory share a watch descriptor.
+	_watch_descriptors.emplace(directory, wd);
+	_directories[wd].push_back(directory);
+}
+
+std::vector<std::string>
+FileWatcher::PollChangedFiles()
+{
+	std::unordered_set<std::string> changed_files;
+	if (_inotify_fd >= 0) {
+		alignas(inotify_event) char buffer[4096];
+		for (;;) {
+			auto const read_nb = ::read(_inotify_fd, buffer, sizeof(buffer));
+			if (read_nb <= 0)
+				break;
+
+			for (char const* ptr = buffer; ptr < buffer + read_nb;) {
+				auto const event = reinterpret_cast<inotify_event const*>(ptr);
+				ptr += sizeof(inotify_event) + event->len;
+
+				// Events were dropped: assume everything changed.
+				if (event->mask & IN_Q_OVERFLOW) {
+					changed_files.insert(_files.begin(), _files.end());
+					continue;
+				}
+
+				auto const directories = _directories.find(event->wd);
+				if (event->len == 0u || directories == _directories.end())
+					continue;
+				for (auto const& directory : directories->second) {
+					auto const path = directory + event->name;
+					if (_files.find(path) != _files.end())
+						changed_files.insert(path);
+				}
+			}
+		}
+	}
+
+	return std::vector<std::string>(changed_files.begin(), changed_files.end());
+}
+
+#else
+
+namespace
+{
+	constexpr auto poll_interval = std::chrono::milliseconds(500);
+
+	long long getModificationTime(std::string const& path)
+	{
+		struct stat file_stat;
+		if (::stat(path.c_str(), &file_stat) != 0)
+			return -1;
+		return static_cast<long long>(file_stat.st_mtime);
+	}
+}
+
+FileWatcher::FileWatcher() : _last_poll_time(std::chrono::steady_clock::now())
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+void
+FileWatcher::Watch(std::string const& path)
+{
+	if (_files.insert(path).second)
+		_modification_times.emplace(path, getModificationTime(path));
+}
+
+std::vector<std::string>
+FileWatcher::PollChangedFiles()
+{
+	std::vector<std::string> changed_files;
+
+	auto const now = std::chrono::steady_clock::now();
+	if (now - _last_poll_time < poll_interval)
+		return changed_files;
+	_last_poll_time = now;
+
+	for (auto& file : _modification_times) {
+		auto const modification_time = getModificationTime(file.first);
+		if (modification_time != file.second) {
+			file.second = modification_time;
+			changed_files.push_back(file.first);
+		}
+	}
+
+	return changed_files;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//! \brief Report which of a set of files were modified on disk.
+//!
+//! On Linux, this relies on inotify, watching the directories of the
+//! files rather than the files themselves, so that editors saving by
+//! replacing a file are noticed as well. Elsewhere, the modification
+//! times of the files are polled, at most twice per second.
+//!
+//! Paths are reported exactly as they were given to `Watch()`.
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(FileWatcher const&) = delete;
+	FileWatcher& operator=(FileWatcher const&) = delete;
+
+	//! \brief Start watching a file; watching it again has no effect.
+	void Watch(std::string const& path);
+
+	//! \brief Return the watched files modified since the last call,
+	//!        without blocking.
+	std::vector<std::string> PollChangedFiles();
+
+private:
+	std::unordered_set<std::string> _files;
+#if defined(__linux__)
+	int _inotify_fd{ -1 };
+	std::unordered_map<int, std::vector<std::string>> _directories; //!< directories, as written, of each watch descriptor
+	std::unordered_map<std::string, int> _watch_descriptors;
+#else
+	std::unordered_map<std::string, long long> _modification_times;
+	std::chrono::steady_clock::time_point _last_poll_time;
+#endif
+};
@@ -0,0 +1,636 @@
+#include "MeshCache.hpp"
+
+#include "core/various.hpp"
+
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#if defined(_WIN32)
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+namespace
+{
+	// Bump whenever the layout of the cache, or the way meshes are built,
+	// changes.
+	constexpr std::uint32_t version = 4u;
+	constexpr std::array<char, 8> magic{ { 'B', 'N', 'B', 'M', 'E', 'S', 'H', '\0' } };
+	// Caches are written in the native byte order; this lets readers with
+	// a different one reject them.
+	constexpr std::uint32_t byte_order_mark = 0x01020304u;
+	constexpr std::uint64_t data_alignment = 16u;
+
+	enum mesh_flags : std::uint32_t {
+		has_normals                = 1u << 0,
+		has_texcoords              = 1u << 1,
+		has_tangents_and_binormals = 1u << 2
+	};
+
+	//! \brief Read-only view of a whole file mapped into memory.
+	class MappedFile
+	{
+	public:
+		static std::shared_ptr<MappedFile const> Open(std::string const& path)
+		{
+			std::shared_ptr<MappedFile> file(new MappedFile());
+#if defined(_WIN32)
+			HANDLE const handle = ::CreateFileW(utils::widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (handle == INVALID_HANDLE_VALUE)
+				return nullptr;
+			LARGE_INTEGER size;
+			if (!::GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+				::CloseHandle(handle);
+				return nullptr;
+			}
+			HANDLE const mapping = ::CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			::CloseHandle(handle);
+			if (mapping == nullptr)
+				return nullptr;
+			// The view keeps the mapping alive once its handle is closed.
+			auto const data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			::CloseHandle(mapping);
+			if (data == nullptr)
+				return nullptr;
+			file->_data = static_cast<std::uint8_t const*>(data);
+			file->_size = static_cast<size_t>(size.QuadPart);
+#else
+			int const fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				return nullptr;
+			struct stat file_stat;
+			if (::fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+				::close(fd);
+				return nullptr;
+			}
+			auto const size = static_cast<size_t>(file_stat.st_size);
+			// The mapping stays valid once the file descriptor is closed.
+			auto const data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd);
+			if (data == MAP_FAILED)
+				return nullptr;
+			file->_data = static_cast<std::uint8_t const*>(data);
+			file->_size = size;
+#endif
+			return file;
+		}
+
+		~MappedFile()
+		{
+			if (_data == nullptr)
+				return;
+#if defined(_WIN32)
+			::UnmapViewOfFile(_data);
+#else
+			::munmap(const_cast<std::uint8_t*>(_data), _size);
+#endif
+		}
+
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+
+		std::uint8_t const* GetData() const { return _data; }
+		size_t GetSize() const { return _size; }
+
+	private:
+		MappedFile() = default;
+
+		std::uint8_t const* _data{ nullptr };
+		size_t _size{ 0u };
+	};
+
+	//! \brief Bounds-checked sequential reads from a memory range.
+	class Reader
+	{
+	public:
+		Reader(std::uint8_t const* data, size_t size) : _data(data), _size(size)
+		{
+		}
+
+		template<typename T>
+		bool Read(T& value)
+		{
+			if (sizeof(T) > _size - _offset)
+				return false;
+			std::memcpy(&value, _data + _offset, sizeof(T));
+			_offset += sizeof(T);
+			return true;
+		}
+
+		bool Read(std::string& value)
+		{
+			std::uint32_t length = 0u;
+			if (!Read(length) || length > _size - _offset)
+				return false;
+			value.assign(reinterpret_cast<char const*>(_data + _offset), length);
+			_offset += length;
+			return true;
+		}
+
+	private:
+		std::uint8_t const* _data;
+		size_t _size;
+		size_t _offset{ 0u };
+	};
+
+	//! \brief Sequential writes into a memory buffer.
+	class Writer
+	{
+	public:
+		template<typename T>
+		void Write(T const& value)
+		{
+			auto const bytes = reinterpret_cast<std::uint8_t const*>(&value);
+			_data.insert(_data.end(), bytes, bytes + sizeof(T));
+		}
+
+		void Write(std::string const& value)
+		{
+			Write(static_cast<std::uint32_t>(value.size()));
+			_data.insert(_data.end(), value.begin(), value.end());
+		}
+
+		std::vector<std::uint8_t> const& GetData() const { return _data; }
+
+	private:
+		std::vector<std::uint8_t> _data;
+	};
+
+	//! \brief File system used by Assimp, recording the files it opens.
+	class RecordingIOSystem : public Assimp::DefaultIOSystem
+	{
+	public:
+		Assimp::IOStream* Open(char const* file, char const* mode) override
+		{
+			auto const stream = Assimp::DefaultIOSystem::Open(file, mode);
+			if (stream != nullptr && _opened_files_set.emplace(file).second)
+				_opened_files.emplace_back(file);
+			return stream;
+		}
+
+		std::vector<std::string> const& GetOpenedFiles() const { return _opened_files; }
+
+	private:
+		std::vector<std::string> _opened_files;
+		std::unordered_set<std::string> _opened_files_set;
+	};
+
+	std::uint64_t align(std::uint64_t const value)
+	{
+		return (value + data_alignment - 1u) / data_alignment * data_alignment;
+	}
+
+	std::uint32_t getAttributesNb(MeshCache::Mesh const& mesh)
+	{
+		return 1u
+		     + (mesh.has_normals ? 1u : 0u)
+		     + (mesh.has_texcoords ? 1u : 0u)
+		     + (mesh.has_tangents_and_binormals ? 2u : 0u);
+	}
+}
+
+std::uint8_t const*
+MeshCache::Mesh::GetVertexData() const
+{
+	return mapped_vertex_data != nullptr ? mapped_vertex_data : vertex_data.data();
+}
+
+size_t
+MeshCache::Mesh::GetVertexDataSize() const
+{
+	return static_cast<size_t>(vertices_nb) * vertex_stride;
+}
+
+GLuint const*
+MeshCache::Mesh::GetIndices() const
+{
+	return mapped_indices != nullptr ? mapped_indices : indices.data();
+}
+
+std::string
+MeshCache::GetPath(std::string const& source_path)
+{
+	return source_path + ".meshcache";
+}
+
+MeshCache::Mesh
+MeshCache::BuildMesh(aiMesh const& assimp_mesh)
+{
+	auto const mesh_start_time = std::chrono::high_resolution_clock::now();
+
+	Mesh mesh;
+	if (assimp_mesh.mName.length != 0)
+		mesh.name = std::string(assimp_mesh.mName.C_Str());
+
+	if (!assimp_mesh.HasFaces()) {
+		mesh.error = "Unsupported mesh \"" + mesh.name + "\": has no faces";
+		return mesh;
+	}
+	if ((assimp_mesh.mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT))    != 0u
+	 && (assimp_mesh.mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE))     != 0u
+	 && (assimp_mesh.mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE)) != 0u) {
+		mesh.error = "Unsupported mesh \"" + mesh.name + "\": uses multiple primitive types";
+		return mesh;
+	}
+	if ((assimp_mesh.mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON)) {
+		mesh.error = "Unsupported mesh \"" + mesh.name + "\": uses polygons";
+		return mesh;
+	}
+	if (!assimp_mesh.HasPositions()) {
+		mesh.error = "Unsupported mesh \"" + mesh.name + "\": has no positions";
+		return mesh;
+	}
+
+	mesh.vertices_nb = assimp_mesh.mNumVertices;
+	mesh.has_normals = assimp_mesh.HasNormals();
+	mesh.has_texcoords = assimp_mesh.HasTextureCoords(0u);
+	mesh.has_tangents_and_binormals = assimp_mesh.HasTangentsAndBitangents();
+	mesh.material_id = assimp_mesh.mMaterialIndex;
+
+	std::vector<aiVector3D const*> attributes{ assimp_mesh.mVertices };
+	if (mesh.has_normals)
+		attributes.push_back(assimp_mesh.mNormals);
+	if (mesh.has_texcoords)
+		attributes.push_back(assimp_mesh.mTextureCoords[0u]);
+	if (mesh.has_tangents_and_binormals) {
+		attributes.push_back(assimp_mesh.mTangents);
+		attributes.push_back(assimp_mesh.mBitangents);
+	}
+	mesh.vertex_stride = static_cast<std::uint32_t>(attributes.size() * sizeof(glm::vec3));
+	mesh.vertex_data.resize(mesh.GetVertexDataSize());
+	for (size_t i = 0u; i < mesh.vertices_nb; ++i) {
+		auto vertex = mesh.vertex_data.data() + i * mesh.vertex_stride;
+		for (auto const attribute : attributes) {
+			std::memcpy(vertex, attribute + i, sizeof(glm::vec3));
+			vertex += sizeof(glm::vec3);
+		}
+	}
+
+	auto const num_vertices_per_face = assimp_mesh.mFaces[0u].mNumIndices;
+	mesh.indices.resize(static_cast<size_t>(assimp_mesh.mNumFaces) * num_vertices_per_face);
+	for (size_t i = 0u; i < assimp_mesh.mNumFaces; ++i) {
+		auto const& face = assimp_mesh.mFaces[i];
+		assert(face.mNumIndices <= 3);
+		for (size_t k = 0u; k < num_vertices_per_face; ++k)
+			mesh.indices[num_vertices_per_face * i + k] = face.mIndices[k];
+	}
+	mesh.indices_nb = static_cast<std::uint32_t>(mesh.indices.size());
+
+	if (num_vertices_per_face == 3u) {
+		auto const optimization = MeshOptimizer::Optimize(mesh.indices, mesh.vertices_nb, mesh.vertex_data.data(), mesh.vertex_stride);
+		MeshOptimizer::RemapVertices(mesh.vertex_data.data(), mesh.vertex_stride, optimization.remap);
+		mesh.vertex_cache_before = optimization.before;
+		mesh.vertex_cache_after = optimization.after;
+	}
+
+	auto const mesh_end_time = std::chrono::high_resolution_clock::now();
+	mesh.building_time_ms = std::chrono::duration<float, std::milli>(mesh_end_time - mesh_start_time).count();
+
+	return mesh;
+}
+
+void
+MeshCache::CollectMaterials(aiScene const& assimp_scene, Scene& scene,
+                            std::vector<std::string>& errors, std::vector<std::string>& warnings)
+{
+	std::vector<bool> are_materials_used(assimp_scene.mNumMaterials, false);
+	for (size_t j = 0; j < assimp_scene.mNumMeshes; ++j) {
+		auto const assimp_object_mesh = assimp_scene.mMeshes[j];
+		auto const material_id = assimp_object_mesh->mMaterialIndex;
+		if (material_id >= assimp_scene.mNumMaterials)
+			errors.push_back("Mesh \"" + std::string(assimp_object_mesh->mName.C_Str()) + "\" has a material index of " + std::to_string(material_id)
+			                 + ", but only " + std::to_string(assimp_scene.mNumMaterials) + " materials are present.");
+		else
+			are_materials_used[material_id] = true;
+	}
+
+	std::unordered_map<std::string, std::uint32_t> texture_indices;
+	scene.texture_paths.clear();
+	scene.materials_textures.assign(assimp_scene.mNumMaterials, std::vector<MaterialTexture>());
+	for (size_t i = 0; i < assimp_scene.mNumMaterials; ++i) {
+		if (!are_materials_used[i])
+			continue;
+
+		auto const material = assimp_scene.mMaterials[i];
+		auto const process_texture = [&](aiTextureType type, std::string const& type_as_str, std::string const& name){
+			if (material->GetTextureCount(type) == 0u)
+				return;
+
+			if (material->GetTextureCount(type) > 1)
+				warnings.push_back("Material \"" + std::string(material->GetName().C_Str()) + "\" has more than one " + type_as_str + " texture: discarding all but the first one.");
+			aiString path;
+			material->GetTexture(type, 0, &path);
+			auto const texture_index = texture_indices.emplace(std::string(path.C_Str()), static_cast<std::uint32_t>(scene.texture_paths.size()));
+			if (texture_index.second)
+				scene.texture_paths.emplace_back(path.C_Str());
+			scene.materials_textures[i].push_back({ name, texture_index.first->second });
+		};
+
+		process_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
+		process_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
+		process_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
+		process_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
+	}
+}
+
+std::uint64_t
+MeshCache::ComputeSourceHash(std::string const& source_path, std::vector<std::string> const& dependencies)
+{
+	auto hash = utils::hash_file(source_path);
+	if (hash == 0u)
+		return 0u;
+
+	for (auto const& dependency : dependencies) {
+		auto const dependency_hash = utils::hash_file(dependency);
+		if (dependency_hash == 0u)
+			return 0u;
+		// Include the terminator, so that consecutive paths can not be
+		// confused with one another.
+		hash = utils::hash_data(dependency.c_str(), dependency.size() + 1u, hash);
+		hash = utils::hash_data(&dependency_hash, sizeof(dependency_hash), hash);
+	}
+
+	return hash;
+}
+
+aiScene const*
+MeshCache::Import(Assimp::Importer& importer, std::string const& source_path,
+                  std::vector<std::string>& dependencies, std::string& error)
+{
+	// The importer takes ownership of the file system.
+	auto const io_system = new RecordingIOSystem();
+	importer.SetIOHandler(io_system);
+	auto const assimp_scene = importer.ReadFile(source_path, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace);
+
+	dependencies.clear();
+	for (auto const& file : io_system->GetOpenedFiles()) {
+		if (file != source_path)
+			dependencies.push_back(file);
+	}
+
+	if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
+		error = "Assimp failed to load \"" + source_path + "\": " + importer.GetErrorString();
+		return nullptr;
+	}
+
+	if (assimp_scene->mNumMeshes == 0u) {
+		error = "No mesh available; loading \"" + source_path + "\" must have had issues";
+		return nullptr;
+	}
+
+	return assimp_scene;
+}
+
+bool
+MeshCache::Build(std::string const& source_path, Scene& scene, std::string& error)
+{
+	scene = Scene();
+
+	Assimp::Importer importer;
+	auto const assimp_scene = Import(importer, source_path, scene.dependencies, error);
+	if (assimp_scene == nullptr)
+		return false;
+
+	scene.source_hash = ComputeSourceHash(source_path, scene.dependencies);
+	if (scene.source_hash == 0u) {
+		error = "Failed to read \"" + source_path + "\" or one of its dependencies";
+		return false;
+	}
+
+	std::vector<std::string> errors;
+	std::vector<std::string> warnings;
+	CollectMaterials(*assimp_scene, scene, errors, warnings);
+
+	scene.meshes.reserve(assimp_scene->mNumMeshes);
+	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j)
+		scene.meshes.push_back(std::make_shared<Mesh const>(BuildMesh(*assimp_scene->mMeshes[j])));
+
+	return true;
+}
+
+bool
+MeshCache::Read(std::string const& path, std::string const& source_path, Scene& scene, std::string& error)
+{
+	scene = Scene();
+
+	auto const file = MappedFile::Open(path);
+	if (file == nullptr) {
+		error = "No cache found at \"" + path + "\"";
+		return false;
+	}
+
+	auto const corrupt = [&error, &path](){
+		error = "Cache \"" + path + "\" is corrupt";
+		return false;
+	};
+
+	Reader reader(file->GetData(), file->GetSize());
+	std::array<char, 8> file_magic;
+	std::uint32_t file_version = 0u;
+	std::uint32_t file_byte_order_mark = 0u;
+	if (!reader.Read(file_magic) || !reader.Read(file_version) || !reader.Read(file_byte_order_mark))
+		return corrupt();
+	if (file_magic != magic)
+		return corrupt();
+	if (file_version != version || file_byte_order_mark != byte_order_mark) {
+		error = "Cache \"" + path + "\" was written by a different version";
+		return false;
+	}
+
+	std::uint32_t dependencies_nb = 0u;
+	if (!reader.Read(scene.source_hash) || !reader.Read(dependencies_nb) || dependencies_nb > file->GetSize())
+		return corrupt();
+	scene.dependencies.resize(dependencies_nb);
+	for (auto& dependency : scene.dependencies) {
+		if (!reader.Read(dependency))
+			return corrupt();
+	}
+	if (scene.source_hash != ComputeSourceHash(source_path, scene.dependencies)) {
+		error = "Cache \"" + path + "\" is out of date";
+		return false;
+	}
+
+	std::uint32_t textures_nb = 0u;
+	std::uint32_t materials_nb = 0u;
+	std::uint32_t meshes_nb = 0u;
+	if (!reader.Read(textures_nb) || !reader.Read(materials_nb) || !reader.Read(meshes_nb))
+		return corrupt();
+
+	scene.texture_paths.resize(textures_nb);
+	for (auto& texture_path : scene.texture_paths) {
+		if (!reader.Read(texture_path))
+			return corrupt();
+	}
+
+	scene.materials_textures.resize(materials_nb);
+	for (auto& material_textures : scene.materials_textures) {
+		std::uint32_t material_textures_nb = 0u;
+		if (!reader.Read(material_textures_nb) || material_textures_nb > textures_nb)
+			return corrupt();
+		material_textures.resize(material_textures_nb);
+		for (auto& texture : material_textures) {
+			if (!reader.Read(texture.binding_name) || !reader.Read(texture.texture_index) || texture.texture_index >= textures_nb)
+				return corrupt();
+		}
+	}
+
+	scene.meshes.reserve(meshes_nb);
+	for (std::uint32_t i = 0u; i < meshes_nb; ++i) {
+		Mesh mesh;
+		std::uint32_t flags = 0u;
+		std::uint64_t vertex_data_offset = 0u;
+		std::uint64_t indices_offset = 0u;
+		if (!reader.Read(mesh.name) || !reader.Read(mesh.error) || !reader.Read(flags) || !reader.Read(mesh.vertices_nb) || !reader.Read(mesh.vertex_stride)
+		 || !reader.Read(mesh.indices_nb) || !reader.Read(mesh.material_id) || !reader.Read(mesh.vertex_cache_before)
+		 || !reader.Read(mesh.vertex_cache_after) || !reader.Read(vertex_data_offset) || !reader.Read(indices_offset))
+			return corrupt();
+
+		// Meshes which could not be built only keep their error, so that
+		// it gets reported again.
+		if (!mesh.error.empty()) {
+			if (mesh.vertices_nb != 0u || mesh.indices_nb != 0u)
+				return corrupt();
+			scene.meshes.push_back(std::make_shared<Mesh const>(std::move(mesh)));
+			continue;
+		}
+
+		mesh.has_normals = (flags & has_normals) != 0u;
+		mesh.has_texcoords = (flags & has_texcoords) != 0u;
+		mesh.has_tangents_and_binormals = (flags & has_tangents_and_binormals) != 0u;
+		if (mesh.vertex_stride != getAttributesNb(mesh) * sizeof(glm::vec3))
+			return corrupt();
+
+		auto const vertex_data_size = static_cast<std::uint64_t>(mesh.GetVertexDataSize());
+		auto const indices_size = static_cast<std::uint64_t>(mesh.indices_nb) * sizeof(GLuint);
+		if (vertex_data_offset % data_alignment != 0u || indices_offset % data_alignment != 0u
+		 || vertex_data_offset > file->GetSize() || vertex_data_size > file->GetSize() - vertex_data_offset
+		 || indices_offset > file->GetSize() || indices_size > file->GetSize() - indices_offset)
+			return corrupt();
+
+		mesh.mapped_vertex_data = file->GetData() + vertex_data_offset;
+		mesh.mapped_indices = reinterpret_cast<GLuint const*>(file->GetData() + indices_offset);
+		mesh.mapping = file;
+		scene.meshes.push_back(std::make_shared<Mesh const>(std::move(mesh)));
+	}
+
+	return true;
+}
+
+bool
+MeshCache::Write(std::string const& path, Scene const& scene, std::string& error)
+{
+	std::vector<Mesh const*> meshes;
+	meshes.reserve(scene.meshes.size());
+	for (auto const& mesh : scene.meshes) {
+		if (mesh != nullptr)
+			meshes.push_back(mesh.get());
+	}
+
+	// The metadata comes first; its size is needed to know where the vertex
+	// and index data will start, but does not depend on those offsets.
+	auto const write_metadata = [&scene, &meshes](std::vector<std::uint64_t> const& offsets){
+		Writer writer;
+		writer.Write(magic);
+		writer.Write(version);
+		writer.Write(byte_order_mark);
+		writer.Write(scene.source_hash);
+		writer.Write(static_cast<std::uint32_t>(scene.dependencies.size()));
+		for (auto const& dependency : scene.dependencies)
+			writer.Write(dependency);
+		writer.Write(static_cast<std::uint32_t>(scene.texture_paths.size()));
+		writer.Write(static_cast<std::uint32_t>(scene.materials_textures.size()));
+		writer.Write(static_cast<std::uint32_t>(meshes.size()));
+		for (auto const& texture_path : scene.texture_paths)
+			writer.Write(texture_path);
+		for (auto const& material_textures : scene.materials_textures) {
+			writer.Write(static_cast<std::uint32_t>(material_textures.size()));
+			for (auto const& texture : material_textures) {
+				writer.Write(texture.binding_name);
+				writer.Write(texture.texture_index);
+			}
+		}
+		for (size_t i = 0u; i < meshes.size(); ++i) {
+			auto const& mesh = *meshes[i];
+			std::uint32_t const flags = (mesh.has_normals ? has_normals : 0u)
+			                          | (mesh.has_texcoords ? has_texcoords : 0u)
+			                          | (mesh.has_tangents_and_binormals ? has_tangents_and_binormals : 0u);
+			writer.Write(mesh.name);
+			writer.Write(mesh.error);
+			writer.Write(flags);
+			writer.Write(mesh.vertices_nb);
+			writer.Write(mesh.vertex_stride);
+			writer.Write(mesh.indices_nb);
+			writer.Write(mesh.material_id);
+			writer.Write(mesh.vertex_cache_before);
+			writer.Write(mesh.vertex_cache_after);
+			writer.Write(offsets.empty() ? std::uint64_t(0u) : offsets[2u * i + 0u]);
+			writer.Write(offsets.empty() ? std::uint64_t(0u) : offsets[2u * i + 1u]);
+		}
+		return writer.GetData();
+	};
+
+	std::vector<std::uint64_t> offsets;
+	offsets.reserve(2u * meshes.size());
+	auto offset = align(write_metadata(offsets).size());
+	for (auto const mesh : meshes) {
+		offsets.push_back(offset);
+		offset = align(offset + mesh->GetVertexDataSize());
+		offsets.push_back(offset);
+		offset = align(offset + static_cast<std::uint64_t>(mesh->indices_nb) * sizeof(GLuint));
+	}
+	auto const metadata = write_metadata(offsets);
+
+	// Write to a temporary file first, so that an interrupted write never
+	// leaves a truncated cache behind.
+	auto const temporary_path = path + ".tmp";
+	{
+		std::ofstream file(utils::widen(temporary_path), std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			error = "Failed to open \"" + temporary_path + "\" for writing";
+			return false;
+		}
+
+		std::array<char, data_alignment> const padding{};
+		auto const write_padded = [&file, &padding](void const* data, size_t size){
+			file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+			file.write(padding.data(), static_cast<std::streamsize>(align(size) - size));
+		};
+		write_padded(metadata.data(), metadata.size());
+		for (auto const mesh : meshes) {
+			write_padded(mesh->GetVertexData(), mesh->GetVertexDataSize());
+			write_padded(mesh->GetIndices(), static_cast<size_t>(mesh->indices_nb) * sizeof(GLuint));
+		}
+
+		if (!file) {
+			error = "Failed to write \"" + temporary_path + "\"";
+			file.close();
+			std::remove(temporary_path.c_str());
+			return false;
+		}
+	}
+
+	std::remove(path.c_str());
+	if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+		error = "Failed to move \"" + temporary_path + "\" to \"" + path + "\"";
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "MeshOptimizer.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct aiMesh;
+struct aiScene;
+namespace Assimp
+{
+	class Importer;
+}
+
+//! \brief Binary cache of the meshes and materials of a scene file, so
+//!        that Assimp only needs to process that file once.
+//!
+//! A cache is stored next to its source file, with the extension
+//! ".meshcache" appended, and records a hash of the content of the source
+//! file and of every other file Assimp read while importing it, such as
+//! material libraries (see `ComputeSourceHash()`): a cache is only used if
+//! its version and hash match. It is memory-mapped when read, and the
+//! vertex and index data of each mesh are uploaded straight from the
+//! mapping.
+namespace MeshCache
+{
+	//! \brief A texture used by a material, and the name of the sampler it
+	//!        should be bound to.
+	struct MaterialTexture {
+		std::string binding_name;
+		std::uint32_t texture_index; //!< index into `Scene::texture_paths`
+	};
+
+	//! \brief Vertex and index data of a mesh, ready to be uploaded.
+	//!
+	//! Vertex attributes are interleaved, in the order of their binding
+	//! points; missing attributes are skipped. All attributes are three
+	//! floats. Triangles and vertices are ordered by `MeshOptimizer`.
+	struct Mesh {
+		std::string name{"un-named mesh"};
+		std::string error; //!< reason why the mesh can not be used, if any
+		bool has_normals{ false };
+		bool has_texcoords{ false };
+		bool has_tangents_and_binormals{ false };
+		std::uint32_t vertices_nb{ 0u };
+		std::uint32_t vertex_stride{ 0u };
+		std::uint32_t indices_nb{ 0u };
+		std::uint32_t material_id{ 0u };
+		float building_time_ms{ 0.0f };
+		//! \brief Post-transform cache efficiency of the indices before
+		//!        and after being optimised; both are zero for meshes
+		//!        which are not triangle lists.
+		MeshOptimizer::CacheStatistics vertex_cache_before;
+		MeshOptimizer::CacheStatistics vertex_cache_after;
+
+		//! \brief Data owned by the mesh, when built from an Assimp mesh.
+		std::vector<std::uint8_t> vertex_data;
+		std::vector<GLuint> indices;
+
+		//! \brief Data living in a memory-mapped cache, when read from one;
+		//!        |mapping| keeps it alive.
+		std::uint8_t const* mapped_vertex_data{ nullptr };
+		GLuint const* mapped_indices{ nullptr };
+		std::shared_ptr<void const> mapping;
+
+		std::uint8_t const* GetVertexData() const;
+		size_t GetVertexDataSize() const;
+		GLuint const* GetIndices() const;
+	};
+
+	//! \brief Everything stored in a cache.
+	struct Scene {
+		std::uint64_t source_hash{ 0u };
+		//! \brief Other files read by Assimp, as it opened them.
+		std::vector<std::string> dependencies;
+		std::vector<std::string> texture_paths; //!< relative to the folder of the source file
+		std::vector<std::vector<MaterialTexture>> materials_textures;
+		std::vector<std::shared_ptr<Mesh const>> meshes;
+	};
+
+	//! \brief Retrieve the path of the cache for a given scene file.
+	std::string GetPath(std::string const& source_path);
+
+	//! \brief Hash the content of a scene file and of the files it
+	//!        depends on.
+	//!
+	//! @param [in] source_path path to the scene file
+	//! @param [in] dependencies paths to the other files read when
+	//!             importing it
+	//! @return the hash, or 0 if any of those files could not be read
+	std::uint64_t ComputeSourceHash(std::string const& source_path, std::vector<std::string> const& dependencies);
+
+	//! \brief Convert an Assimp mesh into interleaved vertex data and
+	//!        indices, and optimise the order of its triangles and
+	//!        vertices.
+	//!
+	//! This does not use any OpenGL function and can therefore be called
+	//! from any thread.
+	Mesh BuildMesh(aiMesh const& assimp_mesh);
+
+	//! \brief Collect the textures used by the materials of an Assimp
+	//!        scene.
+	//!
+	//! Only the first diffuse, specular, normals and opacity textures of
+	//! each material are kept, and textures shared by several materials
+	//! are only listed once. Materials not used by any mesh get no
+	//! textures.
+	//!
+	//! @param [in] assimp_scene the scene to process
+	//! @param [out] scene where the texture paths and materials textures
+	//!              are written to
+	//! @param [out] errors messages about meshes using invalid materials
+	//! @param [out] warnings messages about discarded textures
+	void CollectMaterials(aiScene const& assimp_scene, Scene& scene,
+	                      std::vector<std::string>& errors, std::vector<std::string>& warnings);
+
+	//! \brief Import a scene file with Assimp, using the post-processing
+	//!        steps expected by `BuildMesh()`.
+	//!
+	//! @param [in] importer the importer which will own the scene
+	//! @param [in] source_path path to the scene file
+	//! @param [out] dependencies the other files Assimp read, such as
+	//!              material libraries
+	//! @param [out] error reason for the failure, if any
+	//! @return the imported scene, or null if it could not be imported or
+	//!         contains no meshes
+	aiScene const* Import(Assimp::Importer& importer, std::string const& source_path,
+	                      std::vector<std::string>& dependencies, std::string& error);
+
+	//! \brief Import a scene file with Assimp and build all of its meshes.
+	//!
+	//! @param [in] source_path path to the scene file
+	//! @param [out] scene the resulting scene, including the hash of
+	//!              |source_path| and of its dependencies
+	//! @param [out] error reason for the failure, if any
+	//! @return whether the scene could be imported
+	bool Build(std::string const& source_path, Scene& scene, std::string& error);
+
+	//! \brief Memory-map a cache and parse it.
+	//!
+	//! The hash of the source file and of the dependencies recorded in the
+	//! cache is computed again, and compared to the recorded one.
+	//!
+	//! @param [in] path path to the cache
+	//! @param [in] source_path path to the scene file the cache was built
+	//!             from
+	//! @param [out] scene the content of the cache; the vertex and index
+	//!              data of its meshes point into the mapping
+	//! @param [out] error reason for the failure, if any
+	//! @return false if the cache does not exist, is of a different
+	//!         version, was built from a different source, or is corrupt
+	bool Read(std::string const& path, std::string const& source_path, Scene& scene, std::string& error);
+
+	//! \brief Write a cache, replacing any existing one.
+	//!
+	//! Missing meshes are not written, and meshes with an error are
+	//! written without any data, so that `Read()` returns them with the
+	//! same error.
+	//!
+	//! @param [in] path path to the cache
+	//! @param [in] scene the content to write
+	//! @param [out] error reason for the failure, if any
+	//! @return whether the cache was successfully written
+	bool Write(std::string const& path, Scene const& scene, std::string& error);
+}
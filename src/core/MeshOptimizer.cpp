@@ -0,0 +1,341 @@
+#include "MeshOptimizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+	//! \brief FIFO post-transform cache, where each vertex is stamped with
+	//!        the number of misses seen when it was inserted.
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertices_nb, size_t cache_size) : _stamps(vertices_nb, 0u), _cache_size(cache_size)
+		{
+		}
+
+		//! \brief Look a vertex up, inserting it on a miss.
+		//!
+		//! @return whether the vertex was missing
+		bool Access(GLuint const vertex)
+		{
+			if (_stamps[vertex] != 0u && _misses_nb + 1u - _stamps[vertex] <= _cache_size)
+				return false;
+			_stamps[vertex] = ++_misses_nb;
+			return true;
+		}
+
+		//! \brief Evict all vertices.
+		void Flush()
+		{
+			_misses_nb += _cache_size;
+		}
+
+	private:
+		std::vector<size_t> _stamps;
+		size_t _cache_size;
+		size_t _misses_nb{ 0u };
+	};
+
+	//! \brief For each vertex, the triangles referencing it.
+	struct Adjacency {
+		std::vector<size_t> offsets;   //!< triangles of vertex v are in [offsets[v], offsets[v + 1])
+		std::vector<size_t> triangles;
+	};
+
+	Adjacency buildAdjacency(std::vector<GLuint> const& indices, size_t const vertices_nb)
+	{
+		Adjacency adjacency;
+		adjacency.offsets.assign(vertices_nb + 1u, 0u);
+		for (auto const index : indices)
+			++adjacency.offsets[index + 1u];
+		std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+		adjacency.triangles.resize(indices.size());
+		std::vector<size_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		for (size_t i = 0u; i < indices.size(); ++i)
+			adjacency.triangles[fill[indices[i]]++] = i / 3u;
+
+		return adjacency;
+	}
+
+	glm::vec3 readPosition(void const* const positions, size_t const stride, GLuint const index)
+	{
+		glm::vec3 position;
+		std::memcpy(&position, static_cast<std::uint8_t const*>(positions) + index * stride, sizeof(position));
+		return position;
+	}
+}
+
+MeshOptimizer::CacheStatistics
+MeshOptimizer::AnalyzeVertexCache(GLuint const* const indices, size_t const indices_nb, size_t const vertices_nb,
+                                  size_t const cache_size)
+{
+	CacheStatistics statistics;
+	if (indices_nb < 3u || vertices_nb == 0u)
+		return statistics;
+
+	FifoCache cache(vertices_nb, cache_size);
+	std::vector<bool> is_referenced(vertices_nb, false);
+	size_t misses_nb = 0u;
+	size_t referenced_nb = 0u;
+	for (size_t i = 0u; i < indices_nb; ++i) {
+		auto const vertex = indices[i];
+		assert(vertex < vertices_nb);
+		if (cache.Access(vertex))
+			++misses_nb;
+		if (!is_referenced[vertex]) {
+			is_referenced[vertex] = true;
+			++referenced_nb;
+		}
+	}
+
+	statistics.acmr = static_cast<float>(misses_nb) / static_cast<float>(indices_nb / 3u);
+	statistics.atvr = static_cast<float>(misses_nb) / static_cast<float>(referenced_nb);
+	return statistics;
+}
+
+std::vector<size_t>
+MeshOptimizer::OptimizeVertexCache(std::vector<GLuint>& indices, size_t const vertices_nb, size_t const cache_size)
+{
+	assert(indices.size() % 3u == 0u);
+
+	std::vector<size_t> clusters;
+	auto const triangles_nb = indices.size() / 3u;
+	if (triangles_nb == 0u)
+		return clusters;
+
+	auto const adjacency = buildAdjacency(indices, vertices_nb);
+
+	std::vector<size_t> live_triangles_nb(vertices_nb);
+	for (size_t v = 0u; v < vertices_nb; ++v)
+		live_triangles_nb[v] = adjacency.offsets[v + 1u] - adjacency.offsets[v];
+
+	// Cache time stamps; a vertex is in the cache if it was inserted at
+	// most |cache_size| insertions ago.
+	std::vector<size_t> stamps(vertices_nb, 0u);
+	size_t time = cache_size + 1u;
+
+	std::vector<bool> is_emitted(triangles_nb, false);
+	std::vector<GLuint> dead_ends;
+	std::vector<GLuint> candidates;
+	std::vector<GLuint> output;
+	output.reserve(indices.size());
+
+	size_t cursor = 0u;
+	auto const skip_dead_end = [&]() -> long long {
+		while (!dead_ends.empty()) {
+			auto const vertex = dead_ends.back();
+			dead_ends.pop_back();
+			if (live_triangles_nb[vertex] > 0u)
+				return static_cast<long long>(vertex);
+		}
+		for (; cursor < vertices_nb; ++cursor) {
+			if (live_triangles_nb[cursor] > 0u)
+				return static_cast<long long>(cursor);
+		}
+		return -1;
+	};
+
+	clusters.push_back(0u);
+	auto fanning_vertex = skip_dead_end();
+	while (fanning_vertex >= 0) {
+		candidates.clear();
+		auto const f = static_cast<size_t>(fanning_vertex);
+		for (auto k = adjacency.offsets[f]; k < adjacency.offsets[f + 1u]; ++k) {
+			auto const triangle = adjacency.triangles[k];
+			if (is_emitted[triangle])
+				continue;
+
+			for (size_t c = 0u; c < 3u; ++c) {
+				auto const vertex = indices[3u * triangle + c];
+				output.push_back(vertex);
+				dead_ends.push_back(vertex);
+				candidates.push_back(vertex);
+				--live_triangles_nb[vertex];
+				if (time - stamps[vertex] > cache_size)
+					stamps[vertex] = time++;
+			}
+			is_emitted[triangle] = true;
+		}
+
+		// Prefer the candidate which will still be in the cache after its
+		// remaining triangles were emitted, and was inserted the earliest.
+		long long next_vertex = -1;
+		long long best_priority = -1;
+		for (auto const vertex : candidates) {
+			if (live_triangles_nb[vertex] == 0u)
+				continue;
+
+			long long priority = 0;
+			if (time - stamps[vertex] + 2u * live_triangles_nb[vertex] <= cache_size)
+				priority = static_cast<long long>(time - stamps[vertex]);
+			if (priority > best_priority) {
+				best_priority = priority;
+				next_vertex = static_cast<long long>(vertex);
+			}
+		}
+		if (next_vertex < 0) {
+			next_vertex = skip_dead_end();
+			if (next_vertex >= 0 && output.size() / 3u < triangles_nb)
+				clusters.push_back(output.size() / 3u);
+		}
+		fanning_vertex = next_vertex;
+	}
+
+	assert(output.size() == indices.size());
+	indices.swap(output);
+	return clusters;
+}
+
+void
+MeshOptimizer::OptimizeOverdraw(std::vector<GLuint>& indices, std::vector<size_t> const& clusters,
+                                void const* const positions, size_t const positions_stride, size_t const vertices_nb,
+                                float const threshold)
+{
+	assert(indices.size() % 3u == 0u);
+
+	auto const triangles_nb = indices.size() / 3u;
+	if (triangles_nb == 0u || clusters.empty())
+		return;
+
+	// Split each cluster wherever the triangles emitted so far reuse the
+	// cache nearly as well as the whole cluster does.
+	std::vector<size_t> soft_clusters;
+	FifoCache cache(vertices_nb, default_cache_size);
+	for (size_t c = 0u; c < clusters.size(); ++c) {
+		auto const begin = clusters[c];
+		auto const end = c + 1u < clusters.size() ? clusters[c + 1u] : triangles_nb;
+
+		cache.Flush();
+		size_t cluster_misses_nb = 0u;
+		for (auto i = 3u * begin; i < 3u * end; ++i)
+			cluster_misses_nb += cache.Access(indices[i]) ? 1u : 0u;
+		auto const cluster_acmr = static_cast<float>(cluster_misses_nb) / static_cast<float>(end - begin);
+
+		cache.Flush();
+		soft_clusters.push_back(begin);
+		size_t misses_nb = 0u;
+		size_t running_triangles_nb = 0u;
+		for (auto t = begin; t < end; ++t) {
+			for (size_t k = 0u; k < 3u; ++k)
+				misses_nb += cache.Access(indices[3u * t + k]) ? 1u : 0u;
+			++running_triangles_nb;
+			if (t + 1u < end && static_cast<float>(misses_nb) <= threshold * cluster_acmr * static_cast<float>(running_triangles_nb)) {
+				soft_clusters.push_back(t + 1u);
+				cache.Flush();
+				misses_nb = 0u;
+				running_triangles_nb = 0u;
+			}
+		}
+	}
+
+	// Clusters facing away from the centre of the mesh are the most likely
+	// to hide others, so they are drawn first.
+	std::vector<glm::vec3> centroids(soft_clusters.size(), glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(soft_clusters.size(), glm::vec3(0.0f));
+	glm::vec3 mesh_centroid(0.0f);
+	float mesh_area = 0.0f;
+	for (size_t c = 0u; c < soft_clusters.size(); ++c) {
+		auto const begin = soft_clusters[c];
+		auto const end = c + 1u < soft_clusters.size() ? soft_clusters[c + 1u] : triangles_nb;
+
+		float cluster_area = 0.0f;
+		for (auto t = begin; t < end; ++t) {
+			auto const p0 = readPosition(positions, positions_stride, indices[3u * t + 0u]);
+			auto const p1 = readPosition(positions, positions_stride, indices[3u * t + 1u]);
+			auto const p2 = readPosition(positions, positions_stride, indices[3u * t + 2u]);
+			auto const normal = glm::cross(p1 - p0, p2 - p0);
+			auto const area = glm::length(normal);
+			centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+			normals[c] += normal;
+			cluster_area += area;
+		}
+
+		mesh_centroid += centroids[c];
+		mesh_area += cluster_area;
+		if (cluster_area > 0.0f)
+			centroids[c] /= cluster_area;
+		auto const normal_length = glm::length(normals[c]);
+		if (normal_length > 0.0f)
+			normals[c] /= normal_length;
+	}
+	if (mesh_area > 0.0f)
+		mesh_centroid /= mesh_area;
+
+	std::vector<float> sort_keys(soft_clusters.size());
+	for (size_t c = 0u; c < soft_clusters.size(); ++c)
+		sort_keys[c] = glm::dot(centroids[c] - mesh_centroid, normals[c]);
+
+	std::vector<size_t> order(soft_clusters.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&sort_keys](size_t const lhs, size_t const rhs){
+		return sort_keys[lhs] > sort_keys[rhs];
+	});
+
+	std::vector<GLuint> output;
+	output.reserve(indices.size());
+	for (auto const c : order) {
+		auto const begin = soft_clusters[c];
+		auto const end = c + 1u < soft_clusters.size() ? soft_clusters[c + 1u] : triangles_nb;
+		output.insert(output.end(), indices.begin() + 3u * begin, indices.begin() + 3u * end);
+	}
+	indices.swap(output);
+}
+
+std::vector<GLuint>
+MeshOptimizer::OptimizeVertexFetch(std::vector<GLuint>& indices, size_t const vertices_nb)
+{
+	auto constexpr unassigned = ~GLuint(0u);
+	std::vector<GLuint> new_indices(vertices_nb, unassigned);
+	std::vector<GLuint> remap;
+	remap.reserve(vertices_nb);
+
+	for (auto& index : indices) {
+		if (new_indices[index] == unassigned) {
+			new_indices[index] = static_cast<GLuint>(remap.size());
+			remap.push_back(index);
+		}
+		index = new_indices[index];
+	}
+	for (GLuint v = 0u; v < vertices_nb; ++v) {
+		if (new_indices[v] == unassigned)
+			remap.push_back(v);
+	}
+
+	return remap;
+}
+
+MeshOptimizer::Result
+MeshOptimizer::Optimize(std::vector<GLuint>& indices, size_t const vertices_nb,
+                        void const* const positions, size_t const positions_stride)
+{
+	auto const start_time = std::chrono::high_resolution_clock::now();
+
+	Result result;
+	result.before = AnalyzeVertexCache(indices.data(), indices.size(), vertices_nb);
+
+	auto const clusters = OptimizeVertexCache(indices, vertices_nb);
+	OptimizeOverdraw(indices, clusters, positions, positions_stride, vertices_nb);
+	result.remap = OptimizeVertexFetch(indices, vertices_nb);
+
+	result.after = AnalyzeVertexCache(indices.data(), indices.size(), vertices_nb);
+
+	auto const end_time = std::chrono::high_resolution_clock::now();
+	result.optimization_time_ms = std::chrono::duration<float, std::milli>(end_time - start_time).count();
+
+	return result;
+}
+
+void
+MeshOptimizer::RemapVertices(std::uint8_t* const data, size_t const stride, std::vector<GLuint> const& remap)
+{
+	std::vector<std::uint8_t> const source(data, data + remap.size() * stride);
+	for (size_t i = 0u; i < remap.size(); ++i)
+		std::memcpy(data + i * stride, source.data() + static_cast<size_t>(remap[i]) * stride, stride);
+}
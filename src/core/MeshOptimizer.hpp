@@ -0,0 +1,121 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! \brief Reordering of the triangles and vertices of indexed triangle
+//!        lists, to make better use of the post-transform vertex cache,
+//!        reduce overdraw, and fetch vertex data linearly.
+//!
+//! None of these functions use OpenGL, so they can be called from any
+//! thread.
+namespace MeshOptimizer
+{
+	//! \brief Size of the FIFO post-transform cache the triangle order is
+	//!        optimised for, and which is simulated by
+	//!        `AnalyzeVertexCache()`.
+	constexpr size_t default_cache_size = 16u;
+
+	//! \brief How well an index buffer uses a simulated FIFO
+	//!        post-transform cache.
+	struct CacheStatistics {
+		//! \brief Average Cache Miss Ratio: vertices transformed per
+		//!        triangle; 0.5 at best for large regular meshes, 3 at
+		//!        worst.
+		float acmr{ 0.0f };
+		//! \brief Average Transform to Vertex Ratio: vertices transformed
+		//!        per vertex referenced; 1 at best.
+		float atvr{ 0.0f };
+	};
+
+	//! \brief Outcome of `Optimize()`.
+	struct Result {
+		CacheStatistics before;
+		CacheStatistics after;
+		//! \brief Old index of each vertex, in its new order; vertex
+		//!        attributes have to be reordered with `RemapVertices()`
+		//!        to match the new index buffer.
+		std::vector<GLuint> remap;
+		float optimization_time_ms{ 0.0f };
+	};
+
+	//! \brief Simulate a FIFO post-transform cache over a triangle list.
+	//!
+	//! @param [in] indices the triangle list
+	//! @param [in] indices_nb number of indices, a multiple of 3
+	//! @param [in] vertices_nb number of vertices referenced by |indices|
+	//! @param [in] cache_size number of entries of the simulated cache
+	CacheStatistics AnalyzeVertexCache(GLuint const* indices, size_t indices_nb, size_t vertices_nb,
+	                                   size_t cache_size = default_cache_size);
+
+	//! \brief Reorder triangles for the post-transform cache, using
+	//!        Tipsify (Sander et al., "Fast Triangle Reordering for Vertex
+	//!        Locality and Reduced Overdraw", 2007).
+	//!
+	//! @param [in,out] indices the triangle list to reorder
+	//! @param [in] vertices_nb number of vertices referenced by |indices|
+	//! @param [in] cache_size number of entries of the targeted cache
+	//! @return the index of the first triangle of each cluster, i.e. each
+	//!         run of triangles started after a cache flush, in order
+	std::vector<size_t> OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertices_nb,
+	                                        size_t cache_size = default_cache_size);
+
+	//! \brief Reorder the clusters of a cache-optimised triangle list so
+	//!        that the ones most likely to occlude others are drawn first.
+	//!
+	//! Clusters are first split further wherever doing so barely affects
+	//! their cache efficiency (at most |threshold| times their ACMR),
+	//! then sorted by how much they face away from the centre of the mesh.
+	//!
+	//! @param [in,out] indices the triangle list to reorder
+	//! @param [in] clusters as returned by `OptimizeVertexCache()`
+	//! @param [in] positions first position, as three floats
+	//! @param [in] positions_stride bytes between two consecutive positions
+	//! @param [in] vertices_nb number of vertices referenced by |indices|
+	//! @param [in] threshold how much the ACMR may degrade to form more,
+	//!             smaller, clusters
+	void OptimizeOverdraw(std::vector<GLuint>& indices, std::vector<size_t> const& clusters,
+	                      void const* positions, size_t positions_stride, size_t vertices_nb,
+	                      float threshold = 1.05f);
+
+	//! \brief Renumber vertices in the order they are first referenced,
+	//!        so that vertex data is fetched as linearly as possible.
+	//!
+	//! Vertices which are never referenced keep their relative order and
+	//! end up after all others.
+	//!
+	//! @param [in,out] indices the triangle list to rewrite
+	//! @param [in] vertices_nb number of vertices
+	//! @return the old index of each vertex, in its new order
+	std::vector<GLuint> OptimizeVertexFetch(std::vector<GLuint>& indices, size_t vertices_nb);
+
+	//! \brief Run all optimisations, in order: vertex cache, overdraw and
+	//!        vertex fetch.
+	//!
+	//! @param [in,out] indices a triangle list
+	//! @param [in] vertices_nb number of vertices referenced by |indices|
+	//! @param [in] positions first position, as three floats
+	//! @param [in] positions_stride bytes between two consecutive positions
+	Result Optimize(std::vector<GLuint>& indices, size_t vertices_nb,
+	                void const* positions, size_t positions_stride);
+
+	//! \brief Reorder interleaved vertex data following a remap table.
+	//!
+	//! @param [in,out] data |remap.size()| vertices of |stride| bytes each
+	//! @param [in] stride bytes used by each vertex
+	//! @param [in] remap the old index of each vertex, in its new order
+	void RemapVertices(std::uint8_t* data, size_t stride, std::vector<GLuint> const& remap);
+
+	//! \brief Reorder one planar vertex attribute following a remap
+	//!        table.
+	template<typename T>
+	void RemapVertices(std::vector<T>& attribute, std::vector<GLuint> const& remap)
+	{
+		if (attribute.empty())
+			return;
+		RemapVertices(reinterpret_cast<std::uint8_t*>(attribute.data()), sizeof(T), remap);
+	}
+}
@@ -0,0 +1,191 @@
+#include "ProgramCache.hpp"
+
+#include "config.hpp"
+#include "core/various.hpp"
+
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	// Bump whenever the layout of the cache changes.
+	constexpr std::uint32_t version = 1u;
+	constexpr std::array<char, 8> magic{ { 'B', 'N', 'B', 'P', 'R', 'O', 'G', '\0' } };
+	// Caches are written in the native byte order; this lets readers with
+	// a different one reject them.
+	constexpr std::uint32_t byte_order_mark = 0x01020304u;
+
+	struct Header {
+		std::array<char, 8> magic;
+		std::uint32_t version;
+		std::uint32_t byte_order_mark;
+		std::uint64_t key;
+		std::uint32_t binary_format;
+		std::uint32_t binary_size;
+	};
+
+	std::uint64_t hashString(char const* string, std::uint64_t const hash)
+	{
+		if (string == nullptr)
+			return hash;
+		// Include the terminator, so that consecutive strings can not be
+		// confused with one another.
+		return utils::hash_data(string, std::strlen(string) + 1u, hash);
+	}
+}
+
+bool
+ProgramCache::IsSupported()
+{
+	if (!GLAD_GL_VERSION_4_1)
+		return false;
+
+	GLint formats_nb = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_nb);
+	return formats_nb > 0;
+}
+
+std::string
+ProgramCache::GetPath(std::string const& program_name)
+{
+	// Program names are meant for humans, and can contain spaces or
+	// parentheses.
+	std::string filename;
+	filename.reserve(program_name.size() + 17u);
+	for (auto const c : program_name)
+		filename.push_back(std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::tolower(static_cast<unsigned char>(c))) : '_');
+
+	std::array<char, 18> hash;
+	std::snprintf(hash.data(), hash.size(), "_%016llx",
+	              static_cast<unsigned long long>(utils::hash_data(program_name.data(), program_name.size())));
+	filename += hash.data();
+
+	return config::cache_path(filename + ".programcache");
+}
+
+std::uint64_t
+ProgramCache::ComputeKey(std::vector<Source> const& sources)
+{
+	auto key = utils::hash_data(&version, sizeof(version));
+	for (auto const& source : sources) {
+		key = utils::hash_data(&source.first, sizeof(source.first), key);
+		key = hashString(source.second.c_str(), key);
+	}
+	key = hashString(reinterpret_cast<char const*>(glGetString(GL_VENDOR)), key);
+	key = hashString(reinterpret_cast<char const*>(glGetString(GL_RENDERER)), key);
+	key = hashString(reinterpret_cast<char const*>(glGetString(GL_VERSION)), key);
+
+	return key;
+}
+
+GLuint
+ProgramCache::Read(std::string const& path, std::uint64_t const expected_key, std::string& error)
+{
+	std::ifstream file(utils::widen(path), std::ios::binary);
+	if (!file.is_open()) {
+		error = "No cache found at \"" + path + "\"";
+		return 0u;
+	}
+
+	Header header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != magic) {
+		error = "Cache \"" + path + "\" is corrupt";
+		return 0u;
+	}
+	if (header.version != version || header.byte_order_mark != byte_order_mark) {
+		error = "Cache \"" + path + "\" was written by a different version";
+		return 0u;
+	}
+	if (header.key != expected_key) {
+		error = "Cache \"" + path + "\" is out of date";
+		return 0u;
+	}
+
+	auto const binary_offset = file.tellg();
+	file.seekg(0, std::ios::end);
+	auto const file_size = file.tellg();
+	file.seekg(binary_offset);
+	if (file_size - binary_offset != static_cast<std::streamoff>(header.binary_size)) {
+		error = "Cache \"" + path + "\" is corrupt";
+		return 0u;
+	}
+
+	std::vector<char> binary(header.binary_size);
+	if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size()))) {
+		error = "Cache \"" + path + "\" is corrupt";
+		return 0u;
+	}
+
+	GLuint const program = glCreateProgram();
+	glProgramBinary(program, static_cast<GLenum>(header.binary_format), binary.data(), static_cast<GLsizei>(binary.size()));
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	if (link_status == GL_FALSE) {
+		glDeleteProgram(program);
+		error = "Cache \"" + path + "\" was rejected by the driver";
+		return 0u;
+	}
+
+	return program;
+}
+
+bool
+ProgramCache::Write(std::string const& path, GLuint const program, std::uint64_t const key, std::string& error)
+{
+	GLint binary_size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+	if (binary_size <= 0) {
+		error = "No binary could be retrieved for \"" + path + "\"";
+		return false;
+	}
+
+	std::vector<char> binary(static_cast<size_t>(binary_size));
+	GLsizei written_size = 0;
+	GLenum binary_format = 0u;
+	glGetProgramBinary(program, binary_size, &written_size, &binary_format, binary.data());
+	if (written_size <= 0) {
+		error = "No binary could be retrieved for \"" + path + "\"";
+		return false;
+	}
+	binary.resize(static_cast<size_t>(written_size));
+
+	Header header;
+	header.magic = magic;
+	header.version = version;
+	header.byte_order_mark = byte_order_mark;
+	header.key = key;
+	header.binary_format = binary_format;
+	header.binary_size = static_cast<std::uint32_t>(binary.size());
+
+	// Write to a temporary file first, so that an interrupted write never
+	// leaves a truncated cache behind.
+	auto const temporary_path = path + ".tmp";
+	{
+		std::ofstream file(utils::widen(temporary_path), std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			error = "Failed to open \"" + temporary_path + "\" for writing";
+			return false;
+		}
+
+		file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+		if (!file) {
+			error = "Failed to write \"" + temporary_path + "\"";
+			file.close();
+			std::remove(temporary_path.c_str());
+			return false;
+		}
+	}
+
+	std::remove(path.c_str());
+	if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+		error = "Failed to move \"" + temporary_path + "\" to \"" + path + "\"";
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+
+	return true;
+}
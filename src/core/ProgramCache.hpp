@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! \brief Cache of linked shader programs, as returned by
+//!        `glGetProgramBinary()`, so that shaders only need to be compiled
+//!        and linked once per driver.
+//!
+//! Caches are stored in the cache directory of the build (see
+//! `config::cache_path()`), rather than among the shader sources, and
+//! named after their program. A cache records a key (see `ComputeKey()`) covering the
+//! sources of all stages as well as the driver, and is only used if that
+//! key matches and the driver accepts the binary: drivers are free to
+//! reject binaries at any time, e.g. after an update, in which case the
+//! program is simply compiled again.
+//!
+//! This needs OpenGL 4.1, and a driver exposing at least one binary format.
+namespace ProgramCache
+{
+	//! \brief The source of a shader stage, and its type.
+	using Source = std::pair<GLenum, std::string>;
+
+	//! \brief Whether the driver supports retrieving and loading program
+	//!        binaries.
+	bool IsSupported();
+
+	//! \brief Retrieve the path of the cache for a given program.
+	//!
+	//! The filename is a readable version of the program name followed by
+	//! a hash of the full name, so that names differing only by spaces or
+	//! punctuation do not share a cache.
+	//!
+	//! @param [in] program_name name the program was registered with
+	std::string GetPath(std::string const& program_name);
+
+	//! \brief Compute the key identifying the binary of a program.
+	//!
+	//! It covers the type and source of each stage, as well as the vendor,
+	//! renderer and version strings of the current OpenGL context, so that
+	//! binaries are not even submitted to a different driver.
+	std::uint64_t ComputeKey(std::vector<Source> const& sources);
+
+	//! \brief Create a program from a cache.
+	//!
+	//! @param [in] path path to the cache
+	//! @param [in] expected_key key of the current sources and driver
+	//! @param [out] error reason for the failure, if any
+	//! @return the linked program, or 0 if the cache does not exist, is of
+	//!         a different version or key, is corrupt, or was rejected by
+	//!         the driver
+	GLuint Read(std::string const& path, std::uint64_t expected_key, std::string& error);
+
+	//! \brief Write the binary of a linked program, replacing any existing
+	//!        cache.
+	//!
+	//! The program should have been linked with the
+	//! `GL_PROGRAM_BINARY_RETRIEVABLE_HINT` parameter set.
+	//!
+	//! @param [in] path path to the cache
+	//! @param [in] program the linked program
+	//! @param [in] key key of the sources and driver it was built with
+	//! @param [out] error reason for the failure, if any
+	//! @return whether the cache was successfully written
+	bool Write(std::string const& path, GLuint program, std::uint64_t key, std::string& error);
+}
@@ -2,21 +2,177 @@
 
 #include "config.hpp"
 
+#include "FileWatcher.hpp"
 #include "Log.h"
 #include "opengl.hpp"
+#include "ProgramCache.hpp"
+#include "SharedUniforms.hpp"
+#include "UniformCache.hpp"
 #include "various.hpp"
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <type_traits>
 
-ShaderProgramManager::~ShaderProgramManager()
+// From GL_KHR_parallel_shader_compile, and GL_ARB_parallel_shader_compile
+// which uses the same values; neither is part of the loaded extensions.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+namespace
 {
-	for (auto const& i : program_entries) {
-		if (i.first != 0u) {
-			glDeleteProgram(i.first);
-			i.first = 0u;
+	GLuint const invalid_program = 0u;
+
+	//! \brief Remove the "." and ".." components of a path, so that a file
+	//!        always gets the same path whichever file includes it.
+	std::string normalizePath(std::string const& path)
+	{
+		std::vector<std::string> components;
+		std::size_t component_start = 0u;
+		while (component_start <= path.size()) {
+			auto component_end = path.find_first_of("/\\", component_start);
+			if (component_end == std::string::npos)
+				component_end = path.size();
+			auto const component = path.substr(component_start, component_end - component_start);
+			component_start = component_end + 1u;
+
+			if (component == "." && !components.empty())
+				continue;
+			if (component == ".." && !components.empty() && !components.back().empty()
+			    && components.back() != "." && components.back() != "..") {
+				components.pop_back();
+				continue;
+			}
+			components.push_back(component);
+		}
+
+		std::string normalized_path;
+		for (std::size_t i = 0; i < components.size(); ++i) {
+			if (i > 0)
+				normalized_path += '/';
+			normalized_path += components[i];
+		}
+		return normalized_path;
+	}
+
+	//! \brief Expand the `#include "path"` directives of a shader source,
+	//!        recursively.
+	//!
+	//! @param [in] path path the source was read from
+	//! @param [in] source the source to expand
+	//! @param [in,out] files paths of the files read so far, starting with
+	//!                 the shader itself; files already in there are not
+	//!                 included again, and `#line` directives refer to
+	//!                 files by their index in there
+	//! @param [out] output the expanded source
+	//! @return false if an included file could not be read
+	bool resolveIncludes(std::string const& path, std::string const& source, std::vector<std::string>& files, std::string& output)
+	{
+		auto const file_index = std::find(files.begin(), files.end(), path) - files.begin();
+		auto const separator = path.find_last_of("/\\");
+		auto const directory = separator != std::string::npos ? path.substr(0u, separator + 1u) : std::string();
+
+		std::istringstream stream(source);
+		std::string line;
+		std::size_t line_nb = 0;
+		while (std::getline(stream, line)) {
+			++line_nb;
+			auto const directive_start = line.find_first_not_of(" \t");
+			if (directive_start == std::string::npos || line.compare(directive_start, 8u, "#include") != 0) {
+				output += line;
+				output += '\n';
+				continue;
+			}
+
+			auto const name_start = line.find('"', directive_start + 8u);
+			auto const name_end = name_start != std::string::npos ? line.find('"', name_start + 1u) : std::string::npos;
+			if (name_end == std::string::npos) {
+				LogError("Malformed include directive at line %zu of '%s'.", line_nb, path.c_str());
+				return false;
+			}
+			auto const name = line.substr(name_start + 1u, name_end - name_start - 1u);
+
+			auto include_path = normalizePath(directory + name);
+			if (!std::ifstream(utils::widen(include_path)))
+				include_path = normalizePath(config::shaders_path(name));
+			if (std::find(files.begin(), files.end(), include_path) != files.end()) {
+				output += '\n';
+				continue;
+			}
+
+			auto const include_source = utils::slurp_file(include_path);
+			if (include_source.empty()) {
+				LogError("Retrieval of '%s', included at line %zu of '%s', failed; see previous message for details.", include_path.c_str(), line_nb, path.c_str());
+				return false;
+			}
+			files.push_back(include_path);
+			output += "#line 1 " + std::to_string(files.size() - 1u) + "\n";
+			if (!resolveIncludes(include_path, include_source, files, output))
+				return false;
+			output += "#line " + std::to_string(line_nb + 1u) + " " + std::to_string(file_index) + "\n";
+		}
+
+		return true;
+	}
+
+	//! \brief Define macros right after the `#version` directive of a
+	//!        shader source, which has to come first.
+	std::string addDefines(std::string source, ShaderProgramManager::Defines const& defines)
+	{
+		if (defines.empty())
+			return source;
+
+		auto const version_start = source.find("#version");
+		auto insertion_point = std::size_t(0u);
+		auto next_line_nb = std::size_t(1u);
+		if (version_start != std::string::npos) {
+			auto const version_end = source.find('\n', version_start);
+			if (version_end == std::string::npos)
+				source += '\n';
+			insertion_point = version_end != std::string::npos ? version_end + 1u : source.size();
+			next_line_nb = static_cast<std::size_t>(std::count(source.begin(), source.begin() + version_start, '\n')) + 2u;
 		}
+
+		std::string definitions;
+		for (auto const& define : defines)
+			definitions += "#define " + define.first + " " + define.second + "\n";
+		definitions += "#line " + std::to_string(next_line_nb) + " 0\n";
+
+		source.insert(insertion_point, definitions);
+		return source;
+	}
+}
+
+ShaderProgramManager::ShaderProgramManager(CompilationMode const mode) : compilation_mode(mode)
+{
+	char const* max_shader_compiler_threads_name = nullptr;
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile"))
+		max_shader_compiler_threads_name = "glMaxShaderCompilerThreadsKHR";
+	else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+		max_shader_compiler_threads_name = "glMaxShaderCompilerThreadsARB";
+	if (max_shader_compiler_threads_name == nullptr)
+		return;
+
+	auto const max_shader_compiler_threads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(glfwGetProcAddress(max_shader_compiler_threads_name));
+	if (max_shader_compiler_threads == nullptr)
+		return;
+
+	// Let the driver pick how many threads to use.
+	max_shader_compiler_threads(0xFFFFFFFFu);
+	is_parallel_compilation_supported = true;
+}
+
+ShaderProgramManager::~ShaderProgramManager()
+{
+	for (std::size_t i = 0; i < program_entries.size(); ++i) {
+		DiscardPendingProgram(program_entries[i]);
+		InstallProgram(i, 0u);
 	}
 }
 
@@ -31,10 +187,7 @@ void ShaderProgramManager::CreateAndRegisterProgram(char const* const program_na
 		}
 	}
 
-	program_entries.emplace_back(program, program_data);
-	program_names.emplace_back(program_name);
-
-	ProcessProgram(program_entries.size() - 1);
+	RegisterProgram(program_name, program_data, {}, program);
 }
 
 void ShaderProgramManager::CreateAndRegisterComputeProgram(char const* const program_name, std::string const& filename, GLuint& program)
@@ -44,23 +197,14 @@ void ShaderProgramManager::CreateAndRegisterComputeProgram(char const* const pro
 		return;
 	}
 
-	program_entries.emplace_back(program, ProgramData{ { ShaderType::compute, filename } });
-	program_names.emplace_back(program_name);
-
-	ProcessProgram(program_entries.size() - 1);
+	RegisterProgram(program_name, ProgramData{ { ShaderType::compute, filename } }, {}, program);
 }
 
 bool ShaderProgramManager::ReloadAllPrograms()
 {
 	bool encountered_failures = false;
-	for (std::size_t i = 0; i < program_entries.size(); ++i) {
-		auto& program = program_entries[i].first;
-		if (program != 0u)
-			glDeleteProgram(program);
-		program = 0u;
-		ProcessProgram(i);
-		encountered_failures |= program == 0u;
-	}
+	for (std::size_t i = 0; i < program_entries.size(); ++i)
+		encountered_failures |= !ReloadProgram(i);
 
 	return !encountered_failures;
 }
@@ -68,47 +212,346 @@ bool ShaderProgramManager::ReloadAllPrograms()
 ShaderProgramManager::SelectedProgram ShaderProgramManager::SelectProgram(std::string const& label, std::int32_t& program_index)
 {
 	SelectedProgram selection_result;
-	if (program_index >= program_entries.size()) {
-		LogError("Invalid program index '%d': only %d programs are registered.", program_index, program_entries.size());
+	if (program_index >= selectable_indices.size()) {
+		LogError("Invalid program index '%d': only %d programs are registered.", program_index, selectable_indices.size());
 		return selection_result;
 	}
 
-	selection_result.was_selection_changed = ImGui::Combo(label.c_str(), &program_index, program_names.data(), static_cast<int>(program_names.size()));
-	selection_result.program = &program_entries.at(program_index).first;
-	selection_result.name = program_names.at(program_index);
+	selection_result.was_selection_changed = ImGui::Combo(label.c_str(), &program_index, selectable_names.data(), static_cast<int>(selectable_names.size()));
+	selection_result.program = &program_entries.at(selectable_indices.at(program_index)).program;
+	selection_result.name = selectable_names.at(program_index);
 	return selection_result;
 }
 
+GLuint const& ShaderProgramManager::GetProgramPermutation(char const* const program_name, Defines const& defines)
+{
+	auto const key = std::make_pair(std::string(program_name), defines);
+	auto const permutation_it = permutation_indices.find(key);
+	if (permutation_it != permutation_indices.end())
+		return program_entries[permutation_it->second].program;
+
+	auto const base_it = std::find_if(selectable_indices.begin(), selectable_indices.end(),
+	                                  [this, program_name](std::size_t const i){ return std::strcmp(program_names[i], program_name) == 0; });
+	if (base_it == selectable_indices.end()) {
+		LogError("No program named '%s' was registered.", program_name);
+		return invalid_program;
+	}
+	if (defines.empty())
+		return program_entries[*base_it].program;
+
+	std::string name = std::string(program_name) + "{";
+	for (auto const& define : defines)
+		name += (name.back() != '{' ? "," : "") + define.first + "=" + define.second;
+	name += "}";
+	permutation_names.push_back(name);
+	permutation_programs.push_back(0u);
+
+	// Copied, as registering may reallocate the entries.
+	auto const program_data = program_entries[*base_it].data;
+	RegisterProgram(permutation_names.back().c_str(), program_data, defines, permutation_programs.back());
+	permutation_indices.emplace(key, program_entries.size() - 1);
+	return permutation_programs.back();
+}
+
+void ShaderProgramManager::SetCompilationMode(CompilationMode const mode)
+{
+	compilation_mode = mode;
+}
+
+void ShaderProgramManager::EnableHotReload()
+{
+	if (file_watcher != nullptr)
+		return;
+
+	file_watcher = std::make_unique<FileWatcher>();
+	for (auto const& entry : program_entries)
+		for (auto const& dependency : entry.dependencies)
+			file_watcher->Watch(dependency);
+}
+
+bool ShaderProgramManager::Update()
+{
+	bool encountered_failures = false;
+	if (file_watcher != nullptr) {
+		auto const changed_files = file_watcher->PollChangedFiles();
+		for (std::size_t i = 0; i < program_entries.size() && !changed_files.empty(); ++i) {
+			auto const& dependencies = program_entries[i].dependencies;
+			for (auto const& changed_file : changed_files) {
+				if (std::find(dependencies.begin(), dependencies.end(), changed_file) != dependencies.end()) {
+					LogInfo("Rebuilding program '%s', as '%s' was modified.", program_names[i], changed_file.c_str());
+					encountered_failures |= !ReloadProgram(i);
+					break;
+				}
+			}
+		}
+	}
+
+	bool was_queued_program_built = false;
+	for (std::size_t i = 0; i < program_entries.size(); ++i) {
+		auto const& entry = program_entries[i];
+		if (entry.state == ProgramState::building && IsProgramBuilt(entry)) {
+			encountered_failures |= !FinishProgram(i);
+		} else if (entry.state == ProgramState::queued && !was_queued_program_built) {
+			// Without parallel compilation, checking the status of a
+			// program waits for it to be built: only build one per call.
+			was_queued_program_built = true;
+			encountered_failures |= !SubmitProgram(i) || !FinishProgram(i);
+		}
+	}
+
+	return !encountered_failures;
+}
+
+bool ShaderProgramManager::IsProgramReady(GLuint const& program) const
+{
+	for (std::size_t i = 0; i < program_entries.size(); ++i) {
+		auto const& entry = program_entries[i];
+		if (&entry.program == &program)
+			return entry.state == ProgramState::idle && entry.program != 0u && !IsProgramBorrowed(i);
+	}
+
+	return false;
+}
+
+std::size_t ShaderProgramManager::GetPendingProgramsNb() const
+{
+	std::size_t pending_programs_nb = 0;
+	for (auto const& entry : program_entries)
+		pending_programs_nb += entry.state != ProgramState::idle ? 1 : 0;
+
+	return pending_programs_nb;
+}
+
+std::size_t ShaderProgramManager::GetBuildsNb() const
+{
+	return builds_nb;
+}
+
+void ShaderProgramManager::RegisterProgram(char const* const program_name, ProgramData const& program_data, Defines const& defines, GLuint& program)
+{
+	program_entries.emplace_back(program, program_data);
+	program_entries.back().defines = defines;
+	program_names.emplace_back(program_name);
+	auto const program_index = program_entries.size() - 1;
+	if (defines.empty()) {
+		selectable_indices.push_back(program_index);
+		selectable_names.push_back(program_name);
+	}
+
+	bool const is_fallback = fallback_index == ~std::size_t(0u) && std::string(program_name) == "Fallback";
+	if (is_fallback)
+		fallback_index = program_index;
+
+	if (compilation_mode == CompilationMode::synchronous || is_fallback) {
+		ProcessProgram(program_index);
+		return;
+	}
+
+	bool const is_compute = program_data.find(ShaderType::compute) != program_data.end();
+	program = is_compute ? 0u : GetFallbackProgram();
+	program_entries[program_index].state = ProgramState::queued;
+	if (is_parallel_compilation_supported)
+		SubmitProgram(program_index);
+}
+
 void ShaderProgramManager::ProcessProgram(std::size_t const program_index)
 {
-	auto& program_entry = program_entries[program_index];
-	auto& program = program_entry.first;
-	auto const& program_data = program_entry.second;
+	if (SubmitProgram(program_index))
+		FinishProgram(program_index);
+}
+
+bool ShaderProgramManager::ReloadProgram(std::size_t const program_index)
+{
+	auto& entry = program_entries[program_index];
+	DiscardPendingProgram(entry);
+
+	// The current version stays in use until the new one is built.
+	if (compilation_mode == CompilationMode::synchronous)
+		return SubmitProgram(program_index) && FinishProgram(program_index);
 
-	std::vector<GLuint> shaders;
-	shaders.reserve(program_data.size());
+	entry.state = ProgramState::queued;
+	return !is_parallel_compilation_supported || SubmitProgram(program_index);
+}
+
+bool ShaderProgramManager::SubmitProgram(std::size_t const program_index)
+{
+	auto& entry = program_entries[program_index];
+	auto const& program_data = entry.data;
+	entry.state = ProgramState::idle;
 
+	std::vector<ProgramCache::Source> sources;
+	sources.reserve(program_data.size());
+	entry.dependencies.clear();
 	for (auto const& i : program_data) {
 		std::string const full_filename = config::shaders_path(i.second);
+		entry.dependencies.push_back(full_filename);
+		if (file_watcher != nullptr)
+			file_watcher->Watch(full_filename);
+
 		auto const shader_source = utils::slurp_file(full_filename);
 		if (shader_source.empty()) {
 			LogError("Retrieval of shader '%s' failed; see previous message for details.", full_filename.c_str());
-			return;
+			return false;
 		}
 
-		GLuint shader = utils::opengl::shader::generate_shader(static_cast<std::underlying_type<ShaderType>::type>(i.first), shader_source);
-		if (shader == 0u) {
-			for (auto& shader : shaders)
-				glDeleteShader(shader);
-			LogError("Compilation of shader '%s' failed; see previous message for details.", full_filename.c_str());
-			return;
+		std::vector<std::string> files{ full_filename };
+		std::string expanded_source;
+		bool const were_includes_resolved = resolveIncludes(full_filename, shader_source, files, expanded_source);
+		// Included files are watched as well, even if some could not be
+		// read, so that fixing them triggers a rebuild.
+		for (auto const& file : files) {
+			if (std::find(entry.dependencies.begin(), entry.dependencies.end(), file) != entry.dependencies.end())
+				continue;
+			entry.dependencies.push_back(file);
+			if (file_watcher != nullptr)
+				file_watcher->Watch(file);
+		}
+		if (!were_includes_resolved) {
+			LogError("Retrieval of shader '%s' failed; see previous message for details.", full_filename.c_str());
+			return false;
 		}
-		shaders.push_back(shader);
+
+		sources.emplace_back(static_cast<std::underlying_type<ShaderType>::type>(i.first), addDefines(std::move(expanded_source), entry.defines));
 	}
 
-	program = utils::opengl::shader::generate_program(shaders);
-	utils::opengl::debug::nameObject(GL_PROGRAM, program, program_names[program_index]);
+	// Skip compiling and linking altogether if the driver still has the
+	// binary of the exact same sources.
+	entry.cache_path.clear();
+	if (ProgramCache::IsSupported()) {
+		entry.cache_path = ProgramCache::GetPath(program_names[program_index]);
+		entry.cache_key = ProgramCache::ComputeKey(sources);
+
+		std::string error;
+		entry.pending_program = ProgramCache::Read(entry.cache_path, entry.cache_key, error);
+		if (entry.pending_program != 0u) {
+			entry.is_pending_from_cache = true;
+			entry.state = ProgramState::building;
+			return true;
+		}
+		LogTrivia("%s; compiling program '%s'.", error.c_str(), program_names[program_index]);
+	}
+
+	// Statuses are only checked by `FinishProgram()`, so that drivers
+	// supporting parallel compilation can build the program in the
+	// background meanwhile.
+	entry.is_pending_from_cache = false;
+	entry.pending_shaders.reserve(sources.size());
+	for (auto const& source : sources) {
+		GLuint const shader = glCreateShader(source.first);
+		GLchar const* char_source = source.second.c_str();
+		glShaderSource(shader, 1, &char_source, nullptr);
+		glCompileShader(shader);
+		entry.pending_shaders.push_back(shader);
+	}
 
-	for (auto& shader : shaders)
+	entry.pending_program = glCreateProgram();
+	for (auto const shader : entry.pending_shaders)
+		glAttachShader(entry.pending_program, shader);
+	// The hint has to be given before linking for the driver to keep the
+	// binary around for `glGetProgramBinary()`.
+	if (!entry.cache_path.empty())
+		glProgramParameteri(entry.pending_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(entry.pending_program);
+
+	entry.state = ProgramState::building;
+	return true;
+}
+
+bool ShaderProgramManager::FinishProgram(std::size_t const program_index)
+{
+	auto& entry = program_entries[program_index];
+
+	bool was_built = true;
+	if (!entry.is_pending_from_cache) {
+		auto data_it = entry.data.begin();
+		for (auto const shader : entry.pending_shaders) {
+			if (!utils::opengl::shader::check_shader_compilation(shader)) {
+				LogError("Compilation of shader '%s' failed; see previous message for details.", config::shaders_path(data_it->second).c_str());
+				was_built = false;
+			}
+			++data_it;
+		}
+		was_built = was_built && utils::opengl::shader::check_program_linking(entry.pending_program);
+	}
+	if (!was_built) {
+		DiscardPendingProgram(entry);
+		return false;
+	}
+
+	for (auto const shader : entry.pending_shaders)
 		glDeleteShader(shader);
+	entry.pending_shaders.clear();
+
+	auto const program = entry.pending_program;
+	entry.pending_program = 0u;
+	entry.state = ProgramState::idle;
+	InstallProgram(program_index, program);
+
+	if (!entry.is_pending_from_cache && !entry.cache_path.empty()) {
+		std::string error;
+		if (!ProgramCache::Write(entry.cache_path, program, entry.cache_key, error))
+			LogWarning("%s; program '%s' will be compiled again next time.", error.c_str(), program_names[program_index]);
+	}
+
+	return true;
+}
+
+bool ShaderProgramManager::IsProgramBuilt(ProgramEntry const& entry) const
+{
+	if (entry.is_pending_from_cache || !is_parallel_compilation_supported)
+		return true;
+
+	GLint is_completed = GL_FALSE;
+	glGetProgramiv(entry.pending_program, GL_COMPLETION_STATUS_KHR, &is_completed);
+	return is_completed != GL_FALSE;
+}
+
+void ShaderProgramManager::DiscardPendingProgram(ProgramEntry& entry)
+{
+	for (auto const shader : entry.pending_shaders)
+		glDeleteShader(shader);
+	entry.pending_shaders.clear();
+	if (entry.pending_program != 0u)
+		glDeleteProgram(entry.pending_program);
+	entry.pending_program = 0u;
+	entry.state = ProgramState::idle;
+}
+
+void ShaderProgramManager::InstallProgram(std::size_t const program_index, GLuint const program)
+{
+	auto& entry = program_entries[program_index];
+	auto const previous_program = entry.program;
+	if (previous_program != 0u && !IsProgramBorrowed(program_index)) {
+		UniformCache::Unregister(previous_program);
+		glDeleteProgram(previous_program);
+	}
+
+	// Programs still waiting for their first version follow the fallback
+	// program.
+	if (program_index == fallback_index && previous_program != 0u) {
+		for (auto& other_entry : program_entries) {
+			if (&other_entry != &entry && other_entry.program == previous_program)
+				other_entry.program = program;
+		}
+	}
+
+	entry.program = program;
+	if (program != 0u) {
+		utils::opengl::debug::nameObject(GL_PROGRAM, program, program_names[program_index]);
+		UniformCache::Register(program);
+		SharedUniforms::BindBlocks(program);
+		++builds_nb;
+	}
+}
+
+bool ShaderProgramManager::IsProgramBorrowed(std::size_t const program_index) const
+{
+	return program_index != fallback_index
+	    && program_entries[program_index].program != 0u
+	    && program_entries[program_index].program == GetFallbackProgram();
+}
+
+GLuint ShaderProgramManager::GetFallbackProgram() const
+{
+	return fallback_index < program_entries.size() ? program_entries[fallback_index].program : 0u;
 }
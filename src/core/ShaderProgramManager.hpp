@@ -3,7 +3,9 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <deque>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -19,24 +21,164 @@ enum class ShaderType : std::uint32_t {
 	compute = GL_COMPUTE_SHADER
 };
 
+class FileWatcher;
+
+//! \brief Compile, link and reload the shader programs of an application.
+//!
+//! In the synchronous mode, programs are ready as soon as they are
+//! created or reloaded, at the cost of stalling the application while the
+//! driver compiles them.
+//!
+//! In the asynchronous mode, `CreateAndRegisterProgram()` and
+//! `ReloadAllPrograms()` return immediately, and programs are installed by
+//! `Update()` once the driver is done with them. Until then, a new
+//! graphics program holds the program registered as "Fallback", and a new
+//! compute program holds 0. If the driver exposes
+//! `GL_KHR_parallel_shader_compile`, all programs are compiled in the
+//! background at once; otherwise `Update()` builds one program per call,
+//! so that the stall is spread over several frames.
+//!
+//! In both modes, a reloaded program keeps its current version until the
+//! new one is built, and keeps it if the new one fails to build.
+//!
+//! With hot reload enabled, only the programs using shader files modified
+//! on disk are rebuilt, by `Update()`.
+//!
+//! Shader files can include others with `#include "path"`, the path being
+//! relative to the including file, or else to the shaders directory; each
+//! file is only included once per shader. The source string numbers in
+//! compilation logs are the indices of the files in the order they were
+//! included, the shader file itself being 0.
+//!
+//! Variants of a program, which only differ by the preprocessor macros
+//! defined in all of its shaders, are requested with
+//! `GetProgramPermutation()`, and built the first time they are.
+//!
+//! The "FrameData" and "ViewData" blocks of every installed program are
+//! bound to the binding points of `SharedUniforms`.
+//!
+//! The "Fallback" program is always built synchronously, as other
+//! programs rely on it.
 class ShaderProgramManager
 {
 public:
 	using ProgramData = std::map<ShaderType, std::string>;
+	//! \brief Preprocessor macros, by name, and their values.
+	using Defines = std::map<std::string, std::string>;
 	struct SelectedProgram {
 		bool was_selection_changed = false;
 		GLuint const* program = nullptr;
 		char const* name = nullptr;
 	};
+	enum class CompilationMode : std::uint32_t {
+		synchronous,
+		asynchronous
+	};
+	explicit ShaderProgramManager(CompilationMode mode = CompilationMode::synchronous);
 	~ShaderProgramManager();
 	void CreateAndRegisterProgram(char const* const program_name, ProgramData const& program_data, GLuint& program);
 	void CreateAndRegisterComputeProgram(char const* const program_name, std::string const& filename, GLuint& program);
 	bool ReloadAllPrograms();
 	SelectedProgram SelectProgram(std::string const& label, std::int32_t& program_index);
 
+	//! \brief Return a variant of a registered program, built with the
+	//!        given macros defined, right after the `#version` directive,
+	//!        in all of its shaders.
+	//!
+	//! Each variant is built the first time it is requested, following the
+	//! compilation mode, and then reused; it is reloaded along with the
+	//! other programs. Variants do not show up in `SelectProgram()`.
+	//!
+	//! @param [in] program_name the name the program was registered with
+	//! @param [in] defines the macros to define; if empty, the program
+	//!             itself is returned
+	//! @return the variant, which keeps being updated as it gets built or
+	//!         reloaded, or 0 if there is no program named |program_name|
+	GLuint const& GetProgramPermutation(char const* const program_name, Defines const& defines);
+
+	//! \brief Change how programs created or reloaded from now on are
+	//!        built; programs already being built are not affected.
+	void SetCompilationMode(CompilationMode mode);
+
+	//! \brief Watch the shader files of all programs, current and future,
+	//!        and rebuild the programs using them whenever they are
+	//!        modified.
+	//!
+	//! `Update()` then needs to be called every frame, whatever the mode.
+	void EnableHotReload();
+
+	//! \brief Install the programs the driver is done building, and
+	//!        start rebuilding those whose files were modified if hot
+	//!        reload is enabled; to be called once per frame in the
+	//!        asynchronous mode.
+	//!
+	//! @return false if any program failed to build, in which case it
+	//!         keeps its previous version
+	bool Update();
+
+	//! \brief Whether |program|, as given to `CreateAndRegisterProgram()`
+	//!        or `CreateAndRegisterComputeProgram()`, holds its own linked
+	//!        program, and no newer version of it is being built.
+	bool IsProgramReady(GLuint const& program) const;
+
+	//! \brief Number of programs still being built.
+	std::size_t GetPendingProgramsNb() const;
+
+	//! \brief Number of programs installed so far, which changes whenever
+	//!        a program gets a new version.
+	std::size_t GetBuildsNb() const;
+
 private:
+	enum class ProgramState : std::uint32_t {
+		idle,     //!< nothing to build
+		queued,   //!< waiting for `Update()` to be built
+		building  //!< submitted to the driver
+	};
+	struct ProgramEntry {
+		ProgramEntry(GLuint& program, ProgramData const& data) : program(program), data(data)
+		{
+		}
+
+		GLuint& program;
+		ProgramData data;
+		Defines defines;
+		ProgramState state{ ProgramState::idle };
+		//! \brief Paths of the files the sources were read from.
+		std::vector<std::string> dependencies;
+
+		// Version being built
+		GLuint pending_program{ 0u };
+		std::vector<GLuint> pending_shaders;
+		bool is_pending_from_cache{ false };
+		std::string cache_path;
+		std::uint64_t cache_key{ 0u };
+	};
+
+	void RegisterProgram(char const* const program_name, ProgramData const& program_data, Defines const& defines, GLuint& program);
 	void ProcessProgram(std::size_t program_index);
-	using ProgramEntry = std::pair<GLuint&, ProgramData>;
+	bool ReloadProgram(std::size_t program_index);
+	bool SubmitProgram(std::size_t program_index);
+	bool FinishProgram(std::size_t program_index);
+	bool IsProgramBuilt(ProgramEntry const& entry) const;
+	void DiscardPendingProgram(ProgramEntry& entry);
+	void InstallProgram(std::size_t program_index, GLuint program);
+	bool IsProgramBorrowed(std::size_t program_index) const;
+	GLuint GetFallbackProgram() const;
+
+	CompilationMode compilation_mode;
+	bool is_parallel_compilation_supported{ false };
+	std::unique_ptr<FileWatcher> file_watcher;
+	std::size_t builds_nb{ 0 };
+	std::size_t fallback_index{ ~std::size_t(0u) };
 	std::vector<ProgramEntry> program_entries;
 	std::vector<char const*> program_names;
+
+	// Programs listed by `SelectProgram()`, i.e. all but the variants
+	std::vector<std::size_t> selectable_indices;
+	std::vector<char const*> selectable_names;
+
+	// Variants own their program and name; deques keep them in place.
+	std::deque<GLuint> permutation_programs;
+	std::deque<std::string> permutation_names;
+	std::map<std::pair<std::string, Defines>, std::size_t> permutation_indices;
 };
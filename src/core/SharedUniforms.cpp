@@ -0,0 +1,72 @@
+#include "SharedUniforms.hpp"
+
+#include "core/opengl.hpp"
+
+#include <cstddef>
+
+// Offsets as laid out by std140 in shaders/common/shared_uniforms.glsl
+static_assert(offsetof(SharedUniforms::FrameData, elapsed_time_s) == 12u, "FrameData does not match its std140 layout");
+static_assert(sizeof(SharedUniforms::FrameData) == 16u, "FrameData does not match its std140 layout");
+static_assert(offsetof(SharedUniforms::ViewData, camera_position) == 64u, "ViewData does not match its std140 layout");
+static_assert(sizeof(SharedUniforms::ViewData) == 80u, "ViewData does not match its std140 layout");
+
+constexpr GLuint SharedUniforms::frame_binding;
+constexpr GLuint SharedUniforms::view_binding;
+
+namespace
+{
+	GLuint createBuffer(GLsizeiptr const size, char const* const label)
+	{
+		GLuint buffer = 0u;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+		utils::opengl::debug::nameObject(GL_BUFFER, buffer, label);
+
+		return buffer;
+	}
+
+	void bindBlock(GLuint const program, char const* const name, GLuint const binding)
+	{
+		auto const index = glGetUniformBlockIndex(program, name);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, index, binding);
+	}
+}
+
+SharedUniforms::SharedUniforms() :
+	_frame_buffer(createBuffer(sizeof(FrameData), "FrameData")),
+	_view_buffer(createBuffer(sizeof(ViewData), "ViewData"))
+{
+}
+
+SharedUniforms::~SharedUniforms()
+{
+	glDeleteBuffers(1, &_view_buffer);
+	glDeleteBuffers(1, &_frame_buffer);
+}
+
+void
+SharedUniforms::SetFrameData(FrameData const& data)
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, frame_binding, _frame_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+}
+
+void
+SharedUniforms::SetViewData(ViewData const& data)
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, view_binding, _view_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+}
+
+void
+SharedUniforms::BindBlocks(GLuint const program)
+{
+	if (program == 0u)
+		return;
+
+	bindBlock(program, "FrameData", frame_binding);
+	bindBlock(program, "ViewData", view_binding);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+//! \brief Uniform buffers holding the uniforms which are identical for
+//!        all draws of a frame, or of a view, so that they are uploaded
+//!        once rather than for every draw.
+//!
+//! Shaders declare the corresponding blocks by including
+//! "common/shared_uniforms.glsl", whose members have the same names as
+//! the individual uniforms they replace. As `#version 410` does not allow
+//! binding blocks from GLSL, `BindBlocks()` binds them to the fixed
+//! binding points below; the `ShaderProgramManager` does so for every
+//! program it installs.
+//!
+//! The structures below follow the std140 layout of the blocks: any change
+//! to either has to be mirrored in the other.
+class SharedUniforms
+{
+public:
+	struct FrameData {
+		glm::vec3 light_position{ 0.0f };
+		float elapsed_time_s{ 0.0f };
+	};
+	struct ViewData {
+		glm::mat4 vertex_world_to_clip{ 1.0f };
+		glm::vec3 camera_position{ 0.0f };
+		float padding{ 0.0f };
+	};
+
+	static constexpr GLuint frame_binding = 0u;
+	static constexpr GLuint view_binding = 1u;
+
+	SharedUniforms();
+	~SharedUniforms();
+
+	SharedUniforms(SharedUniforms const&) = delete;
+	SharedUniforms& operator=(SharedUniforms const&) = delete;
+
+	//! \brief Upload the per-frame uniforms, and bind them to
+	//!        `frame_binding`; to be called once per frame, before drawing.
+	void SetFrameData(FrameData const& data);
+
+	//! \brief Upload the per-view uniforms, and bind them to
+	//!        `view_binding`; to be called before drawing each view, e.g.
+	//!        the camera or a shadow map.
+	void SetViewData(ViewData const& data);
+
+	//! \brief Bind the "FrameData" and "ViewData" blocks of a program, if
+	//!        it uses them, to their binding points.
+	//!
+	//! This has to be done again whenever the program is linked or loaded
+	//! from a binary.
+	//!
+	//! @param [in] program OpenGL name of the linked shader program
+	static void BindBlocks(GLuint program);
+
+private:
+	GLuint _frame_buffer{ 0u };
+	GLuint _view_buffer{ 0u };
+};
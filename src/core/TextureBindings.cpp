@@ -0,0 +1,86 @@
+#include "TextureBindings.hpp"
+
+#include "core/Log.h"
+
+void
+TextureBindings::add(std::string const& name, GLuint tex_id, GLenum type)
+{
+	GLint max_combined_texture_image_units{-1};
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_combined_texture_image_units);
+	std::size_t const max_active_texture_count
+		= (max_combined_texture_image_units > 0) ? static_cast<std::size_t>(max_combined_texture_image_units)
+		                                         : 80; // OpenGL 4.x guarantees at least 80.
+
+	if (_textures.size() >= max_active_texture_count) {
+		LogWarning("Trying to add more textures to an object than supported (%llu); the texture %s with ID %u will **not** be added. If you really need that many textures, roll your own solution instead.",
+		           max_active_texture_count, name.c_str(), tex_id);
+		return;
+	}
+	if (tex_id == 0u) {
+		LogWarning("0 is not a valid texture ID; the texture %s (with ID %u) will **not** be added.",
+		           name.c_str(), tex_id);
+		return;
+	}
+
+	_textures.push_back({ tex_id, type, UniformLocation(name), UniformLocation("has_" + name) });
+}
+
+bool
+TextureBindings::has(std::string const& name) const
+{
+	for (auto const& texture : _textures)
+		if (texture.sampler_location.GetName() == name)
+			return true;
+	return false;
+}
+
+void
+TextureBindings::clear()
+{
+	_textures.clear();
+}
+
+std::vector<TextureBindings::Texture> const&
+TextureBindings::get() const noexcept
+{
+	return _textures;
+}
+
+void
+TextureBindings::bind(GLuint program) const
+{
+	for (size_t i = 0u; i < _textures.size(); ++i) {
+		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+		glBindTexture(_textures[i].type, _textures[i].id);
+	}
+	set_uniforms(program, true);
+}
+
+void
+TextureBindings::unbind(GLuint program) const
+{
+	for (size_t i = 0u; i < _textures.size(); ++i) {
+		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+		glBindTexture(_textures[i].type, 0u);
+	}
+	if (!_textures.empty())
+		glActiveTexture(GL_TEXTURE0);
+	set_uniforms(program, false);
+}
+
+void
+TextureBindings::set_uniforms(GLuint program, bool are_bound) const
+{
+	for (size_t i = 0u; i < _textures.size(); ++i) {
+		auto const& texture = _textures[i];
+
+		// Shaders are free to not declare the uniforms of textures they do
+		// not sample from.
+		auto const sampler_location = texture.sampler_location(program);
+		if (sampler_location >= 0)
+			glUniform1i(sampler_location, are_bound ? static_cast<GLint>(i) : 0);
+		auto const presence_location = texture.presence_location(program);
+		if (presence_location >= 0)
+			glUniform1i(presence_location, are_bound ? 1 : 0);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "UniformCache.hpp"
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+//! \brief Textures attached to a drawable, each one paired with the
+//!        uniforms through which shaders access it.
+//!
+//! A texture added under the name `foo` is bound to the sampler uniform
+//! `foo`, and the integer uniform `has_foo` is set to 1 while it is bound
+//! and back to 0 afterwards. Textures use consecutive texture units, in
+//! the order they were added, starting from unit 0.
+//!
+//! This is shared by `Node`, `InstancedNode` and `Terrain`, and used by the
+//! `RenderQueue` when drawing nodes.
+class TextureBindings
+{
+public:
+	struct Texture {
+		GLuint id;
+		GLenum type;
+		UniformLocation sampler_location;
+		UniformLocation presence_location; //!< location of the `has_<name>` uniform
+	};
+
+	//! \brief Add a texture, unless it is invalid or all texture units
+	//!        are already in use.
+	//!
+	//! @param [in] name of the sampler uniform the texture is bound to
+	//! @param [in] tex_id OpenGL name of the texture
+	//! @param [in] type OpenGL target of the texture, e.g. GL_TEXTURE_2D
+	void add(std::string const& name, GLuint tex_id, GLenum type);
+
+	//! \brief Check whether a texture was added under a given name.
+	bool has(std::string const& name) const;
+
+	void clear();
+
+	std::vector<Texture> const& get() const noexcept;
+
+	//! \brief Bind all textures to their units and set their uniforms in
+	//!        the given program, which has to be in use.
+	void bind(GLuint program) const;
+
+	//! \brief Unbind all textures from their units and reset their
+	//!        uniforms in the given program, which has to be in use.
+	void unbind(GLuint program) const;
+
+	//! \brief Only set the uniforms of all textures, leaving the binding of
+	//!        the textures themselves to the caller.
+	//!
+	//! @param [in] program OpenGL name of the shader program in use
+	//! @param [in] are_bound whether the textures are bound to their units,
+	//!             or should be reported as absent to the shaders
+	void set_uniforms(GLuint program, bool are_bound) const;
+
+private:
+	std::vector<Texture> _textures;
+};
@@ -0,0 +1,398 @@
+#include "TextureCache.hpp"
+
+#include "core/various.hpp"
+
+#include <stb_dxt.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	// Bump whenever the way textures are filtered or compressed changes.
+	constexpr std::uint32_t version = 1u;
+	constexpr std::array<std::uint8_t, 12> ktx_identifier{ { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A } };
+	constexpr std::uint32_t ktx_endianness = 0x04030201u;
+	constexpr char const* cache_key = "bonobo.cache";
+
+	// Those come from EXT_texture_compression_s3tc, which GLAD was not
+	// generated with.
+	constexpr GLenum compressed_rgb_s3tc_dxt1 = 0x83F0;
+	constexpr GLenum compressed_rgba_s3tc_dxt5 = 0x83F3;
+
+	bool isFormatOfUsage(GLenum const internal_format, TextureCache::Usage const usage)
+	{
+		if (usage == TextureCache::Usage::normal_map)
+			return internal_format == GL_COMPRESSED_RG_RGTC2;
+		return internal_format == compressed_rgb_s3tc_dxt1 || internal_format == compressed_rgba_s3tc_dxt5;
+	}
+
+	struct ktx_header {
+		std::array<std::uint8_t, 12> identifier;
+		std::uint32_t endianness;
+		std::uint32_t gl_type;
+		std::uint32_t gl_type_size;
+		std::uint32_t gl_format;
+		std::uint32_t gl_internal_format;
+		std::uint32_t gl_base_internal_format;
+		std::uint32_t pixel_width;
+		std::uint32_t pixel_height;
+		std::uint32_t pixel_depth;
+		std::uint32_t array_elements_nb;
+		std::uint32_t faces_nb;
+		std::uint32_t mipmap_levels_nb;
+		std::uint32_t key_value_data_size;
+	};
+	static_assert(sizeof(ktx_header) == 64u, "KTX headers are 64 bytes long.");
+
+	struct cache_value {
+		std::uint32_t version;
+		std::uint32_t padding;
+		std::uint64_t source_hash;
+	};
+
+	std::uint32_t align4(std::uint32_t const value)
+	{
+		return (value + 3u) & ~3u;
+	}
+
+	size_t getBlockSize(GLenum const internal_format)
+	{
+		return internal_format == compressed_rgb_s3tc_dxt1 ? 8u : 16u;
+	}
+
+	size_t getLevelSize(GLenum const internal_format, std::uint32_t const width, std::uint32_t const height)
+	{
+		return static_cast<size_t>((width + 3u) / 4u) * ((height + 3u) / 4u) * getBlockSize(internal_format);
+	}
+
+	std::uint32_t getLevelsNb(std::uint32_t const width, std::uint32_t const height)
+	{
+		std::uint32_t levels_nb = 1u;
+		for (auto size = std::max(width, height); size > 1u; size /= 2u)
+			++levels_nb;
+		return levels_nb;
+	}
+
+	//! \brief Halve an RGBA8 image with a 2×2 box filter; odd rows and
+	//!        columns are clamped to the edge.
+	std::vector<std::uint8_t> downsample(std::vector<std::uint8_t> const& source, std::uint32_t const width, std::uint32_t const height,
+	                                     std::uint32_t& downsampled_width, std::uint32_t& downsampled_height)
+	{
+		downsampled_width = std::max(width / 2u, 1u);
+		downsampled_height = std::max(height / 2u, 1u);
+
+		std::vector<std::uint8_t> downsampled(static_cast<size_t>(downsampled_width) * downsampled_height * 4u);
+		for (std::uint32_t y = 0u; y < downsampled_height; ++y) {
+			auto const y0 = std::min(2u * y, height - 1u);
+			auto const y1 = std::min(2u * y + 1u, height - 1u);
+			for (std::uint32_t x = 0u; x < downsampled_width; ++x) {
+				auto const x0 = std::min(2u * x, width - 1u);
+				auto const x1 = std::min(2u * x + 1u, width - 1u);
+				for (std::uint32_t c = 0u; c < 4u; ++c) {
+					auto const sum = source[(static_cast<size_t>(y0) * width + x0) * 4u + c]
+					               + source[(static_cast<size_t>(y0) * width + x1) * 4u + c]
+					               + source[(static_cast<size_t>(y1) * width + x0) * 4u + c]
+					               + source[(static_cast<size_t>(y1) * width + x1) * 4u + c];
+					downsampled[(static_cast<size_t>(y) * downsampled_width + x) * 4u + c] = static_cast<std::uint8_t>((sum + 2u) / 4u);
+				}
+			}
+		}
+
+		return downsampled;
+	}
+
+	//! \brief Compress an RGBA8 image, 4×4 blocks at a time; blocks
+	//!        crossing the edges of the image repeat its last row and
+	//!        column.
+	std::vector<std::uint8_t> compress(std::vector<std::uint8_t> const& rgba, std::uint32_t const width, std::uint32_t const height,
+	                                   GLenum const internal_format)
+	{
+		auto const has_alpha = internal_format == compressed_rgba_s3tc_dxt5;
+		auto const block_size = getBlockSize(internal_format);
+
+		std::vector<std::uint8_t> compressed(getLevelSize(internal_format, width, height));
+		auto output = compressed.data();
+		std::array<std::uint8_t, 4u * 4u * 4u> block;
+		std::array<std::uint8_t, 4u * 4u * 2u> rg_block;
+		for (std::uint32_t block_y = 0u; block_y < height; block_y += 4u) {
+			for (std::uint32_t block_x = 0u; block_x < width; block_x += 4u) {
+				for (std::uint32_t y = 0u; y < 4u; ++y) {
+					auto const source_y = std::min(block_y + y, height - 1u);
+					for (std::uint32_t x = 0u; x < 4u; ++x) {
+						auto const source_x = std::min(block_x + x, width - 1u);
+						std::memcpy(block.data() + (y * 4u + x) * 4u, rgba.data() + (static_cast<size_t>(source_y) * width + source_x) * 4u, 4u);
+					}
+				}
+				if (internal_format == GL_COMPRESSED_RG_RGTC2) {
+					for (std::uint32_t i = 0u; i < 4u * 4u; ++i) {
+						rg_block[i * 2u + 0u] = block[i * 4u + 0u];
+						rg_block[i * 2u + 1u] = block[i * 4u + 1u];
+					}
+					stb_compress_bc5_block(output, rg_block.data());
+				} else {
+					stb_compress_dxt_block(output, block.data(), has_alpha ? 1 : 0, STB_DXT_NORMAL);
+				}
+				output += block_size;
+			}
+		}
+
+		return compressed;
+	}
+
+	bool readFile(std::string const& path, std::vector<std::uint8_t>& content)
+	{
+		std::ifstream file(utils::widen(path), std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !file.bad();
+	}
+}
+
+size_t
+TextureCache::Texture::GetSize() const
+{
+	size_t size = 0u;
+	for (auto const& level : levels)
+		size += level.size();
+	return size;
+}
+
+std::string
+TextureCache::GetPath(std::string const& source_path, Usage const usage)
+{
+	return source_path + (usage == Usage::normal_map ? ".normal.ktx" : ".ktx");
+}
+
+size_t
+TextureCache::GetUncompressedSize(std::uint32_t width, std::uint32_t height)
+{
+	size_t size = 0u;
+	for (auto levels_nb = getLevelsNb(width, height); levels_nb > 0u; --levels_nb) {
+		size += static_cast<size_t>(width) * height * 4u;
+		width = std::max(width / 2u, 1u);
+		height = std::max(height / 2u, 1u);
+	}
+	return size;
+}
+
+TextureCache::Texture
+TextureCache::Encode(std::vector<std::uint8_t> const& rgba, std::uint32_t const width, std::uint32_t const height,
+                     Usage const usage)
+{
+	Texture texture;
+	texture.width = width;
+	texture.height = height;
+
+	if (usage == Usage::normal_map) {
+		texture.internal_format = GL_COMPRESSED_RG_RGTC2;
+	} else {
+		bool has_alpha = false;
+		for (size_t i = 3u; i < rgba.size() && !has_alpha; i += 4u)
+			has_alpha = rgba[i] != 255u;
+		texture.internal_format = has_alpha ? compressed_rgba_s3tc_dxt5 : compressed_rgb_s3tc_dxt1;
+	}
+
+	auto const levels_nb = getLevelsNb(width, height);
+	texture.levels.reserve(levels_nb);
+	texture.levels.push_back(compress(rgba, width, height, texture.internal_format));
+
+	std::vector<std::uint8_t> level = rgba;
+	auto level_width = width;
+	auto level_height = height;
+	for (std::uint32_t i = 1u; i < levels_nb; ++i) {
+		std::uint32_t next_width = 0u, next_height = 0u;
+		level = downsample(level, level_width, level_height, next_width, next_height);
+		level_width = next_width;
+		level_height = next_height;
+		texture.levels.push_back(compress(level, level_width, level_height, texture.internal_format));
+	}
+
+	return texture;
+}
+
+bool
+TextureCache::Build(std::string const& source_path, Usage const usage, Texture& texture, std::string& error)
+{
+	int width = 0, height = 0;
+	stbi_set_flip_vertically_on_load_thread(1);
+	auto const image_data = stbi_load(source_path.c_str(), &width, &height, nullptr, 4);
+	if (image_data == nullptr) {
+		error = "Couldn't load or decode image file " + source_path;
+		return false;
+	}
+
+	std::vector<std::uint8_t> const rgba(image_data, image_data + static_cast<size_t>(width) * height * 4u);
+	stbi_image_free(image_data);
+
+	texture = Encode(rgba, static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), usage);
+	return true;
+}
+
+bool
+TextureCache::Read(std::string const& path, std::uint64_t const expected_source_hash, Usage const usage, Texture& texture, std::string& error)
+{
+	texture = Texture();
+
+	std::vector<std::uint8_t> content;
+	if (!readFile(path, content)) {
+		error = "No cache found at \"" + path + "\"";
+		return false;
+	}
+
+	auto const corrupt = [&error, &path](){
+		error = "Cache \"" + path + "\" is corrupt";
+		return false;
+	};
+
+	ktx_header header;
+	if (content.size() < sizeof(header))
+		return corrupt();
+	std::memcpy(&header, content.data(), sizeof(header));
+	if (header.identifier != ktx_identifier)
+		return corrupt();
+	if (header.endianness != ktx_endianness) {
+		error = "Cache \"" + path + "\" was written with a different byte order";
+		return false;
+	}
+	if (header.gl_type != 0u || header.pixel_depth != 0u || header.array_elements_nb != 0u || header.faces_nb != 1u
+	 || (header.gl_internal_format != compressed_rgb_s3tc_dxt1 && header.gl_internal_format != compressed_rgba_s3tc_dxt5
+	  && header.gl_internal_format != GL_COMPRESSED_RG_RGTC2)
+	 || header.pixel_width == 0u || header.pixel_height == 0u
+	 || header.mipmap_levels_nb != getLevelsNb(header.pixel_width, header.pixel_height)
+	 || header.key_value_data_size > content.size() - sizeof(header))
+		return corrupt();
+
+	// Look for the version and source hash among the key/value pairs.
+	bool is_cache_value_found = false;
+	cache_value value{};
+	auto const key_length = std::strlen(cache_key) + 1u;
+	size_t offset = sizeof(header);
+	auto const key_value_end = offset + header.key_value_data_size;
+	while (offset + sizeof(std::uint32_t) <= key_value_end) {
+		std::uint32_t pair_size = 0u;
+		std::memcpy(&pair_size, content.data() + offset, sizeof(pair_size));
+		offset += sizeof(pair_size);
+		if (pair_size > key_value_end - offset)
+			return corrupt();
+		if (pair_size == key_length + sizeof(value) && std::memcmp(content.data() + offset, cache_key, key_length) == 0) {
+			std::memcpy(&value, content.data() + offset + key_length, sizeof(value));
+			is_cache_value_found = true;
+		}
+		offset += align4(pair_size);
+	}
+	offset = key_value_end;
+	if (!is_cache_value_found)
+		return corrupt();
+	if (value.version != version) {
+		error = "Cache \"" + path + "\" was written by a different version";
+		return false;
+	}
+	if (value.source_hash != expected_source_hash) {
+		error = "Cache \"" + path + "\" is out of date";
+		return false;
+	}
+	if (!isFormatOfUsage(static_cast<GLenum>(header.gl_internal_format), usage)) {
+		error = "Cache \"" + path + "\" was built for a different usage";
+		return false;
+	}
+
+	texture.internal_format = static_cast<GLenum>(header.gl_internal_format);
+	texture.width = header.pixel_width;
+	texture.height = header.pixel_height;
+	texture.levels.resize(header.mipmap_levels_nb);
+	auto level_width = texture.width;
+	auto level_height = texture.height;
+	for (auto& level : texture.levels) {
+		std::uint32_t image_size = 0u;
+		if (sizeof(image_size) > content.size() - offset)
+			return corrupt();
+		std::memcpy(&image_size, content.data() + offset, sizeof(image_size));
+		offset += sizeof(image_size);
+		if (image_size != getLevelSize(texture.internal_format, level_width, level_height) || image_size > content.size() - offset)
+			return corrupt();
+
+		level.assign(content.data() + offset, content.data() + offset + image_size);
+		offset += align4(image_size);
+		level_width = std::max(level_width / 2u, 1u);
+		level_height = std::max(level_height / 2u, 1u);
+	}
+
+	return true;
+}
+
+bool
+TextureCache::Write(std::string const& path, Texture const& texture, std::uint64_t const source_hash, std::string& error)
+{
+	auto const key_length = static_cast<std::uint32_t>(std::strlen(cache_key) + 1u);
+	cache_value const value{ version, 0u, source_hash };
+	auto const pair_size = key_length + static_cast<std::uint32_t>(sizeof(value));
+
+	ktx_header header;
+	header.identifier = ktx_identifier;
+	header.endianness = ktx_endianness;
+	header.gl_type = 0u;
+	header.gl_type_size = 1u;
+	header.gl_format = 0u;
+	header.gl_internal_format = texture.internal_format;
+	header.gl_base_internal_format = texture.internal_format == compressed_rgba_s3tc_dxt5 ? GL_RGBA
+	                               : texture.internal_format == GL_COMPRESSED_RG_RGTC2 ? GL_RG
+	                               : GL_RGB;
+	header.pixel_width = texture.width;
+	header.pixel_height = texture.height;
+	header.pixel_depth = 0u;
+	header.array_elements_nb = 0u;
+	header.faces_nb = 1u;
+	header.mipmap_levels_nb = static_cast<std::uint32_t>(texture.levels.size());
+	header.key_value_data_size = static_cast<std::uint32_t>(sizeof(pair_size)) + align4(pair_size);
+
+	// Write to a temporary file first, so that an interrupted write never
+	// leaves a truncated cache behind.
+	auto const temporary_path = path + ".tmp";
+	{
+		std::ofstream file(utils::widen(temporary_path), std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			error = "Failed to open \"" + temporary_path + "\" for writing";
+			return false;
+		}
+
+		std::array<char, 4> const padding{};
+		auto const write = [&file](void const* data, size_t size){
+			file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+		};
+		write(&header, sizeof(header));
+		write(&pair_size, sizeof(pair_size));
+		write(cache_key, key_length);
+		write(&value, sizeof(value));
+		write(padding.data(), align4(pair_size) - pair_size);
+		for (auto const& level : texture.levels) {
+			auto const image_size = static_cast<std::uint32_t>(level.size());
+			write(&image_size, sizeof(image_size));
+			write(level.data(), level.size());
+			write(padding.data(), align4(image_size) - image_size);
+		}
+
+		if (!file) {
+			error = "Failed to write \"" + temporary_path + "\"";
+			file.close();
+			std::remove(temporary_path.c_str());
+			return false;
+		}
+	}
+
+	std::remove(path.c_str());
+	if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+		error = "Failed to move \"" + temporary_path + "\" to \"" + path + "\"";
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+
+	return true;
+}
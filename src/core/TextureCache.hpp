@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! \brief Cache of block-compressed 2D textures, including their whole
+//!        mipmap chain, so that images only need to be decoded, filtered
+//!        and compressed once.
+//!
+//! A cache is stored next to its source image, with the extension ".ktx"
+//! appended, as a KTX 1.1 file: any KTX viewer can open it. The hash of the
+//! source image content (see `utils::hash_file()`) and the version of the
+//! cache are stored in a "bonobo.cache" key/value entry, and a cache is
+//! only used if both match.
+//!
+//! Opaque images are compressed to BC1 (DXT1), and images with an alpha
+//! channel to BC3 (DXT5), using 4, respectively 8, bits per texel instead
+//! of the 32 bits of RGBA8. Normal maps are compressed to BC5 (RGTC2)
+//! instead, which only keeps their X and Y components but with far more
+//! precision; shaders rebuild Z (see "common/normal_map.glsl"). They are
+//! cached separately, with the extension ".normal.ktx".
+namespace TextureCache
+{
+	//! \brief What the content of an image represents, which decides how
+	//!        it gets compressed.
+	enum class Usage : std::uint32_t {
+		colour,    //!< colours, or any other data, compressed to BC1 or BC3
+		normal_map //!< tangent-space normals, compressed to BC5
+	};
+
+	//! \brief A compressed texture, ready to be uploaded with
+	//!        `glCompressedTexImage2D()`.
+	struct Texture {
+		GLenum internal_format{ 0u };
+		std::uint32_t width{ 0u };
+		std::uint32_t height{ 0u };
+		//! \brief Compressed data of each mipmap level, from the largest to
+		//!        the 1×1 one.
+		std::vector<std::vector<std::uint8_t>> levels;
+
+		//! \brief Size of all mipmap levels, in bytes.
+		size_t GetSize() const;
+	};
+
+	//! \brief Retrieve the path of the cache for a given image file and
+	//!        usage.
+	std::string GetPath(std::string const& source_path, Usage usage = Usage::colour);
+
+	//! \brief Size in bytes of an RGBA8 texture of the given size, with a
+	//!        complete mipmap chain: what the same image takes once decoded
+	//!        and uploaded as is.
+	size_t GetUncompressedSize(std::uint32_t width, std::uint32_t height);
+
+	//! \brief Compute the mipmap chain of an RGBA8 image and compress all of
+	//!        its levels.
+	//!
+	//! Levels are downsampled with a box filter, as `glGenerateMipmap()`
+	//! commonly does. This does not use any OpenGL function and can
+	//! therefore be called from any thread.
+	//!
+	//! @param [in] rgba the pixels of the image, four bytes per pixel
+	//! @param [in] width width of the image
+	//! @param [in] height height of the image
+	//! @param [in] usage what the pixels represent
+	//! @return the compressed texture
+	Texture Encode(std::vector<std::uint8_t> const& rgba, std::uint32_t width, std::uint32_t height,
+	               Usage usage = Usage::colour);
+
+	//! \brief Decode an image file with stb, flipped vertically as
+	//!        `bonobo::loadTexture2D()` does, and compress it.
+	//!
+	//! @param [in] source_path path to the image file
+	//! @param [in] usage what the image represents
+	//! @param [out] texture the compressed texture
+	//! @param [out] error reason for the failure, if any
+	//! @return whether the image could be decoded
+	bool Build(std::string const& source_path, Usage usage, Texture& texture, std::string& error);
+
+	//! \brief Read and parse a cache.
+	//!
+	//! @param [in] path path to the cache
+	//! @param [in] expected_source_hash hash of the current content of the
+	//!             source file
+	//! @param [in] usage what the source file represents
+	//! @param [out] texture the content of the cache
+	//! @param [out] error reason for the failure, if any
+	//! @return false if the cache does not exist, is of a different
+	//!         version or usage, was built from a different source, or is
+	//!         corrupt
+	bool Read(std::string const& path, std::uint64_t expected_source_hash, Usage usage, Texture& texture, std::string& error);
+
+	//! \brief Write a cache, replacing any existing one.
+	//!
+	//! @param [in] path path to the cache
+	//! @param [in] texture the content to write
+	//! @param [in] source_hash hash of the content of the source file
+	//! @param [out] error reason for the failure, if any
+	//! @return whether the cache was successfully written
+	bool Write(std::string const& path, Texture const& texture, std::uint64_t source_hash, std::string& error);
+}
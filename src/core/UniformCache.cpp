@@ -0,0 +1,127 @@
+#include "UniformCache.hpp"
+
+#include "Log.h"
+
+#include <memory>
+#include <unordered_map>
+
+namespace
+{
+	using ProgramLocations = std::unordered_map<std::string, GLint>;
+
+	std::unordered_map<GLuint, ProgramLocations> programs_locations;
+
+	// Starts at 1 so that default-initialised handles always resolve their
+	// location on first use.
+	std::uint32_t generation = 1u;
+
+	ProgramLocations& registerProgram(GLuint const program)
+	{
+		auto& locations = programs_locations[program];
+		locations.clear();
+
+		GLint active_uniforms_nb = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &active_uniforms_nb);
+		GLint name_max_length = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &name_max_length);
+		if (active_uniforms_nb <= 0 || name_max_length <= 0)
+			return locations;
+
+		auto name_buffer = std::make_unique<GLchar[]>(static_cast<size_t>(name_max_length));
+		for (GLint i = 0; i < active_uniforms_nb; ++i) {
+			GLsizei name_length = 0;
+			GLint array_size = 0;
+			GLenum type = GL_NONE;
+			glGetActiveUniform(program, static_cast<GLuint>(i), name_max_length, &name_length, &array_size, &type, name_buffer.get());
+			std::string const name(name_buffer.get(), static_cast<size_t>(name_length));
+
+			// Uniforms living in uniform blocks have no location.
+			GLint const location = glGetUniformLocation(program, name.c_str());
+			if (location < 0)
+				continue;
+
+			// Arrays are reported as "name[0]", but they can also be
+			// accessed as "name", and each of their elements as "name[i]".
+			auto const array_suffix_position = name.rfind("[0]");
+			if (array_suffix_position == std::string::npos || array_suffix_position + 3u != name.size()) {
+				locations.emplace(name, location);
+				continue;
+			}
+
+			auto const base_name = name.substr(0u, array_suffix_position);
+			locations.emplace(base_name, location);
+			locations.emplace(name, location);
+			for (GLint j = 1; j < array_size; ++j) {
+				auto const element_name = base_name + "[" + std::to_string(j) + "]";
+				locations.emplace(element_name, glGetUniformLocation(program, element_name.c_str()));
+			}
+		}
+
+		return locations;
+	}
+}
+
+void
+UniformCache::Register(GLuint const program)
+{
+	if (program == 0u)
+		return;
+
+	registerProgram(program);
+}
+
+void
+UniformCache::Unregister(GLuint const program)
+{
+	if (programs_locations.erase(program) > 0u)
+		++generation;
+}
+
+GLint
+UniformCache::GetLocation(GLuint const program, std::string const& name)
+{
+	if (program == 0u)
+		return -1;
+
+	auto program_locations = programs_locations.find(program);
+	auto const& locations = (program_locations != programs_locations.end()) ? program_locations->second
+	                                                                        : registerProgram(program);
+
+	auto const location = locations.find(name);
+	return (location != locations.end()) ? location->second : -1;
+}
+
+std::uint32_t
+UniformCache::GetGeneration() noexcept
+{
+	return generation;
+}
+
+UniformLocation::UniformLocation(std::string name) : _name(std::move(name))
+{
+}
+
+GLint
+UniformLocation::operator()(GLuint const program) const
+{
+	auto const current_generation = UniformCache::GetGeneration();
+	if (_generation != current_generation) {
+		_locations.clear();
+		_generation = current_generation;
+	}
+
+	for (auto const& location : _locations) {
+		if (location.first == program)
+			return location.second;
+	}
+
+	auto const location = UniformCache::GetLocation(program, _name);
+	_locations.emplace_back(program, location);
+	return location;
+}
+
+std::string const&
+UniformLocation::GetName() const noexcept
+{
+	return _name;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+
+//! \brief Per-program cache of uniform and sampler locations.
+//!
+//! The locations of all active uniforms of a program are retrieved once,
+//! right after it was linked, so that rendering code never has to call
+//! `glGetUniformLocation()` itself.
+namespace UniformCache
+{
+	//! \brief Retrieve and store the locations of all active uniforms of
+	//!        a successfully linked program.
+	//!
+	//! @param [in] program OpenGL name of the linked shader program
+	void Register(GLuint program);
+
+	//! \brief Forget all locations cached for a program.
+	//!
+	//! This has to be called before deleting or relinking a program, as
+	//! OpenGL is free to reuse its name for a different program later on.
+	//!
+	//! @param [in] program OpenGL name of the shader program
+	void Unregister(GLuint program);
+
+	//! \brief Look up the location of a uniform in the cache.
+	//!
+	//! Programs which were not registered beforehand, for example because
+	//! they were not created through the `ShaderProgramManager`, get
+	//! registered on their first look-up.
+	//!
+	//! @param [in] program OpenGL name of the shader program
+	//! @param [in] name the name of the uniform, as written in GLSL
+	//! @return the location of the uniform, or -1 if the program has no
+	//!         active uniform with that name
+	GLint GetLocation(GLuint program, std::string const& name);
+
+	//! \brief Retrieve a counter which gets incremented every time a
+	//!        program is unregistered.
+	//!
+	//! Locations cached outside of this module are only valid as long as
+	//! this counter does not change.
+	std::uint32_t GetGeneration() noexcept;
+}
+
+//! \brief Handle to a named uniform, which resolves its location once per
+//!        program and then serves it without any string look-up.
+//!
+//! Typical usage is to create the handles once, next to the code setting
+//! the uniforms, and to call them on the program currently in use:
+//!
+//!     UniformLocation const light_position_location("light_position");
+//!     …
+//!     glUniform3fv(light_position_location(program), 1, …);
+class UniformLocation
+{
+public:
+	explicit UniformLocation(std::string name);
+
+	//! \brief Retrieve the location of this uniform in a given program.
+	//!
+	//! @param [in] program OpenGL name of the shader program
+	//! @return the location of the uniform, or -1 if the program has no
+	//!         active uniform with that name
+	GLint operator()(GLuint program) const;
+
+	std::string const& GetName() const noexcept;
+
+private:
+	std::string _name;
+	mutable std::uint32_t _generation{ 0u };
+	mutable std::vector<std::pair<GLuint, GLint>> _locations;
+};
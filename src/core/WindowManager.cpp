@@ -14,8 +14,16 @@ namespace
 	const int default_opengl_minor_version = 1;
 	const int default_glsl_version = default_opengl_major_version * 100 + default_opengl_minor_version * 10;
 
+	// Tried first, for compute shaders, shader storage buffers and
+	// indirect draws; macOS does not go beyond 4.1.
+	const int preferred_opengl_major_version = 4;
+	const int preferred_opengl_minor_version = 3;
+	bool is_probing_opengl_version = false;
+
 	void ErrorCallback(int error, char const* description)
 	{
+		if (is_probing_opengl_version && (error == 65543 || error == 65545))
+			return;
 		if (error == 65543 || error == 65545)
 			LogError("Couldn't create an OpenGL %d.%d context.\nIf you are using old hardware/drivers which support OpenGL 3.3 but not higher, try using the 'OpenGL_3.3' branch.", default_opengl_major_version, default_opengl_minor_version);
 		else
@@ -97,9 +105,6 @@ GLFWwindow* WindowManager::CreateGLFWWindow(std::string const& title, WindowDatu
 #if DEBUG_LEVEL >= 2
 	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #endif
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, default_opengl_major_version);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, default_opengl_minor_version);
-
 	glfwWindowHint(GLFW_RESIZABLE, resizable ? GLFW_TRUE : GLFW_FALSE);
 	glfwWindowHint(GLFW_SAMPLES, static_cast<int>(msaa));
 
@@ -117,7 +122,19 @@ GLFWwindow* WindowManager::CreateGLFWWindow(std::string const& title, WindowDatu
 	glfwWindowHint(GLFW_BLUE_BITS, video_mode->blueBits);
 	glfwWindowHint(GLFW_REFRESH_RATE, video_mode->refreshRate);
 
-	GLFWwindow* window = glfwCreateWindow(width, height, title.c_str(), fullscreen ? monitor : nullptr, nullptr);
+	GLFWwindow* window = nullptr;
+#ifndef __APPLE__
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, preferred_opengl_major_version);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, preferred_opengl_minor_version);
+	is_probing_opengl_version = true;
+	window = glfwCreateWindow(width, height, title.c_str(), fullscreen ? monitor : nullptr, nullptr);
+	is_probing_opengl_version = false;
+#endif
+	if (window == nullptr) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, default_opengl_major_version);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, default_opengl_minor_version);
+		window = glfwCreateWindow(width, height, title.c_str(), fullscreen ? monitor : nullptr, nullptr);
+	}
 
 	if (window == nullptr)
 		return nullptr;
@@ -0,0 +1,168 @@
+#include "frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+bool
+bonobo::bounding_volume::is_empty() const
+{
+	return sphere_radius < 0.0f;
+}
+
+bonobo::bounding_volume
+bonobo::computeBounds(void const* const positions, size_t const positions_stride, size_t const vertices_nb)
+{
+	bounding_volume bounds;
+	if (positions == nullptr || vertices_nb == 0u)
+		return bounds;
+
+	// Positions may be interleaved with other attributes, and unaligned.
+	auto const data = static_cast<std::uint8_t const*>(positions);
+	auto const position = [data, positions_stride](size_t const i){
+		glm::vec3 p;
+		std::memcpy(&p, data + i * positions_stride, sizeof(p));
+		return p;
+	};
+
+	for (size_t i = 0u; i < vertices_nb; ++i) {
+		auto const p = position(i);
+		bounds.min_corner = glm::min(bounds.min_corner, p);
+		bounds.max_corner = glm::max(bounds.max_corner, p);
+	}
+
+	bounds.sphere_center = 0.5f * (bounds.min_corner + bounds.max_corner);
+	float squared_radius = 0.0f;
+	for (size_t i = 0u; i < vertices_nb; ++i) {
+		auto const offset = position(i) - bounds.sphere_center;
+		squared_radius = std::max(squared_radius, glm::dot(offset, offset));
+	}
+	bounds.sphere_radius = std::sqrt(squared_radius);
+
+	return bounds;
+}
+
+bonobo::bounding_volume
+bonobo::transformBounds(bounding_volume const& bounds, glm::mat4 const& transform)
+{
+	if (bounds.is_empty())
+		return bounds;
+
+	// Arvo, "Transforming Axis-Aligned Bounding Boxes", 1990: the extent
+	// of the transformed box along each axis is the sum of the absolute
+	// contributions of the original extent.
+	auto const linear = glm::mat3(transform);
+	auto const center = glm::vec3(transform * glm::vec4(0.5f * (bounds.min_corner + bounds.max_corner), 1.0f));
+	auto const extent = 0.5f * (bounds.max_corner - bounds.min_corner);
+	glm::vec3 transformed_extent(0.0f);
+	for (int column = 0; column < 3; ++column)
+		transformed_extent += glm::abs(linear[column]) * extent[column];
+
+	auto const max_scale = std::max({ glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]) });
+
+	bounding_volume transformed;
+	transformed.min_corner = center - transformed_extent;
+	transformed.max_corner = center + transformed_extent;
+	transformed.sphere_center = glm::vec3(transform * glm::vec4(bounds.sphere_center, 1.0f));
+	transformed.sphere_radius = bounds.sphere_radius * max_scale;
+	return transformed;
+}
+
+bonobo::bounding_volume
+bonobo::mergeBounds(bounding_volume const& a, bounding_volume const& b)
+{
+	if (a.is_empty())
+		return b;
+	if (b.is_empty())
+		return a;
+
+	bounding_volume merged;
+	merged.min_corner = glm::min(a.min_corner, b.min_corner);
+	merged.max_corner = glm::max(a.max_corner, b.max_corner);
+
+	auto const offset = b.sphere_center - a.sphere_center;
+	auto const distance = glm::length(offset);
+	if (distance + b.sphere_radius <= a.sphere_radius) {
+		merged.sphere_center = a.sphere_center;
+		merged.sphere_radius = a.sphere_radius;
+	} else if (distance + a.sphere_radius <= b.sphere_radius) {
+		merged.sphere_center = b.sphere_center;
+		merged.sphere_radius = b.sphere_radius;
+	} else {
+		merged.sphere_radius = 0.5f * (distance + a.sphere_radius + b.sphere_radius);
+		merged.sphere_center = a.sphere_center + offset * ((merged.sphere_radius - a.sphere_radius) / distance);
+	}
+
+	return merged;
+}
+
+constexpr size_t Frustum::planes_nb;
+
+Frustum::Frustum(glm::mat4 const& to_clip)
+{
+	auto const row = [&to_clip](int const r){
+		return glm::vec4(to_clip[0][r], to_clip[1][r], to_clip[2][r], to_clip[3][r]);
+	};
+	auto const w = row(3);
+	std::array<glm::vec4, 6u> const planes = {
+		w + row(0), w - row(0), // left, right
+		w + row(1), w - row(1), // bottom, top
+		w + row(2), w - row(2)  // near, far
+	};
+
+	// The last two entries repeat the near and far planes, which does not
+	// change the outcome of any test.
+	for (size_t i = 0u; i < planes_nb; ++i) {
+		auto plane = planes[i < planes.size() ? i : i - 2u];
+		// Normalise, so that distances to the planes are actual
+		// distances, as needed by the sphere test.
+		auto const length = glm::length(glm::vec3(plane));
+		if (length > 0.0f)
+			plane /= length;
+		_normals_x[i] = plane.x;
+		_normals_y[i] = plane.y;
+		_normals_z[i] = plane.z;
+		_distances[i] = plane.w;
+	}
+}
+
+bool
+Frustum::intersects_box(glm::vec3 const& min_corner, glm::vec3 const& max_corner) const
+{
+	auto const center = 0.5f * (min_corner + max_corner);
+	auto const extent = 0.5f * (max_corner - min_corner);
+
+	// The box is outside as soon as it is fully on the negative side of
+	// one plane, i.e. when even its corner furthest along the normal is.
+	int outside = 0;
+	for (size_t i = 0u; i < planes_nb; ++i) {
+		auto const distance = _normals_x[i] * center.x + _normals_y[i] * center.y + _normals_z[i] * center.z + _distances[i];
+		auto const radius = std::abs(_normals_x[i]) * extent.x + std::abs(_normals_y[i]) * extent.y + std::abs(_normals_z[i]) * extent.z;
+		outside |= (distance < -radius) ? 1 : 0;
+	}
+	return outside == 0;
+}
+
+bool
+Frustum::intersects_sphere(glm::vec3 const& center, float const radius) const
+{
+	int outside = 0;
+	for (size_t i = 0u; i < planes_nb; ++i) {
+		auto const distance = _normals_x[i] * center.x + _normals_y[i] * center.y + _normals_z[i] * center.z + _distances[i];
+		outside |= (distance < -radius) ? 1 : 0;
+	}
+	return outside == 0;
+}
+
+bool
+Frustum::intersects(bonobo::bounding_volume const& bounds) const
+{
+	if (bounds.is_empty())
+		return true;
+
+	// Both volumes are conservative, so either of them being outside is
+	// enough to reject; the sphere test is the cheaper one.
+	return intersects_sphere(bounds.sphere_center, bounds.sphere_radius)
+	    && intersects_box(bounds.min_corner, bounds.max_corner);
+}
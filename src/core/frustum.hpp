@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <limits>
+
+namespace bonobo
+{
+	//! \brief Axis-aligned box and sphere enclosing some geometry.
+	//!
+	//! Both are kept as they complement each other: the sphere is cheaper
+	//! to test and to transform, while the box is tighter for elongated
+	//! geometry such as walls or columns.
+	//!
+	//! A default-constructed volume is empty; see `is_empty()`.
+	struct bounding_volume {
+		glm::vec3 min_corner{ std::numeric_limits<float>::max() };
+		glm::vec3 max_corner{ std::numeric_limits<float>::lowest() };
+		glm::vec3 sphere_center{ 0.0f };
+		float sphere_radius{ -1.0f };
+
+		//! \brief Whether this volume does not enclose anything, for
+		//!        example because it was never computed.
+		bool is_empty() const;
+	};
+
+	//! \brief Compute the bounds of a set of positions.
+	//!
+	//! The box is the tightest axis-aligned one, and the sphere is centred
+	//! on the box and just large enough to enclose all positions.
+	//!
+	//! @param [in] positions first position, as three floats
+	//! @param [in] positions_stride bytes between two consecutive positions
+	//! @param [in] vertices_nb number of positions
+	bounding_volume computeBounds(void const* positions, size_t positions_stride, size_t vertices_nb);
+
+	//! \brief Transform a volume, for example from model-space to
+	//!        world-space.
+	//!
+	//! The resulting box encloses the transformed box, and the sphere is
+	//! scaled by the largest scaling of the transform, so both remain
+	//! conservative.
+	bounding_volume transformBounds(bounding_volume const& bounds, glm::mat4 const& transform);
+
+	//! \brief Return a volume enclosing both |a| and |b|; empty volumes
+	//!        are ignored.
+	bounding_volume mergeBounds(bounding_volume const& a, bounding_volume const& b);
+}
+
+//! \brief The six planes of a view frustum, for conservatively testing
+//!        whether bounding volumes are visible.
+//!
+//! Planes are extracted from a transform to clip-space (Gribb and
+//! Hartmann, "Fast Extraction of Viewing Frustum Planes from the
+//! World-View-Projection Matrix", 2001), in whichever space the transform
+//! starts from: a world-to-clip matrix gives world-space planes, while a
+//! model-to-clip one gives model-space planes.
+//!
+//! Planes are stored as a structure of arrays padded to eight entries, and
+//! all tests go through every plane without branching, so that compilers
+//! can vectorise them without relying on intrinsics.
+class Frustum
+{
+public:
+	//! \brief Extract the planes of the frustum.
+	//!
+	//! @param [in] to_clip Matrix transforming to clip-space
+	explicit Frustum(glm::mat4 const& to_clip);
+
+	//! \brief Whether a box lies at least partially inside the frustum.
+	bool intersects_box(glm::vec3 const& min_corner, glm::vec3 const& max_corner) const;
+
+	//! \brief Whether a sphere lies at least partially inside the
+	//!        frustum.
+	bool intersects_sphere(glm::vec3 const& center, float radius) const;
+
+	//! \brief Whether a volume lies at least partially inside the
+	//!        frustum, using both its sphere and its box.
+	//!
+	//! Empty volumes are considered visible, so that meshes whose bounds
+	//! were never computed are never culled.
+	bool intersects(bonobo::bounding_volume const& bounds) const;
+
+private:
+	static constexpr size_t planes_nb = 8u;
+
+	// Plane i contains the points p for which
+	// dot(p, (_normals_x[i], _normals_y[i], _normals_z[i])) + _distances[i]
+	// is 0, and the frustum is on its positive side.
+	alignas(16) std::array<float, planes_nb> _normals_x;
+	alignas(16) std::array<float, planes_nb> _normals_y;
+	alignas(16) std::array<float, planes_nb> _normals_z;
+	alignas(16) std::array<float, planes_nb> _distances;
+};
@@ -2,20 +2,34 @@
 #include "helpers.hpp"
 
 #include "core/Log.h"
+#include "core/MeshCache.hpp"
 #include "core/opengl.hpp"
+#include "core/TextureCache.hpp"
 #include "core/various.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
 #include <stb_image.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 namespace
 {
@@ -83,216 +97,426 @@ bonobo::deinit()
 	glDeleteVertexArrays(1, &local::display_vao);
 }
 
-static std::vector<std::uint8_t>
-getTextureData(std::string const& filename, std::uint32_t& width, std::uint32_t& height, bool flip)
+namespace
 {
-	auto const channels_nb = 4u;
-	stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
-	unsigned char* image_data = stbi_load(filename.c_str(), reinterpret_cast<int*>(&width), reinterpret_cast<int*>(&height), nullptr, channels_nb);
-	if (image_data == nullptr) {
-		LogWarning("Couldn't load or decode image file %s", filename.c_str());
-
-		// Provide a small empty image instead in case of failure.
-		width = 16;
-		height = 16;
-		return std::vector<unsigned char>(width * height * channels_nb);
+	//! \brief Project a vector onto the octahedron |x| + |y| + |z| = 1, and
+	//!        unfold the lower half of that octahedron over the [-1, 1]²
+	//!        square.
+	glm::vec2 octahedralEncode(glm::vec3 const& v)
+	{
+		auto const l1_norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+		if (l1_norm == 0.0f)
+			return glm::vec2(0.0f);
+
+		auto const p = glm::vec2(v.x, v.y) / l1_norm;
+		if (v.z >= 0.0f)
+			return p;
+		return glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+		                 (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
 	}
 
-	std::vector<unsigned char> image(width * height * channels_nb);
-	std::memcpy(image.data(), image_data, image.size());
-	stbi_image_free(image_data);
+	std::int16_t toSnorm16(float const value)
+	{
+		return static_cast<std::int16_t>(std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
 
-	return image;
+	glm::vec3 readVec3(void const* const data, size_t const stride, size_t const index)
+	{
+		glm::vec3 value;
+		std::memcpy(&value, static_cast<std::uint8_t const*>(data) + index * stride, sizeof(value));
+		return value;
+	}
 }
 
-std::vector<bonobo::mesh_data>
-bonobo::loadObjects(std::string const& filename)
+std::vector<std::uint8_t>
+bonobo::packVertices(vertex_format_t const format, vertex_attributes_view const& attributes, vertex_layout& layout)
 {
-	auto const scene_start_time = std::chrono::high_resolution_clock::now();
-
-	std::vector<bonobo::mesh_data> objects;
-
-	auto const end_of_basedir = filename.rfind("/");
-	auto const parent_folder = (end_of_basedir != std::string::npos ? filename.substr(0, end_of_basedir) : ".") + "/";
-	Assimp::Importer importer;
-	auto const assimp_scene = importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace);
-	if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
-		LogError("Assimp failed to load \"%s\": %s", filename.c_str(), importer.GetErrorString());
-		return objects;
+	assert(attributes.vertices != nullptr);
+
+	layout = vertex_layout();
+	layout.format = format;
+	auto const vertices_nb = attributes.vertices_nb;
+
+	if (format == vertex_format_t::float32) {
+		std::array<void const*, 5u> const sources{ { attributes.vertices, attributes.normals, attributes.texcoords,
+		                                             attributes.tangents, attributes.binormals } };
+		std::vector<std::uint8_t> data;
+		data.reserve(vertices_nb * sources.size() * sizeof(glm::vec3));
+		for (size_t i = 0u; i < sources.size(); ++i) {
+			if (sources[i] == nullptr)
+				continue;
+
+			auto& attribute = layout.attributes[i];
+			attribute.components_nb = 3;
+			attribute.offset = data.size();
+			data.resize(data.size() + vertices_nb * sizeof(glm::vec3));
+			for (size_t j = 0u; j < vertices_nb; ++j)
+				std::memcpy(data.data() + attribute.offset + j * sizeof(glm::vec3),
+				            static_cast<std::uint8_t const*>(sources[i]) + j * attributes.stride, sizeof(glm::vec3));
+			layout.vertex_size += sizeof(glm::vec3);
+		}
+		return data;
 	}
 
-	if (assimp_scene->mNumMeshes == 0u) {
-		LogError("No mesh available; loading \"%s\" must have had issues", filename.c_str());
-		return objects;
+	auto const has_normals = attributes.normals != nullptr;
+	auto const has_texcoords = attributes.texcoords != nullptr;
+	auto const has_tangents = has_normals && attributes.tangents != nullptr;
+
+	// Every attribute is kept 4-byte aligned.
+	auto const add_attribute = [&layout](shader_bindings const binding, GLint const components_nb, GLenum const type,
+	                                     GLboolean const is_normalized, size_t const size){
+		auto& attribute = layout.attributes[static_cast<size_t>(binding)];
+		attribute.components_nb = components_nb;
+		attribute.type = type;
+		attribute.is_normalized = is_normalized;
+		attribute.offset = layout.vertex_size;
+		layout.vertex_size += size;
+	};
+	add_attribute(shader_bindings::vertices, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3));
+	if (has_normals)
+		add_attribute(shader_bindings::normals, 2, GL_SHORT, GL_TRUE, 2u * sizeof(std::int16_t));
+	if (has_texcoords)
+		add_attribute(shader_bindings::texcoords, 2, GL_HALF_FLOAT, GL_FALSE, 2u * sizeof(std::uint16_t));
+	if (has_tangents)
+		// The third component holds the handedness, and the fourth one is
+		// only there for alignment.
+		add_attribute(shader_bindings::tangents, 3, GL_SHORT, GL_TRUE, 4u * sizeof(std::int16_t));
+	for (auto& attribute : layout.attributes) {
+		if (attribute.components_nb != 0)
+			attribute.stride = static_cast<GLsizei>(layout.vertex_size);
 	}
 
-	LogInfo("┭ Loading \"%s\"…", filename.c_str());
+	auto const get_offset = [&layout](shader_bindings const binding){
+		return layout.attributes[static_cast<size_t>(binding)].offset;
+	};
 
-	std::vector<bool> are_materials_used(assimp_scene->mNumMaterials, false);
-	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
-		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
-		auto const material_id = assimp_object_mesh->mMaterialIndex;
-		if (material_id >= assimp_scene->mNumMaterials)
-			LogError("Mesh \"%s\" has a material index of %u, but only %u materials are present.", assimp_object_mesh->mName.C_Str(), material_id, assimp_scene->mNumMaterials);
-		else
-			are_materials_used[material_id] = true;
+	std::vector<std::uint8_t> data(vertices_nb * layout.vertex_size);
+	for (size_t i = 0u; i < vertices_nb; ++i) {
+		auto const vertex = data.data() + i * layout.vertex_size;
+
+		auto const position = readVec3(attributes.vertices, attributes.stride, i);
+		std::memcpy(vertex + get_offset(shader_bindings::vertices), &position, sizeof(position));
+
+		glm::vec3 normal(0.0f);
+		if (has_normals) {
+			normal = readVec3(attributes.normals, attributes.stride, i);
+			auto const encoded = octahedralEncode(normal);
+			std::array<std::int16_t, 2> const packed{ { toSnorm16(encoded.x), toSnorm16(encoded.y) } };
+			std::memcpy(vertex + get_offset(shader_bindings::normals), packed.data(), sizeof(packed));
+		}
+
+		if (has_texcoords) {
+			auto const texcoord = readVec3(attributes.texcoords, attributes.stride, i);
+			std::array<std::uint16_t, 2> const packed{ { glm::packHalf1x16(texcoord.x), glm::packHalf1x16(texcoord.y) } };
+			std::memcpy(vertex + get_offset(shader_bindings::texcoords), packed.data(), sizeof(packed));
+		}
+
+		if (has_tangents) {
+			auto const tangent = readVec3(attributes.tangents, attributes.stride, i);
+			auto handedness = 1.0f;
+			if (attributes.binormals != nullptr) {
+				auto const binormal = readVec3(attributes.binormals, attributes.stride, i);
+				handedness = glm::dot(glm::cross(normal, tangent), binormal) < 0.0f ? -1.0f : 1.0f;
+			}
+			auto const encoded = octahedralEncode(tangent);
+			std::array<std::int16_t, 4> const packed{ { toSnorm16(encoded.x), toSnorm16(encoded.y), toSnorm16(handedness), 0 } };
+			std::memcpy(vertex + get_offset(shader_bindings::tangents), packed.data(), sizeof(packed));
+		}
 	}
 
-	auto const materials_start_time = std::chrono::high_resolution_clock::now();
-	std::vector<texture_bindings> materials_bindings(assimp_scene->mNumMaterials);
-	uint32_t texture_count = 0u;
-	for (size_t i = 0; i < assimp_scene->mNumMaterials; ++i) {
-		if (!are_materials_used[i])
+	return data;
+}
+
+void
+bonobo::setupVertexAttributes(vertex_layout const& layout)
+{
+	for (size_t i = 0u; i < layout.attributes.size(); ++i) {
+		auto const& attribute = layout.attributes[i];
+		if (attribute.components_nb == 0)
 			continue;
 
-		auto const material_start_time = std::chrono::high_resolution_clock::now();
-		texture_bindings& bindings = materials_bindings[i];
-		auto const material = assimp_scene->mMaterials[i];
+		glEnableVertexAttribArray(static_cast<GLuint>(i));
+		glVertexAttribPointer(static_cast<GLuint>(i), attribute.components_nb, attribute.type, attribute.is_normalized,
+		                      attribute.stride, reinterpret_cast<GLvoid const*>(attribute.offset));
+	}
+}
 
-		auto const process_texture = [&bindings,&material,i,&parent_folder,&texture_count](aiTextureType type, std::string const& type_as_str, std::string const& name){
-			if (material->GetTextureCount(type)) {
-				auto const texture_start_time = std::chrono::high_resolution_clock::now();
+void
+bonobo::uploadVertices(mesh_data& mesh, vertex_format_t const format, vertex_attributes_view const& attributes)
+{
+	auto const data = packVertices(format, attributes, mesh.layout);
+	mesh.vertices_nb = static_cast<GLsizei>(attributes.vertices_nb);
+	mesh.bounds = computeBounds(attributes.vertices, attributes.stride, attributes.vertices_nb);
+
+	glGenBuffers(1, &mesh.bo);
+	assert(mesh.bo != 0u);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.bo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.size()), reinterpret_cast<GLvoid const*>(data.data()), GL_STATIC_DRAW);
+	setupVertexAttributes(mesh.layout);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+}
 
-				if (material->GetTextureCount(type) > 1)
-					LogWarning("Material \"%s\" has more than one %s texture: discarding all but the first one.", material->GetName().C_Str(), type_as_str.c_str());
-				aiString path;
-				material->GetTexture(type, 0, &path);
-				auto const id = bonobo::loadTexture2D(parent_folder + std::string(path.C_Str()));
-				if (id == 0u) {
-					LogWarning("Failed to load the %s texture for material \"%s\".", type_as_str.c_str(), material->GetName().C_Str());
-					return;
-				}
-				bindings.emplace(name, id);
-				++texture_count;
+void
+bonobo::uploadPositions(mesh_data& mesh, void const* const positions, size_t const positions_stride)
+{
+	std::vector<glm::vec3> data(static_cast<size_t>(mesh.vertices_nb));
+	for (size_t i = 0u; i < data.size(); ++i)
+		data[i] = readVec3(positions, positions_stride, i);
+
+	glGenVertexArrays(1, &mesh.positions_vao);
+	assert(mesh.positions_vao != 0u);
+	glBindVertexArray(mesh.positions_vao);
+
+	glGenBuffers(1, &mesh.positions_bo);
+	assert(mesh.positions_bo != 0u);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.positions_bo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.size() * sizeof(glm::vec3)), reinterpret_cast<GLvoid const*>(data.data()), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(static_cast<GLuint>(shader_bindings::vertices));
+	glVertexAttribPointer(static_cast<GLuint>(shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+	if (mesh.ibo != 0u)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
+
+	utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, mesh.positions_vao, mesh.name + " positions VAO");
+	utils::opengl::debug::nameObject(GL_BUFFER, mesh.positions_bo, mesh.name + " positions VBO");
 
-				utils::opengl::debug::nameObject(GL_TEXTURE, id, std::string(material->GetName().C_Str()) + " " + type_as_str);
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+}
 
-				auto const texture_end_time = std::chrono::high_resolution_clock::now();
-				LogTrivia("│ %s Texture \"%s\" loaded in %.3f ms",
-				          bindings.size() == 1 ? "┌" : "├", path.C_Str(),
-				          std::chrono::duration<float, std::milli>(texture_end_time - texture_start_time).count());
-			}
-		};
+static std::vector<std::uint8_t>
+decodeTextureData(std::string const& filename, std::uint32_t& width, std::uint32_t& height, bool flip)
+{
+	auto const channels_nb = 4u;
+	stbi_set_flip_vertically_on_load_thread(flip ? 1 : 0);
+	unsigned char* image_data = stbi_load(filename.c_str(), reinterpret_cast<int*>(&width), reinterpret_cast<int*>(&height), nullptr, channels_nb);
+	if (image_data == nullptr)
+		return std::vector<unsigned char>();
+
+	std::vector<unsigned char> image(width * height * channels_nb);
+	std::memcpy(image.data(), image_data, image.size());
+	stbi_image_free(image_data);
 
-		process_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
-		process_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
-		process_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
-		process_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
+	return image;
+}
 
-		auto const material_end_time = std::chrono::high_resolution_clock::now();
-		LogTrivia("│ %s Material \"%s\" loaded in %.3f ms",
-		          bindings.empty() ? "╺" : "┕", material->GetName().C_Str(),
-		          std::chrono::duration<float, std::milli>(material_end_time - material_start_time).count());
+static std::vector<std::uint8_t>
+getPlaceholderTextureData(std::uint32_t& width, std::uint32_t& height)
+{
+	auto const channels_nb = 4u;
+	width = 16;
+	height = 16;
+	return std::vector<unsigned char>(width * height * channels_nb);
+}
+
+static std::vector<std::uint8_t>
+getTextureData(std::string const& filename, std::uint32_t& width, std::uint32_t& height, bool flip)
+{
+	auto image = decodeTextureData(filename, width, height, flip);
+	if (image.empty()) {
+		LogWarning("Couldn't load or decode image file %s", filename.c_str());
+
+		// Provide a small empty image instead in case of failure.
+		return getPlaceholderTextureData(width, height);
 	}
-	auto const materials_end_time = std::chrono::high_resolution_clock::now();
 
-	auto const meshes_start_time = std::chrono::high_resolution_clock::now();
-	objects.reserve(assimp_scene->mNumMeshes);
-	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
-		auto const mesh_start_time = std::chrono::high_resolution_clock::now();
+	return image;
+}
 
-		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
+static GLuint
+uploadTexture2D(std::vector<std::uint8_t> const& data, std::uint32_t width, std::uint32_t height, bool generate_mipmap)
+{
+	GLuint texture = bonobo::createTexture(width, height, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (generate_mipmap)
+		glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0u);
 
-		if (!assimp_object_mesh->HasFaces()) {
-			LogError("Unsupported mesh \"%s\": has no faces", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if ((assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_POINT))    != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_LINE))     != 0u
-		 && (assimp_object_mesh->mPrimitiveTypes & ~static_cast<uint32_t>(aiPrimitiveType_TRIANGLE)) != 0u) {
-			LogError("Unsupported mesh \"%s\": uses multiple primitive types", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if ((assimp_object_mesh->mPrimitiveTypes & static_cast<uint32_t>(aiPrimitiveType_POLYGON)) == static_cast<uint32_t>(aiPrimitiveType_POLYGON)) {
-			LogError("Unsupported mesh \"%s\": uses polygons", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
-		if (!assimp_object_mesh->HasPositions()) {
-			LogError("Unsupported mesh \"%s\": has no positions", assimp_object_mesh->mName.C_Str());
-			continue;
-		}
+	return texture;
+}
 
-		bonobo::mesh_data object;
-		if (assimp_object_mesh->mName.length != 0)
-		{
-			object.name = std::string(assimp_object_mesh->mName.C_Str());
-		}
+static GLuint
+uploadCompressedTexture2D(TextureCache::Texture const& texture)
+{
+	GLuint id = 0u;
+	glGenTextures(1, &id);
+	assert(id != 0u);
+	glBindTexture(GL_TEXTURE_2D, id);
+
+	auto width = static_cast<GLsizei>(texture.width);
+	auto height = static_cast<GLsizei>(texture.height);
+	for (size_t i = 0u; i < texture.levels.size(); ++i) {
+		auto const& level = texture.levels[i];
+		glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), texture.internal_format, width, height, 0,
+		                       static_cast<GLsizei>(level.size()), reinterpret_cast<GLvoid const*>(level.data()));
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
 
-		glGenVertexArrays(1, &object.vao);
-		assert(object.vao != 0u);
-		glBindVertexArray(object.vao);
+	// The whole mipmap chain comes from the cache; nothing to generate.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels.size()) - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0u);
 
-		auto const vertices_offset = 0u;
-		auto const vertices_size = static_cast<GLsizeiptr>(assimp_object_mesh->mNumVertices * sizeof(glm::vec3));
+	return id;
+}
 
-		auto const normals_offset = vertices_size;
-		auto const normals_size = assimp_object_mesh->HasNormals() ? vertices_size : 0u;
+//! \brief Whether the current OpenGL context can sample S3TC/BC textures.
+//!
+//! Must be called from the thread owning the context.
+static bool
+areCompressedTexturesSupported()
+{
+	static bool const is_supported = [](){
+		GLint extensions_nb = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensions_nb);
+		for (GLint i = 0; i < extensions_nb; ++i) {
+			auto const extension = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+			if (extension != nullptr && std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+				return true;
+		}
+		return false;
+	}();
+	return is_supported;
+}
 
-		auto const texcoords_offset = normals_offset + normals_size;
-		auto const texcoords_size = assimp_object_mesh->HasTextureCoords(0u) ? vertices_size : 0u;
+//! \brief Read the compressed version of an image from its cache,
+//!        building and writing that cache first if needed.
+//!
+//! This does not use any OpenGL function and can therefore be called from
+//! any thread.
+//!
+//! @param [in] filename path to the image
+//! @param [in] usage what the image represents
+//! @param [out] texture the compressed texture
+//! @param [out] is_from_cache whether the cache could be used
+//! @param [out] warnings messages about caches which could not be written
+//! @return whether the image could be decoded
+static bool
+getCompressedTexture(std::string const& filename, TextureCache::Usage const usage, TextureCache::Texture& texture,
+                     bool& is_from_cache, std::vector<std::string>& warnings)
+{
+	auto const cache_path = TextureCache::GetPath(filename, usage);
+	auto const source_hash = utils::hash_file(filename);
+	if (source_hash == 0u)
+		return false;
+
+	std::string error;
+	is_from_cache = TextureCache::Read(cache_path, source_hash, usage, texture, error);
+	if (is_from_cache)
+		return true;
+
+	if (!TextureCache::Build(filename, usage, texture, error))
+		return false;
+	if (!TextureCache::Write(cache_path, texture, source_hash, error))
+		warnings.push_back(error);
+
+	return true;
+}
 
-		auto const tangents_offset = texcoords_offset + texcoords_size;
-		auto const tangents_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+namespace
+{
+	//! \brief Image decoded, or read from a cache, by a worker thread,
+	//!        waiting to be uploaded.
+	struct decoded_texture {
+		size_t index{ 0u };
+		std::vector<std::uint8_t> data;
+		std::uint32_t width{ 0u };
+		std::uint32_t height{ 0u };
+		bool is_placeholder{ false };
+		//! \brief Used instead of |data| if |is_compressed| is set.
+		TextureCache::Texture compressed;
+		bool is_compressed{ false };
+		bool is_from_cache{ false };
+		float decoding_time_ms{ 0.0f };
+	};
 
-		auto const binormals_offset = tangents_offset + tangents_size;
-		auto const binormals_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+	//! \brief Size and format of an uploaded texture, as needed to copy it
+	//!        into a texture array.
+	struct uploaded_texture {
+		GLsizei width{ 0 };
+		GLsizei height{ 0 };
+		GLenum internal_format{ 0u };
+		GLsizei levels_nb{ 0 };
+	};
 
-		auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		                                            +normals_size
-		                                            +texcoords_size
-		                                            +tangents_size
-		                                            +binormals_size
-		                                            );
-		glGenBuffers(1, &object.bo);
-		assert(object.bo != 0u);
-		glBindBuffer(GL_ARRAY_BUFFER, object.bo);
-		glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
+	//! \brief Mesh built by a worker thread, or read from a cache, waiting
+	//!        to be uploaded.
+	struct built_mesh {
+		size_t index{ 0u };
+		std::shared_ptr<MeshCache::Mesh const> mesh;
+	};
 
-		glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(assimp_object_mesh->mVertices));
-		glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-		glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+	bonobo::mesh_data uploadMesh(MeshCache::Mesh const& mesh, bonobo::vertex_format_t const format,
+	                             bool const create_position_stream)
+	{
+		bonobo::mesh_data object;
+		object.name = mesh.name;
+		object.vertices_nb = static_cast<GLsizei>(mesh.vertices_nb);
 
-		if (assimp_object_mesh->HasNormals()) {
-			glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(assimp_object_mesh->mNormals));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-		}
+		glGenVertexArrays(1, &object.vao);
+		assert(object.vao != 0u);
+		glBindVertexArray(object.vao);
 
-		if (assimp_object_mesh->HasTextureCoords(0u)) {
-			glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(assimp_object_mesh->mTextureCoords[0u]));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
+		// Attributes are interleaved, in the order of their binding points,
+		// skipping the ones missing from the mesh.
+		bonobo::vertex_attributes_view attributes;
+		attributes.vertices_nb = mesh.vertices_nb;
+		attributes.stride = mesh.vertex_stride;
+		auto attribute = mesh.GetVertexData();
+		auto const next_attribute = [&attribute](){
+			auto const current = attribute;
+			attribute += sizeof(glm::vec3);
+			return current;
+		};
+		attributes.vertices = next_attribute();
+		if (mesh.has_normals)
+			attributes.normals = next_attribute();
+		if (mesh.has_texcoords)
+			attributes.texcoords = next_attribute();
+		if (mesh.has_tangents_and_binormals) {
+			attributes.tangents = next_attribute();
+			attributes.binormals = next_attribute();
 		}
 
-		if (assimp_object_mesh->HasTangentsAndBitangents()) {
-			glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(assimp_object_mesh->mTangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-			glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(assimp_object_mesh->mBitangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
+		if (format == bonobo::vertex_format_t::float32) {
+			// Already in the right format: upload the data as is, which
+			// might come straight from a memory-mapped cache.
+			auto const set_attribute = [&object, &mesh](bonobo::shader_bindings const binding, void const* const data){
+				if (data == nullptr)
+					return;
+				auto& layout = object.layout.attributes[static_cast<size_t>(binding)];
+				layout.components_nb = 3;
+				layout.stride = static_cast<GLsizei>(mesh.vertex_stride);
+				layout.offset = static_cast<size_t>(static_cast<std::uint8_t const*>(data) - mesh.GetVertexData());
+			};
+			set_attribute(bonobo::shader_bindings::vertices, attributes.vertices);
+			set_attribute(bonobo::shader_bindings::normals, attributes.normals);
+			set_attribute(bonobo::shader_bindings::texcoords, attributes.texcoords);
+			set_attribute(bonobo::shader_bindings::tangents, attributes.tangents);
+			set_attribute(bonobo::shader_bindings::binormals, attributes.binormals);
+			object.layout.vertex_size = mesh.vertex_stride;
+			object.bounds = bonobo::computeBounds(attributes.vertices, attributes.stride, attributes.vertices_nb);
+
+			glGenBuffers(1, &object.bo);
+			assert(object.bo != 0u);
+			glBindBuffer(GL_ARRAY_BUFFER, object.bo);
+			glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.GetVertexDataSize()), reinterpret_cast<GLvoid const*>(mesh.GetVertexData()), GL_STATIC_DRAW);
+			bonobo::setupVertexAttributes(object.layout);
+		} else {
+			bonobo::uploadVertices(object, format, attributes);
 		}
 
 		glBindBuffer(GL_ARRAY_BUFFER, 0u);
 
-		auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
-		object.indices_nb = assimp_object_mesh->mNumFaces * num_vertices_per_face;
-		auto object_indices = std::make_unique<GLuint[]>(static_cast<size_t>(object.indices_nb));
-		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
-			auto const& face = assimp_object_mesh->mFaces[i];
-			assert(face.mNumIndices <= 3);
-			object_indices[num_vertices_per_face * i + 0u] = face.mIndices[0u];
-			if (num_vertices_per_face >= 1u)
-				object_indices[num_vertices_per_face * i + 1u] = face.mIndices[1u];
-			if (num_vertices_per_face >= 2u)
-				object_indices[num_vertices_per_face * i + 2u] = face.mIndices[2u];
-		}
+		object.indices_nb = static_cast<GLsizei>(mesh.indices_nb);
 		glGenBuffers(1, &object.ibo);
 		assert(object.ibo != 0u);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<unsigned int>(object.indices_nb) * sizeof(GL_UNSIGNED_INT), reinterpret_cast<GLvoid const*>(object_indices.get()), GL_STATIC_DRAW);
-		object_indices.reset(nullptr);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.indices_nb * sizeof(GLuint)), reinterpret_cast<GLvoid const*>(mesh.GetIndices()), GL_STATIC_DRAW);
 
 		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, object.vao, object.name + " VAO");
 		utils::opengl::debug::nameObject(GL_BUFFER, object.bo, object.name + " VBO");
@@ -302,39 +526,559 @@ bonobo::loadObjects(std::string const& filename)
 		glBindBuffer(GL_ARRAY_BUFFER, 0u);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
 
-		auto const material_id = assimp_object_mesh->mMaterialIndex;
-		if (material_id < materials_bindings.size())
-			object.bindings = materials_bindings[material_id];
-
-		objects.push_back(object);
+		if (create_position_stream)
+			bonobo::uploadPositions(object, attributes.vertices, attributes.stride);
 
-		auto const mesh_end_time = std::chrono::high_resolution_clock::now();
+		return object;
+	}
 
-		std::string attributes = assimp_object_mesh->HasNormals() ? "normals" : "";
+	std::string getAttributesDescription(MeshCache::Mesh const& mesh)
+	{
+		std::string attributes = mesh.has_normals ? "normals" : "";
 		if (!attributes.empty())
 		  attributes += " | ";
-		if (assimp_object_mesh->HasTangentsAndBitangents())
+		if (mesh.has_tangents_and_binormals)
 		  attributes += "tangents&bitangents";
 		if (!attributes.empty())
 		  attributes += " | ";
-		if (assimp_object_mesh->HasTextureCoords(0))
+		if (mesh.has_texcoords)
 		  attributes += "texture coordinates";
-		LogTrivia("│ %s Mesh \"%s\" loaded with attributes [%s] in %.3f ms",
-		          (assimp_scene->mNumMeshes == 1u) ? "╶" : (j == 0 ? "┌" : (j == assimp_scene->mNumMeshes - 1 ? "└" : "├")),
-		          assimp_object_mesh->mName.C_Str(), attributes.c_str(),
-		          std::chrono::duration<float, std::milli>(mesh_end_time - mesh_start_time).count());
+		return attributes;
 	}
-	auto const meshes_end_time = std::chrono::high_resolution_clock::now();
 
-	auto const scene_end_time = std::chrono::high_resolution_clock::now();
-	LogInfo("┕ Scene loaded in %.3f s: %u textures loaded in %.3f s and %zu meshes in %.3f s",
-	        std::chrono::duration<float>(scene_end_time - scene_start_time).count(),
-	        texture_count,
-	        std::chrono::duration<float>(materials_end_time - materials_start_time).count(),
-	        objects.size(),
-	        std::chrono::duration<float>(meshes_end_time - meshes_start_time).count());
+	std::string getVertexCacheDescription(MeshCache::Mesh const& mesh)
+	{
+		if (mesh.vertex_cache_after.acmr == 0.0f)
+			return "not optimised";
+
+		std::array<char, 128> description;
+		std::snprintf(description.data(), description.size(), "ACMR %.3f → %.3f, ATVR %.3f → %.3f",
+		              mesh.vertex_cache_before.acmr, mesh.vertex_cache_after.acmr,
+		              mesh.vertex_cache_before.atvr, mesh.vertex_cache_after.atvr);
+		return description.data();
+	}
+}
 
-	return objects;
+struct bonobo::async_objects_state {
+	~async_objects_state()
+	{
+		is_cancelled = true;
+		if (loader.joinable())
+			loader.join();
+	}
+
+	std::string filename;
+	std::string parent_folder;
+	std::function<void (std::vector<mesh_data> const&)> on_loaded;
+	std::chrono::high_resolution_clock::time_point start_time;
+	bool compress_textures{ false };
+	bool pack_texture_arrays{ false };
+	bool create_position_streams{ false };
+	bonobo::vertex_format_t vertex_format{ bonobo::vertex_format_t::float32 };
+
+	std::thread loader;
+	std::atomic<bool> is_cancelled{ false };
+
+	// Shared between the loader and worker threads, and the thread calling
+	// `async_objects::poll()`.
+	std::mutex mutex;
+	std::condition_variable progress;
+	bool is_imported{ false };
+	bool is_cpu_work_done{ false };
+	bool is_from_cache{ false };
+	std::vector<std::string> texture_paths;
+	std::vector<std::vector<MeshCache::MaterialTexture>> materials_textures;
+	size_t meshes_nb{ 0u };
+	std::vector<std::string> errors;
+	std::vector<std::string> warnings;
+	std::vector<std::string> trivia;
+	std::vector<decoded_texture> decoded_textures;
+	std::vector<built_mesh> built_meshes;
+	float import_time_s{ 0.0f };
+	float workers_time_s{ 0.0f };
+	unsigned int workers_nb{ 0u };
+
+	// Only accessed by the thread calling `async_objects::poll()`.
+	bool are_outputs_allocated{ false };
+	std::vector<GLuint> texture_ids;
+	std::vector<uploaded_texture> uploaded_textures;
+	std::vector<bonobo::mesh_data> objects;
+	std::vector<bool> are_objects_valid;
+	std::vector<std::uint32_t> objects_material_ids;
+	float decoding_time_s{ 0.0f };
+	size_t textures_size{ 0u };
+	size_t textures_uncompressed_size{ 0u };
+	size_t vertex_data_size{ 0u };
+	float building_time_s{ 0.0f };
+	float upload_time_s{ 0.0f };
+	std::promise<std::vector<mesh_data>> promise;
+	std::shared_future<std::vector<mesh_data>> future;
+	bool is_done{ false };
+};
+
+static void
+loadObjectsInBackground(bonobo::async_objects_state& state)
+{
+	auto const report = [&state](std::vector<std::string> const& errors, std::vector<std::string> const& warnings, bool is_cpu_work_done){
+		{
+			std::lock_guard<std::mutex> lock(state.mutex);
+			state.errors.insert(state.errors.end(), errors.begin(), errors.end());
+			state.warnings.insert(state.warnings.end(), warnings.begin(), warnings.end());
+			state.is_cpu_work_done = is_cpu_work_done;
+		}
+		state.progress.notify_all();
+	};
+
+	auto const import_start_time = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::string> errors;
+	std::vector<std::string> warnings;
+
+	// Try the cache first; its meshes are ready to be uploaded as is, and
+	// only its textures remain to be decoded.
+	auto const cache_path = MeshCache::GetPath(state.filename);
+	MeshCache::Scene scene;
+	std::string cache_error;
+	bool const is_from_cache = MeshCache::Read(cache_path, state.filename, scene, cache_error);
+
+	Assimp::Importer importer;
+	aiScene const* assimp_scene = nullptr;
+	if (!is_from_cache) {
+		scene = MeshCache::Scene();
+		std::string import_error;
+		assimp_scene = MeshCache::Import(importer, state.filename, scene.dependencies, import_error);
+		if (assimp_scene == nullptr) {
+			report({ import_error }, {}, true);
+			return;
+		}
+		MeshCache::CollectMaterials(*assimp_scene, scene, errors, warnings);
+		// Material libraries are only known once imported.
+		scene.source_hash = MeshCache::ComputeSourceHash(state.filename, scene.dependencies);
+		scene.meshes.resize(assimp_scene->mNumMeshes);
+	}
+	auto const import_end_time = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::string> texture_paths;
+	texture_paths.reserve(scene.texture_paths.size());
+	for (auto const& texture_path : scene.texture_paths)
+		texture_paths.push_back(state.parent_folder + texture_path);
+
+	auto const textures_nb = texture_paths.size();
+	auto const meshes_nb = scene.meshes.size();
+	auto const jobs_nb = textures_nb + (is_from_cache ? 0u : meshes_nb);
+	auto const workers_nb = static_cast<unsigned int>(std::max<size_t>(1u, std::min<size_t>(std::thread::hardware_concurrency(), jobs_nb)));
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.is_imported = true;
+		state.is_from_cache = is_from_cache;
+		state.texture_paths = texture_paths;
+		state.materials_textures = scene.materials_textures;
+		state.meshes_nb = meshes_nb;
+		state.import_time_s = std::chrono::duration<float>(import_end_time - import_start_time).count();
+		state.workers_nb = workers_nb;
+		if (!is_from_cache && scene.source_hash != 0u)
+			state.trivia.push_back(cache_error);
+		if (is_from_cache) {
+			for (size_t i = 0u; i < meshes_nb; ++i)
+				state.built_meshes.push_back({ i, scene.meshes[i] });
+		}
+	}
+	report(errors, warnings, false);
+
+	// Each job is either decoding one texture, or building one mesh;
+	// workers pick the next job available until none are left.
+	std::vector<std::shared_ptr<MeshCache::Mesh const>> meshes(is_from_cache ? 0u : meshes_nb);
+	std::atomic<size_t> next_job{ 0u };
+	// Normal maps are compressed differently from colours.
+	std::vector<TextureCache::Usage> texture_usages(textures_nb, TextureCache::Usage::colour);
+	for (auto const& material_textures : scene.materials_textures) {
+		for (auto const& texture : material_textures) {
+			if (texture.binding_name == "normals_texture")
+				texture_usages[texture.texture_index] = TextureCache::Usage::normal_map;
+		}
+	}
+
+	auto const run_jobs = [&state, &next_job, &texture_paths, &texture_usages, &meshes, textures_nb, jobs_nb, assimp_scene](){
+		for (auto job = next_job++; job < jobs_nb && !state.is_cancelled; job = next_job++) {
+			if (job < textures_nb) {
+				auto const texture_start_time = std::chrono::high_resolution_clock::now();
+
+				decoded_texture texture;
+				texture.index = job;
+				std::vector<std::string> warnings;
+				if (state.compress_textures)
+					texture.is_compressed = getCompressedTexture(texture_paths[job], texture_usages[job], texture.compressed, texture.is_from_cache, warnings);
+				if (!texture.is_compressed)
+					texture.data = decodeTextureData(texture_paths[job], texture.width, texture.height, true);
+				if (!texture.is_compressed && texture.data.empty()) {
+					texture.data = getPlaceholderTextureData(texture.width, texture.height);
+					texture.is_placeholder = true;
+				}
+
+				auto const texture_end_time = std::chrono::high_resolution_clock::now();
+				texture.decoding_time_ms = std::chrono::duration<float, std::milli>(texture_end_time - texture_start_time).count();
+
+				std::lock_guard<std::mutex> lock(state.mutex);
+				state.decoded_textures.push_back(std::move(texture));
+				state.warnings.insert(state.warnings.end(), warnings.begin(), warnings.end());
+			} else {
+				auto const mesh_index = job - textures_nb;
+				meshes[mesh_index] = std::make_shared<MeshCache::Mesh const>(MeshCache::BuildMesh(*assimp_scene->mMeshes[mesh_index]));
+
+				std::lock_guard<std::mutex> lock(state.mutex);
+				state.built_meshes.push_back({ mesh_index, meshes[mesh_index] });
+			}
+			state.progress.notify_all();
+		}
+	};
+
+	auto const workers_start_time = std::chrono::high_resolution_clock::now();
+	std::vector<std::thread> workers;
+	workers.reserve(workers_nb - 1u);
+	for (unsigned int i = 1u; i < workers_nb; ++i)
+		workers.emplace_back(run_jobs);
+	run_jobs();
+	for (auto& worker : workers)
+		worker.join();
+	auto const workers_end_time = std::chrono::high_resolution_clock::now();
+
+	// Write the cache once all meshes were built, so that the next run can
+	// skip Assimp altogether.
+	if (!is_from_cache && scene.source_hash != 0u && !state.is_cancelled) {
+		scene.meshes = std::move(meshes);
+
+		std::string write_error;
+		if (!MeshCache::Write(cache_path, scene, write_error))
+			report({}, { write_error }, false);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.workers_time_s = std::chrono::duration<float>(workers_end_time - workers_start_time).count();
+	}
+	report({}, {}, true);
+}
+
+//! \brief Copy textures of the same size and format into the layers of
+//!        a shared 2D texture array, mipmaps included.
+//!
+//! So as not to keep each texture twice in VRAM, the individual textures
+//! are then deleted, and replaced in |texture_ids| by 2D views of their
+//! layer, which share the storage of the array. Needs OpenGL 4.3, for
+//! `glTexStorage3D()`, `glCopyImageSubData()` and `glTextureView()`.
+//!
+//! @return the array and layer each texture was copied to; textures which
+//!         failed to upload get a null array
+static std::vector<bonobo::texture_layer>
+packTextureArrays(std::vector<GLuint>& texture_ids, std::vector<uploaded_texture> const& uploaded_textures,
+                  std::vector<std::string> const& texture_paths, size_t& arrays_nb)
+{
+	std::vector<bonobo::texture_layer> layers(texture_ids.size());
+	arrays_nb = 0u;
+
+	using group_key = std::tuple<GLsizei, GLsizei, GLenum, GLsizei>;
+	std::map<group_key, std::vector<size_t>> groups;
+	for (size_t i = 0u; i < texture_ids.size(); ++i) {
+		if (texture_ids[i] == 0u)
+			continue;
+		auto const& texture = uploaded_textures[i];
+		groups[group_key(texture.width, texture.height, texture.internal_format, texture.levels_nb)].push_back(i);
+	}
+
+	GLint max_layers_nb = 256; // OpenGL 3.0 guarantees at least 256.
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers_nb);
+
+	for (auto const& group : groups) {
+		GLsizei width, height, levels_nb;
+		GLenum internal_format;
+		std::tie(width, height, internal_format, levels_nb) = group.first;
+		auto const& indices = group.second;
+
+		// Groups larger than what an array can hold are split.
+		for (size_t first = 0u; first < indices.size(); first += static_cast<size_t>(max_layers_nb)) {
+			auto const layers_nb = std::min(indices.size() - first, static_cast<size_t>(max_layers_nb));
+
+			GLuint array = 0u;
+			glGenTextures(1, &array);
+			assert(array != 0u);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+			glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels_nb, internal_format, width, height, static_cast<GLsizei>(layers_nb));
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0u);
+			utils::opengl::debug::nameObject(GL_TEXTURE, array, "Texture array " + std::to_string(width) + "x" + std::to_string(height)
+			                                                    + " (" + std::to_string(arrays_nb) + ")");
+
+			for (size_t layer = 0u; layer < layers_nb; ++layer) {
+				auto const index = indices[first + layer];
+				auto level_width = width;
+				auto level_height = height;
+				for (GLint level = 0; level < levels_nb; ++level) {
+					glCopyImageSubData(texture_ids[index], GL_TEXTURE_2D, level, 0, 0, 0,
+					                   array, GL_TEXTURE_2D_ARRAY, level, 0, 0, static_cast<GLint>(layer),
+					                   level_width, level_height, 1);
+					level_width = std::max(level_width / 2, 1);
+					level_height = std::max(level_height / 2, 1);
+				}
+				layers[index] = { array, static_cast<GLint>(layer) };
+
+				GLuint view = 0u;
+				glGenTextures(1, &view);
+				assert(view != 0u);
+				glTextureView(view, GL_TEXTURE_2D, array, internal_format, 0u, static_cast<GLuint>(levels_nb), static_cast<GLuint>(layer), 1u);
+				glBindTexture(GL_TEXTURE_2D, view);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glBindTexture(GL_TEXTURE_2D, 0u);
+				utils::opengl::debug::nameObject(GL_TEXTURE, view, texture_paths[index]);
+
+				glDeleteTextures(1, &texture_ids[index]);
+				texture_ids[index] = view;
+			}
+			++arrays_nb;
+		}
+	}
+
+	return layers;
+}
+
+bonobo::async_objects::async_objects(std::shared_ptr<async_objects_state> state) : _state(std::move(state))
+{
+}
+
+bool
+bonobo::async_objects::poll()
+{
+	auto& state = *_state;
+	if (state.is_done)
+		return true;
+
+	std::vector<std::string> errors;
+	std::vector<std::string> warnings;
+	std::vector<std::string> trivia;
+	std::vector<decoded_texture> decoded_textures;
+	std::vector<built_mesh> built_meshes;
+	bool is_cpu_work_done = false;
+	bool is_from_cache = false;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (state.is_imported && !state.are_outputs_allocated) {
+			state.texture_ids.resize(state.texture_paths.size(), 0u);
+			state.uploaded_textures.resize(state.texture_paths.size());
+			state.objects.resize(state.meshes_nb);
+			state.are_objects_valid.resize(state.meshes_nb, false);
+			state.objects_material_ids.resize(state.meshes_nb, 0u);
+			state.are_outputs_allocated = true;
+		}
+		errors.swap(state.errors);
+		warnings.swap(state.warnings);
+		trivia.swap(state.trivia);
+		decoded_textures.swap(state.decoded_textures);
+		built_meshes.swap(state.built_meshes);
+		is_cpu_work_done = state.is_cpu_work_done;
+		is_from_cache = state.is_from_cache;
+	}
+
+	for (auto const& error : errors)
+		LogError("%s", error.c_str());
+	for (auto const& warning : warnings)
+		LogWarning("%s", warning.c_str());
+	for (auto const& message : trivia)
+		LogTrivia("│ %s", message.c_str());
+
+	for (auto const& texture : decoded_textures) {
+		auto const upload_start_time = std::chrono::high_resolution_clock::now();
+
+		auto const& path = state.texture_paths[texture.index];
+		if (texture.is_placeholder)
+			LogWarning("Couldn't load or decode image file %s", path.c_str());
+		auto const id = texture.is_compressed ? uploadCompressedTexture2D(texture.compressed)
+		                                      : uploadTexture2D(texture.data, texture.width, texture.height, true);
+		state.texture_ids[texture.index] = id;
+		utils::opengl::debug::nameObject(GL_TEXTURE, id, path);
+		if (texture.is_compressed) {
+			state.uploaded_textures[texture.index] = { static_cast<GLsizei>(texture.compressed.width), static_cast<GLsizei>(texture.compressed.height),
+			                                           texture.compressed.internal_format, static_cast<GLsizei>(texture.compressed.levels.size()) };
+		} else {
+			// Same number of levels as generated by `glGenerateMipmap()`.
+			auto const largest_side = std::max(texture.width, texture.height);
+			auto levels_nb = 1;
+			while ((largest_side >> levels_nb) > 0u)
+				++levels_nb;
+			state.uploaded_textures[texture.index] = { static_cast<GLsizei>(texture.width), static_cast<GLsizei>(texture.height),
+			                                           GL_RGBA8, levels_nb };
+		}
+
+		auto const upload_end_time = std::chrono::high_resolution_clock::now();
+		auto const upload_time_ms = std::chrono::duration<float, std::milli>(upload_end_time - upload_start_time).count();
+		state.decoding_time_s += texture.decoding_time_ms / 1000.0f;
+		state.upload_time_s += upload_time_ms / 1000.0f;
+		if (texture.is_compressed) {
+			state.textures_size += texture.compressed.GetSize();
+			state.textures_uncompressed_size += TextureCache::GetUncompressedSize(texture.compressed.width, texture.compressed.height);
+		} else {
+			auto const size = TextureCache::GetUncompressedSize(texture.width, texture.height);
+			state.textures_size += size;
+			state.textures_uncompressed_size += size;
+		}
+		LogTrivia("│ ├ Texture \"%s\" %s in %.3f ms and uploaded in %.3f ms",
+		          path.c_str(),
+		          !texture.is_compressed ? "decoded" : texture.is_from_cache ? "read from cache" : "decoded and compressed",
+		          texture.decoding_time_ms, upload_time_ms);
+	}
+
+	for (auto const& built : built_meshes) {
+		auto const& mesh = *built.mesh;
+		if (!mesh.error.empty()) {
+			LogError("%s", mesh.error.c_str());
+			continue;
+		}
+
+		auto const upload_start_time = std::chrono::high_resolution_clock::now();
+
+		state.objects[built.index] = uploadMesh(mesh, state.vertex_format, state.create_position_streams);
+		state.are_objects_valid[built.index] = true;
+		state.objects_material_ids[built.index] = mesh.material_id;
+		state.vertex_data_size += state.objects[built.index].layout.vertex_size * mesh.vertices_nb;
+		if (state.create_position_streams)
+			state.vertex_data_size += sizeof(glm::vec3) * mesh.vertices_nb;
+
+		auto const upload_end_time = std::chrono::high_resolution_clock::now();
+		auto const upload_time_ms = std::chrono::duration<float, std::milli>(upload_end_time - upload_start_time).count();
+		state.building_time_s += mesh.building_time_ms / 1000.0f;
+		state.upload_time_s += upload_time_ms / 1000.0f;
+		if (is_from_cache)
+			LogTrivia("│ ├ Mesh \"%s\" read with attributes [%s] (%s) and uploaded in %.3f ms",
+			          mesh.name.c_str(), getAttributesDescription(mesh).c_str(), getVertexCacheDescription(mesh).c_str(), upload_time_ms);
+		else
+			LogTrivia("│ ├ Mesh \"%s\" built with attributes [%s] (%s) in %.3f ms and uploaded in %.3f ms",
+			          mesh.name.c_str(), getAttributesDescription(mesh).c_str(), getVertexCacheDescription(mesh).c_str(), mesh.building_time_ms, upload_time_ms);
+	}
+
+	if (!is_cpu_work_done)
+		return false;
+
+	std::vector<bonobo::texture_layer> texture_layers;
+	if (state.pack_texture_arrays) {
+		if (GLAD_GL_VERSION_4_3) {
+			auto const packing_start_time = std::chrono::high_resolution_clock::now();
+			size_t arrays_nb = 0u;
+			texture_layers = packTextureArrays(state.texture_ids, state.uploaded_textures, state.texture_paths, arrays_nb);
+			auto const packing_end_time = std::chrono::high_resolution_clock::now();
+			LogTrivia("│ ├ %zu textures moved into %zu texture arrays in %.3f ms",
+			          state.texture_ids.size(), arrays_nb,
+			          std::chrono::duration<float, std::milli>(packing_end_time - packing_start_time).count());
+		} else {
+			LogWarning("Packing textures into texture arrays needs OpenGL 4.3; only individual textures will be available.");
+		}
+	}
+
+	// Textures are only bound to meshes once all of them were uploaded.
+	std::vector<bonobo::mesh_data> objects;
+	objects.reserve(state.objects.size());
+	for (size_t i = 0u; i < state.objects.size(); ++i) {
+		if (!state.are_objects_valid[i])
+			continue;
+
+		auto& object = state.objects[i];
+		auto const material_id = static_cast<size_t>(state.objects_material_ids[i]);
+		if (material_id < state.materials_textures.size()) {
+			for (auto const& texture : state.materials_textures[material_id]) {
+				auto const id = state.texture_ids[texture.texture_index];
+				if (id == 0u) {
+					LogWarning("Failed to load the %s of mesh \"%s\".", texture.binding_name.c_str(), object.name.c_str());
+					continue;
+				}
+				object.bindings.emplace(texture.binding_name, id);
+				if (!texture_layers.empty())
+					object.array_bindings.emplace(texture.binding_name, texture_layers[texture.texture_index]);
+			}
+		}
+		objects.push_back(object);
+	}
+
+	if (state.is_imported) {
+		auto const scene_end_time = std::chrono::high_resolution_clock::now();
+		LogInfo("┕ Scene loaded in %.3f s: %s in %.3f s, %zu textures decoded in %.3f s (%.1f MiB of VRAM, instead of %.1f MiB as RGBA8) and %zu meshes built in %.3f s (%.1f MiB of %s vertex data) by %u threads within %.3f s, and uploaded in %.3f s",
+		        std::chrono::duration<float>(scene_end_time - state.start_time).count(),
+		        is_from_cache ? "cache read" : "imported",
+		        state.import_time_s,
+		        state.texture_ids.size(),
+		        state.decoding_time_s,
+		        static_cast<float>(state.textures_size) / (1024.0f * 1024.0f),
+		        static_cast<float>(state.textures_uncompressed_size) / (1024.0f * 1024.0f),
+		        objects.size(),
+		        state.building_time_s,
+		        static_cast<float>(state.vertex_data_size) / (1024.0f * 1024.0f),
+		        state.vertex_format == vertex_format_t::quantized ? "quantized" : "float",
+		        state.workers_nb,
+		        state.workers_time_s,
+		        state.upload_time_s);
+	}
+
+	state.objects.clear();
+	state.is_done = true;
+	state.promise.set_value(std::move(objects));
+	state.on_loaded(state.future.get());
+
+	return true;
+}
+
+void
+bonobo::async_objects::wait() const
+{
+	auto& state = *_state;
+	std::unique_lock<std::mutex> lock(state.mutex);
+	state.progress.wait(lock, [&state](){
+		return state.is_cpu_work_done
+		    || !state.errors.empty()
+		    || !state.warnings.empty()
+		    || !state.decoded_textures.empty()
+		    || !state.built_meshes.empty();
+	});
+}
+
+std::shared_future<std::vector<bonobo::mesh_data>>
+bonobo::async_objects::get_future() const
+{
+	return _state->future;
+}
+
+bonobo::async_objects
+bonobo::loadObjectsAsync(std::string const& filename, std::function<void (std::vector<mesh_data> const&)> const& on_loaded,
+                         vertex_format_t const format, bool const pack_texture_arrays,
+                         bool const create_position_streams)
+{
+	auto state = std::make_shared<async_objects_state>();
+
+	auto const end_of_basedir = filename.rfind("/");
+	state->filename = filename;
+	state->parent_folder = (end_of_basedir != std::string::npos ? filename.substr(0, end_of_basedir) : ".") + "/";
+	state->on_loaded = on_loaded;
+	state->start_time = std::chrono::high_resolution_clock::now();
+	state->compress_textures = areCompressedTexturesSupported();
+	state->vertex_format = format;
+	state->pack_texture_arrays = pack_texture_arrays;
+	state->create_position_streams = create_position_streams;
+	state->future = state->promise.get_future().share();
+
+	LogInfo("┭ Loading \"%s\"…", filename.c_str());
+
+	state->loader = std::thread(loadObjectsInBackground, std::ref(*state));
+
+	return async_objects(state);
+}
+
+std::vector<bonobo::mesh_data>
+bonobo::loadObjects(std::string const& filename, vertex_format_t const format, bool const pack_texture_arrays,
+                    bool const create_position_streams)
+{
+	auto loading = bonobo::loadObjectsAsync(filename, [](std::vector<mesh_data> const& /*objects*/){}, format, pack_texture_arrays,
+	                                        create_position_streams);
+	while (!loading.poll())
+		loading.wait();
+
+	return loading.get_future().get();
 }
 
 GLuint
@@ -364,22 +1108,27 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 }
 
 GLuint
-bonobo::loadTexture2D(std::string const& filename, bool generate_mipmap)
+bonobo::loadTexture2D(std::string const& filename, bool generate_mipmap, TextureCache::Usage usage)
 {
+	// Compressed textures come with their whole mipmap chain, so only use
+	// them when one is wanted.
+	if (generate_mipmap && areCompressedTexturesSupported()) {
+		TextureCache::Texture texture;
+		bool is_from_cache = false;
+		std::vector<std::string> warnings;
+		auto const is_compressed = getCompressedTexture(filename, usage, texture, is_from_cache, warnings);
+		for (auto const& warning : warnings)
+			LogWarning("%s", warning.c_str());
+		if (is_compressed)
+			return uploadCompressedTexture2D(texture);
+	}
+
 	std::uint32_t width, height;
 	auto const data = getTextureData(filename, width, height, true);
 	if (data.empty())
 		return 0u;
 
-	GLuint texture = bonobo::createTexture(width, height, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	if (generate_mipmap)
-		glGenerateMipmap(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0u);
-
-	return texture;
+	return uploadTexture2D(data, width, height, generate_mipmap);
 }
 
 GLuint
@@ -492,33 +1241,57 @@ bonobo::createProgram(std::string const& vert_shader_source_path, std::string co
 	return program;
 }
 
+namespace local
+{
+	static void
+	displayTexture(glm::vec2 const& lower_left, glm::vec2 const& upper_right, GLenum target, GLuint texture, GLint layer, GLuint sampler, glm::ivec4 const& swizzle, glm::ivec2 const& window_size, bool linearise, float nearPlane, float farPlane)
+	{
+		auto const relative_to_absolute = [](float coord, int size) {
+			return static_cast<GLint>((coord + 1.0f) / 2.0f * size);
+		};
+		auto const viewport_origin = glm::ivec2(relative_to_absolute(lower_left.x, window_size.x),
+		                                        relative_to_absolute(lower_left.y, window_size.y));
+		auto const viewport_size = glm::ivec2(relative_to_absolute(upper_right.x, window_size.x),
+		                                      relative_to_absolute(upper_right.y, window_size.y))
+		                         - viewport_origin;
+
+		// `tex` and `tex_array` are kept on different units, as samplers of
+		// different types may not share one.
+		auto const is_layered = target == GL_TEXTURE_2D_ARRAY;
+		auto const slot = is_layered ? 1u : 0u;
+
+		glViewport(viewport_origin.x, viewport_origin.y, viewport_size.x, viewport_size.y);
+		glUseProgram(fullscreen_shader);
+		glBindVertexArray(display_vao);
+		glActiveTexture(GL_TEXTURE0 + slot);
+		glBindTexture(target, texture);
+		glBindSampler(slot, sampler);
+		glUniform1i(glGetUniformLocation(fullscreen_shader, "tex"), 0);
+		glUniform1i(glGetUniformLocation(fullscreen_shader, "tex_array"), 1);
+		glUniform1i(glGetUniformLocation(fullscreen_shader, "is_layered"), is_layered);
+		glUniform1i(glGetUniformLocation(fullscreen_shader, "layer"), layer);
+		glUniform4iv(glGetUniformLocation(fullscreen_shader, "swizzle"), 1, glm::value_ptr(swizzle));
+		glUniform1i(glGetUniformLocation(fullscreen_shader, "linearise"), linearise);
+		glUniform1f(glGetUniformLocation(fullscreen_shader, "near"), nearPlane);
+		glUniform1f(glGetUniformLocation(fullscreen_shader, "far"), farPlane);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindSampler(slot, 0u);
+		glBindTexture(target, 0);
+		glActiveTexture(GL_TEXTURE0);
+		glUseProgram(0);
+	}
+}
+
 void
 bonobo::displayTexture(glm::vec2 const& lower_left, glm::vec2 const& upper_right, GLuint texture, GLuint sampler, glm::ivec4 const& swizzle, glm::ivec2 const& window_size, bool linearise, float nearPlane, float farPlane)
 {
-	auto const relative_to_absolute = [](float coord, int size) {
-		return static_cast<GLint>((coord + 1.0f) / 2.0f * size);
-	};
-	auto const viewport_origin = glm::ivec2(relative_to_absolute(lower_left.x, window_size.x),
-	                                        relative_to_absolute(lower_left.y, window_size.y));
-	auto const viewport_size = glm::ivec2(relative_to_absolute(upper_right.x, window_size.x),
-	                                      relative_to_absolute(upper_right.y, window_size.y))
-	                         - viewport_origin;
-
-	glViewport(viewport_origin.x, viewport_origin.y, viewport_size.x, viewport_size.y);
-	glUseProgram(local::fullscreen_shader);
-	glBindVertexArray(local::display_vao);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glBindSampler(0, sampler);
-	glUniform1i(glGetUniformLocation(local::fullscreen_shader, "tex"), 0);
-	glUniform4iv(glGetUniformLocation(local::fullscreen_shader, "swizzle"), 1, glm::value_ptr(swizzle));
-	glUniform1i(glGetUniformLocation(local::fullscreen_shader, "linearise"), linearise);
-	glUniform1f(glGetUniformLocation(local::fullscreen_shader, "near"), nearPlane);
-	glUniform1f(glGetUniformLocation(local::fullscreen_shader, "far"), farPlane);
-	glDrawArrays(GL_TRIANGLES, 0, 3);
-	glBindSampler(0, 0u);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glUseProgram(0);
+	local::displayTexture(lower_left, upper_right, GL_TEXTURE_2D, texture, 0, sampler, swizzle, window_size, linearise, nearPlane, farPlane);
+}
+
+void
+bonobo::displayTextureLayer(glm::vec2 const& lower_left, glm::vec2 const& upper_right, GLuint texture, GLint layer, GLuint sampler, glm::ivec4 const& swizzle, glm::ivec2 const& window_size, bool linearise, float nearPlane, float farPlane)
+{
+	local::displayTexture(lower_left, upper_right, GL_TEXTURE_2D_ARRAY, texture, layer, sampler, swizzle, window_size, linearise, nearPlane, farPlane);
 }
 
 GLuint
@@ -5,8 +5,14 @@
 #include <glm/glm.hpp>
 
 #include "core/FPSCamera.h" // As it includes OpenGL headers, import it after glad
+#include "core/frustum.hpp"
+#include "core/TextureCache.hpp"
 
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <future>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -21,23 +27,92 @@ namespace bonobo
 		normals,       //!< = 1, value of the binding point for normals
 		texcoords,     //!< = 2, value of the binding point for texcoords
 		tangents,      //!< = 3, value of the binding point for tangents
-		binormals      //!< = 4, value of the binding point for binormals
+		binormals,     //!< = 4, value of the binding point for binormals
+		instance_model_to_world = 5u,       //!< = 5 to 8, value of the first binding point for per-instance model-to-world matrices
+		instance_normal_model_to_world = 9u, //!< = 9 to 12, value of the first binding point for per-instance normal model-to-world matrices
+		instance_material_layers = 13u       //!< = 13, value of the binding point for the per-instance texture array layers of a material
 	};
 
 	//! \brief Association of a sampler name used in GLSL to a
 	//!        corresponding texture ID.
 	using texture_bindings = std::unordered_map<std::string, GLuint>;
 
+	//! \brief Layer of a 2D texture array holding a texture.
+	struct texture_layer {
+		GLuint array{0u}; //!< OpenGL name of the GL_TEXTURE_2D_ARRAY texture
+		GLint layer{0};   //!< index of the layer within |array|
+	};
+
+	//! \brief Association of a sampler name used in GLSL to the layer of a
+	//!        texture array holding the corresponding texture.
+	using texture_array_bindings = std::unordered_map<std::string, texture_layer>;
+
+	//! \brief Formats in which the vertex attributes of a mesh can be
+	//!        stored.
+	enum class vertex_format_t : unsigned int {
+		float32 = 0u, //!< three floats per attribute
+		quantized     //!< interleaved: float positions, octahedral-encoded
+		              //!< snorm16 normals and tangents, half-float texture
+		              //!< coordinates, and no binormals (see
+		              //!< `vertex_layout::format`)
+	};
+
+	//! \brief How one vertex attribute is stored in a buffer, as given to
+	//!        `glVertexAttribPointer()`.
+	struct vertex_attribute_layout {
+		GLint components_nb{0};            //!< 0 if the attribute is absent
+		GLenum type{GL_FLOAT};
+		GLboolean is_normalized{GL_FALSE};
+		GLsizei stride{0};
+		size_t offset{0u};
+	};
+
+	//! \brief Describes how the vertex attributes of a mesh are stored in
+	//!        its buffer object.
+	struct vertex_layout {
+		//! \brief With `vertex_format_t::quantized`, the normals and
+		//!        tangents given to shaders hold the octahedral encoding of
+		//!        the actual vectors in their first two components, the
+		//!        tangents hold the handedness of the tangent frame in
+		//!        their third component, and the binormals have to be
+		//!        reconstructed from those. `Node` sets the
+		//!        `has_quantized_vertices` uniform accordingly, for
+		//!        shaders to decode them as EDAN35/fill_gbuffer.vert does.
+		vertex_format_t format{vertex_format_t::float32};
+		//! \brief Indexed by `shader_bindings`, from vertices to binormals.
+		std::array<vertex_attribute_layout, 5u> attributes{};
+		size_t vertex_size{0u}; //!< bytes used by each vertex, all attributes included
+	};
+
+	//! \brief Vertex attributes living on the CPU, with three floats per
+	//!        vertex for each attribute; absent attributes are null.
+	struct vertex_attributes_view {
+		size_t vertices_nb{0u};
+		//! \brief Bytes between two consecutive vertices of an attribute,
+		//!        so that both planar and interleaved data can be viewed.
+		size_t stride{sizeof(glm::vec3)};
+		void const* vertices{nullptr};
+		void const* normals{nullptr};
+		void const* texcoords{nullptr};
+		void const* tangents{nullptr};
+		void const* binormals{nullptr};
+	};
+
 	//! \brief Contains the data for a mesh in OpenGL.
 	struct mesh_data {
 		GLuint vao{0u};                          //!< OpenGL name of the Vertex Array Object
 		GLuint bo{0u};                           //!< OpenGL name of the Buffer Object
 		GLuint ibo{0u};                          //!< OpenGL name of the Buffer Object for indices
+		GLuint positions_vao{0u};                //!< Vertex Array Object reading only the positions, from positions_bo, and the indices from ibo; 0 unless requested from the loader
+		GLuint positions_bo{0u};                 //!< Buffer Object with the positions alone, as three tightly packed floats per vertex
 		GLsizei vertices_nb{0};                  //!< number of vertices stored in bo
 		GLsizei indices_nb{0};                   //!< number of indices stored in ibo
 		texture_bindings bindings{};             //!< texture bindings for this mesh
+		texture_array_bindings array_bindings{}; //!< same textures as |bindings|, as layers of texture arrays; empty unless requested from the loader
 		GLenum drawing_mode{GL_TRIANGLES};       //!< OpenGL drawing mode, i.e. GL_TRIANGLES, GL_LINES, etc.
 		std::string name{"un-named mesh"};       //!< Name of the mesh; used for debugging purposes.
+		vertex_layout layout{};                  //!< how the vertex attributes are stored in bo
+		bounding_volume bounds{};                //!< model-space bounds of the vertices, empty if unknown
 	};
 
 	enum class cull_mode_t : unsigned int {
@@ -58,12 +133,128 @@ namespace bonobo
 	//! \brief Deallocate objects allocated by the `init()` function.
 	void deinit();
 
+	//! \brief Store vertex attributes into a single buffer, following a
+	//!        given format.
+	//!
+	//! With `vertex_format_t::float32`, each attribute gets its own region
+	//! of the buffer; with `vertex_format_t::quantized`, attributes are
+	//! interleaved, and tangents are dropped if there are no normals to
+	//! compute the handedness from. This does not use any OpenGL function
+	//! and can therefore be called from any thread.
+	//!
+	//! @param [in] format the format to store the attributes in
+	//! @param [in] attributes the attributes to store
+	//! @param [out] layout where each attribute ended up in the buffer
+	//! @return the content of the buffer
+	std::vector<std::uint8_t> packVertices(vertex_format_t format, vertex_attributes_view const& attributes, vertex_layout& layout);
+
+	//! \brief Enable and describe the attributes of a layout, for the
+	//!        currently bound vertex array object and array buffer.
+	void setupVertexAttributes(vertex_layout const& layout);
+
+	//! \brief Create the buffer object of a mesh, fill it with vertex
+	//!        attributes stored in a given format, and set them up in the
+	//!        vertex array object of the mesh.
+	//!
+	//! @param [in,out] mesh whose `vao` is used, and `bo`, `vertices_nb`,
+	//!                 `layout` and `bounds` are set
+	//! @param [in] format the format to store the attributes in
+	//! @param [in] attributes the attributes to upload
+	void uploadVertices(mesh_data& mesh, vertex_format_t format, vertex_attributes_view const& attributes);
+
+	//! \brief Create a position-only vertex stream for a mesh, for passes
+	//!        which only need positions, such as depth-only ones, to fetch
+	//!        12 bytes per vertex rather than whole vertices.
+	//!
+	//! @param [in,out] mesh whose `ibo`, if any, is shared, and
+	//!                 `positions_vao` and `positions_bo` are set
+	//! @param [in] positions first position, as three floats
+	//! @param [in] positions_stride bytes between two consecutive positions
+	void uploadPositions(mesh_data& mesh, void const* positions, size_t positions_stride);
+
 	//! \brief Load objects found in an object/scene file, using assimp.
 	//!
 	//! @param [in] filename of the object/scene file to load.
+	//! @param [in] format in which to store the vertex attributes
+	//! @param [in] pack_texture_arrays whether to also fill the
+	//!             `array_bindings` of the objects; see
+	//!             `loadObjectsAsync()`
+	//! @param [in] create_position_streams whether to also fill the
+	//!             `positions_vao` and `positions_bo` of the objects
 	//! @return a vector of filled in `mesh_data` structures, one per
 	//!         object found in the input file
-	std::vector<mesh_data> loadObjects(std::string const& filename);
+	std::vector<mesh_data> loadObjects(std::string const& filename,
+	                                   vertex_format_t format = vertex_format_t::float32,
+	                                   bool pack_texture_arrays = false,
+	                                   bool create_position_streams = false);
+
+	struct async_objects_state;
+
+	//! \brief Objects being loaded in the background, as started by
+	//!        `loadObjectsAsync()`.
+	//!
+	//! Images are decoded and vertex and index data are built by a pool of
+	//! worker threads, while all OpenGL objects are created by `poll()`,
+	//! which therefore has to be called from the thread owning the OpenGL
+	//! context.
+	class async_objects
+	{
+	public:
+		explicit async_objects(std::shared_ptr<async_objects_state> state);
+
+		//! \brief Create the OpenGL textures and meshes for all data
+		//!        decoded since the previous call.
+		//!
+		//! Meant to be called once per frame until it returns true.
+		//!
+		//! @return true once all objects have been created, at which
+		//!         point the future from `get_future()` is ready and the
+		//!         callback given to `loadObjectsAsync()` has been called.
+		bool poll();
+
+		//! \brief Block until new data is available to `poll()`, or all
+		//!        worker threads are done.
+		void wait() const;
+
+		//! \brief Retrieve a future of the loaded objects, which becomes
+		//!        ready from within the call to `poll()` which completes
+		//!        the loading.
+		std::shared_future<std::vector<mesh_data>> get_future() const;
+
+	private:
+		std::shared_ptr<async_objects_state> _state;
+	};
+
+	//! \brief Start loading objects found in an object/scene file, using
+	//!        assimp, without blocking the calling thread.
+	//!
+	//! The scene is imported by a background thread, after which its
+	//! textures are decoded and its meshes built by a pool of worker
+	//! threads; see `async_objects` for how to retrieve the result.
+	//!
+	//! @param [in] filename of the object/scene file to load.
+	//! @param [in] on_loaded function called from `async_objects::poll()`
+	//!             with the loaded objects, once all of them are ready.
+	//! @param [in] format in which to store the vertex attributes
+	//! @param [in] pack_texture_arrays whether to also move all textures
+	//!             into 2D texture arrays, one per size and format, and
+	//!             fill the `array_bindings` of the objects accordingly;
+	//!             meshes using textures from the same arrays can then be
+	//!             drawn together, selecting layers per draw. The
+	//!             `bindings` then refer to views of those layers, so that
+	//!             no texture is stored twice. This needs OpenGL 4.3, and
+	//!             is skipped otherwise.
+	//! @param [in] create_position_streams whether to also give each
+	//!             object a position-only vertex stream; see
+	//!             `uploadPositions()`
+	//! @return a handle to poll from the OpenGL thread until the loading
+	//!         is done; the loading is interrupted if the handle is
+	//!         destroyed before then.
+	async_objects loadObjectsAsync(std::string const& filename,
+	                               std::function<void (std::vector<mesh_data> const&)> const& on_loaded = [](std::vector<mesh_data> const& /*objects*/){},
+	                               vertex_format_t format = vertex_format_t::float32,
+	                               bool pack_texture_arrays = false,
+	                               bool create_position_streams = false);
 
 	//! \brief Creates an OpenGL texture without any content nor parameters.
 	//!
@@ -88,9 +279,13 @@ namespace bonobo
 	//!
 	//! @param [in] filename of the image.
 	//! @param [in] generate_mipmap whether or not to generate a mipmap hierarchy
+	//! @param [in] usage what the image represents; normal maps are
+	//!             compressed differently, and only keep their X and Y
+	//!             components once compressed
 	//! @return the name of the OpenGL 2D-texture
 	GLuint loadTexture2D(std::string const& filename,
-	                     bool generate_mipmap = true);
+	                     bool generate_mipmap = true,
+	                     TextureCache::Usage usage = TextureCache::Usage::colour);
 
 	//! \brief Load six images into an OpenGL cubemap-texture.
 	//!
@@ -145,6 +340,21 @@ namespace bonobo
 	                    glm::ivec2 const& window_size, bool linearise = false,
 	                    float nearPlane = 0.0f, float farPlane = 0.0f);
 
+	//! \brief Display one layer of a 2D array texture in the specified
+	//!        rectangle.
+	//!
+	//! @param [in] texture the OpenGL name of the 2D array texture
+	//! @param [in] layer the index of the layer to display
+	//!
+	//! See `displayTexture()` for the other parameters.
+	void displayTextureLayer(glm::vec2 const& lower_left,
+	                         glm::vec2 const& upper_right, GLuint texture,
+	                         GLint layer, GLuint sampler,
+	                         glm::ivec4 const& swizzle,
+	                         glm::ivec2 const& window_size,
+	                         bool linearise = false, float nearPlane = 0.0f,
+	                         float farPlane = 0.0f);
+
 	//! \brief Create an OpenGL FrameBuffer Object using the specified
 	//!        attachments.
 	//!
@@ -0,0 +1,517 @@
+#include "indirect_scene.hpp"
+#include "helpers.hpp"
+
+#include "core/Log.h"
+#include "core/opengl.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+
+constexpr size_t IndirectScene::max_views_nb;
+constexpr size_t IndirectScene::no_commands_set;
+constexpr size_t IndirectScene::invalid_object;
+
+namespace
+{
+	// Work group size of cull_indirect_draws.comp
+	constexpr GLuint cull_group_size = 64u;
+
+	bool
+	is_interleaved(bonobo::vertex_layout const& layout)
+	{
+		if (layout.vertex_size == 0u)
+			return false;
+		return std::all_of(layout.attributes.begin(), layout.attributes.end(),
+		                   [&layout](bonobo::vertex_attribute_layout const& attribute){
+		                   	return attribute.components_nb == 0
+		                   	    || static_cast<size_t>(attribute.stride) == layout.vertex_size;
+		                   });
+	}
+
+	bool
+	are_layouts_equal(bonobo::vertex_layout const& a, bonobo::vertex_layout const& b)
+	{
+		if (a.format != b.format || a.vertex_size != b.vertex_size)
+			return false;
+		for (size_t i = 0u; i < a.attributes.size(); ++i) {
+			auto const& x = a.attributes[i];
+			auto const& y = b.attributes[i];
+			if (x.components_nb != y.components_nb || x.type != y.type || x.is_normalized != y.is_normalized
+			    || x.stride != y.stride || x.offset != y.offset)
+				return false;
+		}
+		return true;
+	}
+}
+
+IndirectScene::~IndirectScene()
+{
+	release();
+}
+
+void
+IndirectScene::release()
+{
+	for (auto& pool : _pools) {
+		glDeleteVertexArrays(1, &pool.vao);
+		glDeleteBuffers(1, &pool.vbo);
+		glDeleteBuffers(1, &pool.ibo);
+	}
+	_pools.clear();
+	_batches.clear();
+	_instances.clear();
+	_object_indices.clear();
+
+	glDeleteBuffers(1, &_objects_bo);
+	_objects_bo = 0u;
+	glDeleteBuffers(1, &_instances_bo);
+	_instances_bo = 0u;
+	glDeleteBuffers(1, &_material_layers_bo);
+	_material_layers_bo = 0u;
+	_materials_nb = 0u;
+	if (!_commands_bos.empty())
+		glDeleteBuffers(static_cast<GLsizei>(_commands_bos.size()), _commands_bos.data());
+	_commands_bos.clear();
+	if (!_occluded_nb_bos.empty())
+		glDeleteBuffers(static_cast<GLsizei>(_occluded_nb_bos.size()), _occluded_nb_bos.data());
+	_occluded_nb_bos.clear();
+}
+
+size_t
+IndirectScene::set_geometry(std::vector<bonobo::mesh_data> const& meshes,
+                            std::vector<glm::mat4> const& transforms,
+                            material_textures const& textures)
+{
+	assert(meshes.size() == transforms.size());
+	release();
+
+	//
+	// Assign each supported mesh to the pool of its vertex layout.
+	//
+	std::vector<bonobo::vertex_layout> pool_layouts;
+	std::vector<size_t> mesh_pools(meshes.size(), invalid_object);
+	size_t skipped_nb = 0u;
+	size_t unlayered_nb = 0u;
+	for (size_t i = 0u; i < meshes.size(); ++i) {
+		auto const& mesh = meshes[i];
+		if (mesh.vao == 0u || mesh.bo == 0u || mesh.ibo == 0u || mesh.drawing_mode != GL_TRIANGLES
+		    || !is_interleaved(mesh.layout)) {
+			++skipped_nb;
+			continue;
+		}
+		bool const are_textures_layered = std::all_of(mesh.bindings.begin(), mesh.bindings.end(),
+		                                              [&mesh](bonobo::texture_bindings::value_type const& binding){
+		                                              	return mesh.array_bindings.find(binding.first) != mesh.array_bindings.end();
+		                                              });
+		if (!are_textures_layered) {
+			++unlayered_nb;
+			continue;
+		}
+
+		auto const pool_it = std::find_if(pool_layouts.begin(), pool_layouts.end(),
+		                                  [&mesh](bonobo::vertex_layout const& layout){
+		                                  	return are_layouts_equal(layout, mesh.layout);
+		                                  });
+		mesh_pools[i] = static_cast<size_t>(pool_it - pool_layouts.begin());
+		if (pool_it == pool_layouts.end())
+			pool_layouts.push_back(mesh.layout);
+	}
+	if (skipped_nb > 0u)
+		LogInfo("%zu meshes out of %zu are not indexed triangles with interleaved vertices, and will not be drawn indirectly.",
+		        skipped_nb, meshes.size());
+	if (unlayered_nb > 0u)
+		LogInfo("%zu meshes out of %zu have textures which were not packed into texture arrays, and will not be drawn indirectly.",
+		        unlayered_nb, meshes.size());
+
+	//
+	// Order the meshes by pool then by texture arrays, so that each batch
+	// is a contiguous range of objects.
+	//
+	using texture_key = std::vector<std::pair<std::string, GLuint>>;
+	std::vector<texture_key> mesh_textures(meshes.size());
+	std::vector<size_t> order;
+	std::set<std::vector<std::tuple<std::string, GLuint, GLint>>> materials;
+	for (size_t i = 0u; i < meshes.size(); ++i) {
+		if (mesh_pools[i] == invalid_object)
+			continue;
+		std::vector<std::tuple<std::string, GLuint, GLint>> material;
+		for (auto const& binding : meshes[i].array_bindings) {
+			mesh_textures[i].emplace_back(binding.first, binding.second.array);
+			material.emplace_back(binding.first, binding.second.array, binding.second.layer);
+		}
+		std::sort(mesh_textures[i].begin(), mesh_textures[i].end());
+		std::sort(material.begin(), material.end());
+		materials.insert(std::move(material));
+		order.push_back(i);
+	}
+	_materials_nb = materials.size();
+	std::stable_sort(order.begin(), order.end(), [&mesh_pools,&mesh_textures](size_t a, size_t b){
+		return std::tie(mesh_pools[a], mesh_textures[a]) < std::tie(mesh_pools[b], mesh_textures[b]);
+	});
+
+	//
+	// Size the shared buffers, and assign each mesh its ranges in them.
+	//
+	std::vector<GLsizeiptr> pool_vertices_sizes(pool_layouts.size(), 0);
+	std::vector<GLsizeiptr> pool_indices_sizes(pool_layouts.size(), 0);
+	std::vector<ObjectData> objects;
+	objects.reserve(order.size());
+	std::vector<glm::ivec4> material_layers;
+	material_layers.reserve(order.size());
+	_instances.reserve(order.size());
+	_object_indices.assign(meshes.size(), invalid_object);
+	for (auto const i : order) {
+		auto const& mesh = meshes[i];
+		auto const pool = mesh_pools[i];
+		auto const vertex_size = static_cast<GLsizeiptr>(pool_layouts[pool].vertex_size);
+
+		ObjectData object;
+		auto const& bounds = mesh.bounds;
+		if (bounds.is_empty()) {
+			// A negative radius tells the culling shader to keep the
+			// object.
+			object.sphere = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+			object.min_corner = glm::vec4(0.0f);
+			object.max_corner = glm::vec4(0.0f);
+		} else {
+			object.sphere = glm::vec4(bounds.sphere_center, bounds.sphere_radius);
+			object.min_corner = glm::vec4(bounds.min_corner, 0.0f);
+			object.max_corner = glm::vec4(bounds.max_corner, 0.0f);
+		}
+		object.indices_nb = static_cast<GLuint>(mesh.indices_nb);
+		object.first_index = static_cast<GLuint>(pool_indices_sizes[pool] / static_cast<GLsizeiptr>(sizeof(GLuint)));
+		object.base_vertex = static_cast<GLint>(pool_vertices_sizes[pool] / vertex_size);
+		object.padding = 0u;
+
+		pool_vertices_sizes[pool] += mesh.vertices_nb * vertex_size;
+		pool_indices_sizes[pool] += mesh.indices_nb * static_cast<GLsizeiptr>(sizeof(GLuint));
+
+		_object_indices[i] = objects.size();
+		objects.push_back(object);
+		_instances.push_back({ transforms[i], glm::transpose(glm::inverse(transforms[i])) });
+
+		glm::ivec4 layers(-1);
+		for (size_t t = 0u; t < textures.size(); ++t) {
+			auto const binding = mesh.array_bindings.find(textures[t]);
+			if (binding != mesh.array_bindings.end())
+				layers[static_cast<glm::length_t>(t)] = binding->second.layer;
+		}
+		material_layers.push_back(layers);
+
+		bool const starts_batch = _batches.empty() || _batches.back().pool != pool
+		                       || mesh_textures[order[_batches.back().first_object]] != mesh_textures[i];
+		if (starts_batch) {
+			Batch batch{ pool, objects.size() - 1u, 0u, {}, "Render " + mesh.name + " (indirect batch)" };
+			for (auto const& texture : mesh_textures[i])
+				batch.textures.push_back({ texture.second, UniformLocation(texture.first), UniformLocation("has_" + texture.first) });
+			_batches.push_back(std::move(batch));
+		}
+		++_batches.back().objects_nb;
+	}
+	if (objects.empty())
+		return 0u;
+
+	//
+	// Per-object data
+	//
+	glGenBuffers(1, &_objects_bo);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _objects_bo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(objects.size() * sizeof(ObjectData)), objects.data(), GL_STATIC_DRAW);
+	utils::opengl::debug::nameObject(GL_BUFFER, _objects_bo, "Indirect scene objects");
+
+	glGenBuffers(1, &_instances_bo);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _instances_bo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(_instances.size() * sizeof(InstanceData)), _instances.data(), GL_DYNAMIC_DRAW);
+	utils::opengl::debug::nameObject(GL_BUFFER, _instances_bo, "Indirect scene transforms");
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+
+	glGenBuffers(1, &_material_layers_bo);
+	glBindBuffer(GL_ARRAY_BUFFER, _material_layers_bo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(material_layers.size() * sizeof(glm::ivec4)), material_layers.data(), GL_STATIC_DRAW);
+	utils::opengl::debug::nameObject(GL_BUFFER, _material_layers_bo, "Indirect scene material layers");
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+	//
+	// Shared vertex and index buffers, filled by copying the buffers of
+	// each mesh on the GPU.
+	//
+	_pools.resize(pool_layouts.size());
+	for (size_t pool = 0u; pool < _pools.size(); ++pool) {
+		auto& shared = _pools[pool];
+		shared.has_quantized_vertices = pool_layouts[pool].format == bonobo::vertex_format_t::quantized;
+
+		glGenBuffers(1, &shared.vbo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, shared.vbo);
+		glBufferData(GL_COPY_WRITE_BUFFER, pool_vertices_sizes[pool], nullptr, GL_STATIC_DRAW);
+		utils::opengl::debug::nameObject(GL_BUFFER, shared.vbo, "Indirect scene vertices " + std::to_string(pool));
+
+		glGenBuffers(1, &shared.ibo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, shared.ibo);
+		glBufferData(GL_COPY_WRITE_BUFFER, pool_indices_sizes[pool], nullptr, GL_STATIC_DRAW);
+		utils::opengl::debug::nameObject(GL_BUFFER, shared.ibo, "Indirect scene indices " + std::to_string(pool));
+	}
+	for (auto const i : order) {
+		auto const& mesh = meshes[i];
+		auto const& object = objects[_object_indices[i]];
+		auto const& shared = _pools[mesh_pools[i]];
+		auto const vertex_size = static_cast<GLsizeiptr>(pool_layouts[mesh_pools[i]].vertex_size);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, mesh.bo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, shared.vbo);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, object.base_vertex * vertex_size,
+		                    mesh.vertices_nb * vertex_size);
+
+		glBindBuffer(GL_COPY_READ_BUFFER, mesh.ibo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, shared.ibo);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+		                    static_cast<GLintptr>(object.first_index * sizeof(GLuint)),
+		                    static_cast<GLsizeiptr>(object.indices_nb * sizeof(GLuint)));
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+
+	//
+	// One vertex array per pool, with the per-object transforms and
+	// texture layers as per-instance attributes.
+	//
+	for (size_t pool = 0u; pool < _pools.size(); ++pool) {
+		auto& shared = _pools[pool];
+		glGenVertexArrays(1, &shared.vao);
+		glBindVertexArray(shared.vao);
+		utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, shared.vao, "Indirect scene VAO " + std::to_string(pool));
+
+		glBindBuffer(GL_ARRAY_BUFFER, shared.vbo);
+		bonobo::setupVertexAttributes(pool_layouts[pool]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shared.ibo);
+
+		// A mat4 attribute takes up four consecutive binding points, one
+		// per column.
+		glBindBuffer(GL_ARRAY_BUFFER, _instances_bo);
+		auto const set_matrix_attribute = [](GLuint const first_binding, std::size_t const offset) {
+			for (GLuint column = 0u; column < 4u; ++column) {
+				glEnableVertexAttribArray(first_binding + column);
+				glVertexAttribPointer(first_binding + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+				                      reinterpret_cast<GLvoid const*>(offset + column * sizeof(glm::vec4)));
+				glVertexAttribDivisor(first_binding + column, 1u);
+			}
+		};
+		set_matrix_attribute(static_cast<GLuint>(bonobo::shader_bindings::instance_model_to_world),
+		                     offsetof(InstanceData, vertex_model_to_world));
+		set_matrix_attribute(static_cast<GLuint>(bonobo::shader_bindings::instance_normal_model_to_world),
+		                     offsetof(InstanceData, normal_model_to_world));
+
+		auto const material_layers_binding = static_cast<GLuint>(bonobo::shader_bindings::instance_material_layers);
+		glBindBuffer(GL_ARRAY_BUFFER, _material_layers_bo);
+		glEnableVertexAttribArray(material_layers_binding);
+		glVertexAttribIPointer(material_layers_binding, 4, GL_INT, sizeof(glm::ivec4), reinterpret_cast<GLvoid const*>(0x0));
+		glVertexAttribDivisor(material_layers_binding, 1u);
+
+		glBindVertexArray(0u);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+
+	LogInfo("Packed %zu meshes with %zu materials into %zu vertex layouts, drawn in %zu batches.",
+	        objects.size(), _materials_nb, _pools.size(), _batches.size());
+
+	return objects.size();
+}
+
+bool
+IndirectScene::is_packed(size_t const mesh_index) const
+{
+	return mesh_index < _object_indices.size() && _object_indices[mesh_index] != invalid_object;
+}
+
+void
+IndirectScene::set_transform(size_t const mesh_index, glm::mat4 const& world)
+{
+	if (!is_packed(mesh_index))
+		return;
+
+	auto const object_index = _object_indices[mesh_index];
+	auto& instance = _instances[object_index];
+	if (instance.vertex_model_to_world == world)
+		return;
+
+	instance = { world, glm::transpose(glm::inverse(world)) };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _instances_bo);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, static_cast<GLintptr>(object_index * sizeof(InstanceData)),
+	                sizeof(InstanceData), &instance);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+}
+
+void
+IndirectScene::cull(GLuint const cull_program, std::vector<glm::mat4> const& world_to_clip_matrices,
+                    size_t const commands_set, occlusion_test const& occlusion)
+{
+	if (_instances.empty() || cull_program == 0u)
+		return;
+
+	if (world_to_clip_matrices.size() > max_views_nb)
+		LogWarning("Culling against %zu views, while at most %zu are supported; the extra ones are ignored.",
+		           world_to_clip_matrices.size(), max_views_nb);
+
+	bool const has_previous_commands = occlusion.drawn_commands_set != no_commands_set;
+	if (has_previous_commands && occlusion.drawn_commands_set >= _commands_bos.size()) {
+		LogError("No draw commands were written for set %zu; culling against it is skipped.", occlusion.drawn_commands_set);
+		return;
+	}
+
+	if (commands_set >= _commands_bos.size()) {
+		auto const previous_size = _commands_bos.size();
+		_commands_bos.resize(commands_set + 1u, 0u);
+		_occluded_nb_bos.resize(commands_set + 1u, 0u);
+		for (size_t i = previous_size; i < _commands_bos.size(); ++i) {
+			glGenBuffers(1, &_commands_bos[i]);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commands_bos[i]);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(_instances.size() * sizeof(DrawElementsIndirectCommand)), nullptr, GL_DYNAMIC_DRAW);
+			utils::opengl::debug::nameObject(GL_BUFFER, _commands_bos[i], "Indirect scene commands " + std::to_string(i));
+
+			glGenBuffers(1, &_occluded_nb_bos[i]);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, _occluded_nb_bos[i]);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+			utils::opengl::debug::nameObject(GL_BUFFER, _occluded_nb_bos[i], "Indirect scene occluded count " + std::to_string(i));
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0u);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+	}
+
+	GLuint const zero = 0u;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _occluded_nb_bos[commands_set]);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+
+	auto const views_nb = std::min(world_to_clip_matrices.size(), max_views_nb);
+	auto const objects_nb = static_cast<GLuint>(_instances.size());
+
+	utils::opengl::debug::beginDebugGroup("Cull indirect draws");
+
+	glUseProgram(cull_program);
+	if (views_nb > 0u)
+		glUniformMatrix4fv(_world_to_clip_location(cull_program), static_cast<GLsizei>(views_nb), GL_FALSE,
+		                   glm::value_ptr(world_to_clip_matrices.front()));
+	glUniform1i(_views_nb_location(cull_program), static_cast<GLint>(views_nb));
+	glUniform1ui(_objects_nb_location(cull_program), objects_nb);
+	glUniform1i(_has_previous_commands_location(cull_program), has_previous_commands ? 1 : 0);
+
+	bool const use_occlusion_culling = occlusion.hiz_texture != 0u;
+	glUniform1i(_use_occlusion_culling_location(cull_program), use_occlusion_culling ? 1 : 0);
+	if (use_occlusion_culling) {
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, occlusion.hiz_texture);
+		glBindSampler(0u, 0u);
+		glUniform1i(_hiz_texture_location(cull_program), 0);
+		glUniformMatrix4fv(_hiz_world_to_clip_location(cull_program), 1, GL_FALSE, glm::value_ptr(occlusion.hiz_world_to_clip));
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0u, _objects_bo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1u, _instances_bo);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2u, _commands_bos[commands_set]);
+	// Always bound, even if unused, as the shader declares it.
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3u, _commands_bos[has_previous_commands ? occlusion.drawn_commands_set : commands_set]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4u, _occluded_nb_bos[commands_set]);
+
+	glDispatchCompute((objects_nb + cull_group_size - 1u) / cull_group_size, 1u, 1u);
+
+	for (GLuint binding = 0u; binding <= 4u; ++binding)
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0u);
+	if (use_occlusion_culling)
+		glBindTexture(GL_TEXTURE_2D, 0u);
+	glUseProgram(0u);
+
+	utils::opengl::debug::endDebugGroup();
+}
+
+void
+IndirectScene::render(glm::mat4 const& view_projection, GLuint const program,
+                      std::function<void (GLuint)> const& set_uniforms, size_t const commands_set) const
+{
+	if (_batches.empty() || program == 0u)
+		return;
+	if (commands_set >= _commands_bos.size()) {
+		LogError("No draw commands were written for set %zu; call `cull()` first.", commands_set);
+		return;
+	}
+
+	glUseProgram(program);
+
+	set_uniforms(program);
+
+	glUniformMatrix4fv(_vertex_world_to_clip_location(program), 1, GL_FALSE, glm::value_ptr(view_projection));
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commands_bos[commands_set]);
+	size_t bound_pool = invalid_object;
+	for (auto const& batch : _batches) {
+		utils::opengl::debug::beginDebugGroup(batch.name);
+
+		auto const& pool = _pools[batch.pool];
+		if (batch.pool != bound_pool) {
+			glBindVertexArray(pool.vao);
+			glUniform1i(_has_quantized_vertices_location(program), pool.has_quantized_vertices ? 1 : 0);
+			bound_pool = batch.pool;
+		}
+
+		for (size_t i = 0u; i < batch.textures.size(); ++i) {
+			auto const& texture = batch.textures[i];
+			glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+			glBindTexture(GL_TEXTURE_2D_ARRAY, texture.array);
+			glUniform1i(texture.sampler_location(program), static_cast<GLint>(i));
+			glUniform1i(texture.presence_location(program), 1);
+		}
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+		                            reinterpret_cast<GLvoid const*>(batch.first_object * sizeof(DrawElementsIndirectCommand)),
+		                            static_cast<GLsizei>(batch.objects_nb), 0);
+
+		for (auto const& texture : batch.textures) {
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+			glUniform1i(texture.sampler_location(program), 0);
+			glUniform1i(texture.presence_location(program), 0);
+		}
+
+		utils::opengl::debug::endDebugGroup();
+	}
+	glBindVertexArray(0u);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0u);
+
+	glUseProgram(0u);
+}
+
+size_t
+IndirectScene::get_objects_nb() const
+{
+	return _instances.size();
+}
+
+size_t
+IndirectScene::get_batches_nb() const
+{
+	return _batches.size();
+}
+
+size_t
+IndirectScene::get_occluded_nb(size_t const commands_set) const
+{
+	if (commands_set >= _occluded_nb_bos.size())
+		return 0u;
+
+	GLuint occluded_nb = 0u;
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _occluded_nb_bos[commands_set]);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &occluded_nb);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0u);
+	return occluded_nb;
+}
+
+size_t
+IndirectScene::get_materials_nb() const
+{
+	return _materials_nb;
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "UniformCache.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	struct mesh_data;
+}
+
+//! \brief Draws many static meshes with a handful of
+//!        `glMultiDrawElementsIndirect()` calls, after culling them on the
+//!        GPU.
+//!
+//! The vertices and indices of all meshes sharing the same vertex layout
+//! are copied into a single vertex buffer and a single index buffer, so
+//! that they can be drawn from one vertex array object. Textures are
+//! taken from the texture arrays filled by the loader (see the
+//! `pack_texture_arrays` argument of `bonobo::loadObjectsAsync()`), and
+//! meshes whose textures come from the same arrays are grouped into a
+//! batch, whatever their material. Each batch is drawn with one indirect
+//! multi-draw, whose commands are written by a compute shader (see
+//! `shaders/common/cull_indirect_draws.comp`) which sets the instance
+//! count of the meshes outside of all given views to 0, as well as that
+//! of the meshes hidden behind a depth pyramid, if one is given.
+//! The CPU therefore never looks at individual meshes once they are
+//! packed, and its cost only depends on the number of batches.
+//!
+//! The model-to-world transforms of the meshes are fed to the vertex
+//! shader as per-instance attributes, starting at the binding points
+//! `bonobo::shader_bindings::instance_model_to_world` and
+//! `bonobo::shader_bindings::instance_normal_model_to_world`, like
+//! `InstancedNode` does: each command draws a single instance, whose
+//! base instance is the index of the mesh. The layers of the textures of
+//! each mesh are fed the same way, as an `ivec4` at the binding point
+//! `bonobo::shader_bindings::instance_material_layers`, with -1 for
+//! missing textures. See `shaders/EDAN35/fill_gbuffer_indirect.vert` and
+//! `shaders/EDAN35/fill_gbuffer_indirect.frag` for an example.
+//!
+//! Only indexed triangle meshes with interleaved vertices, such as those
+//! using `bonobo::vertex_format_t::quantized`, and whose textures all
+//! have a layer in a texture array, can be packed; the others are left
+//! out, and can be drawn separately, e.g. using `Node`.
+//!
+//! This needs OpenGL 4.3, for compute shaders, shader storage buffers and
+//! `glMultiDrawElementsIndirect()`.
+class IndirectScene
+{
+public:
+	//! \brief Maximum number of views meshes can be culled against at
+	//!        once; must match `MAX_VIEWS_NB` in
+	//!        `shaders/common/cull_indirect_draws.comp`.
+	static constexpr size_t max_views_nb = 4u;
+
+	//! \brief Names of the textures whose layers are given to shaders, in
+	//!        the order of the components of the per-instance layers.
+	using material_textures = std::array<std::string, 4u>;
+
+	//! \brief Value of `occlusion_test::drawn_commands_set` when no
+	//!        earlier set is involved.
+	static constexpr size_t no_commands_set = ~size_t(0u);
+
+	//! \brief How `cull()` tests meshes for occlusion, on top of testing
+	//!        them against the views.
+	struct occlusion_test {
+		//! \brief Hierarchical depth buffer, as a mipmapped GL_R32F
+		//!        texture whose texels hold the furthest depth of the
+		//!        texels they cover in the level below; 0 to disable
+		//!        occlusion culling.
+		GLuint hiz_texture{ 0u };
+		//! \brief Transform from world-space to clip-space the depths of
+		//!        |hiz_texture| were rendered with.
+		glm::mat4 hiz_world_to_clip{ 1.0f };
+		//! \brief Set of commands written earlier in the same frame;
+		//!        meshes it draws are skipped, so that a second pass only
+		//!        draws the meshes the first one missed.
+		size_t drawn_commands_set{ no_commands_set };
+	};
+
+	IndirectScene() = default;
+	~IndirectScene();
+
+	IndirectScene(IndirectScene const&) = delete;
+	IndirectScene& operator=(IndirectScene const&) = delete;
+
+	//! \brief Pack the geometry of the meshes into shared buffers.
+	//!
+	//! The data is copied on the GPU, so the buffers of |meshes| can be
+	//! released afterwards. Any previously packed geometry is released.
+	//!
+	//! @param [in] meshes the meshes to pack
+	//! @param [in] transforms the model-to-world transform of each mesh
+	//! @param [in] textures names of the textures whose layers are given
+	//!             to shaders; defaults to those set by the loader
+	//! @return the number of meshes which could be packed
+	size_t set_geometry(std::vector<bonobo::mesh_data> const& meshes,
+	                    std::vector<glm::mat4> const& transforms,
+	                    material_textures const& textures = { { "diffuse_texture", "specular_texture", "normals_texture", "opacity_texture" } });
+
+	//! \brief Whether the mesh at |mesh_index| in the vector given to
+	//!        `set_geometry()` was packed, and is drawn by `render()`.
+	bool is_packed(size_t mesh_index) const;
+
+	//! \brief Update the model-to-world transform of a packed mesh.
+	void set_transform(size_t mesh_index, glm::mat4 const& world);
+
+	//! \brief Write the draw commands of all packed meshes, skipping those
+	//!        outside of all the given views, or occluded.
+	//!
+	//! Commands are kept in |commands_set|, so that the results of
+	//! culling against different views, e.g. the camera and the lights,
+	//! can be used in the same frame. The caller is responsible for
+	//! issuing a `glMemoryBarrier(GL_COMMAND_BARRIER_BIT)` before
+	//! rendering with them.
+	//!
+	//! @param [in] cull_program the program made of
+	//!             `shaders/common/cull_indirect_draws.comp`
+	//! @param [in] world_to_clip_matrices up to `max_views_nb` transforms
+	//!             from world-space to clip-space; if empty, meshes are
+	//!             not tested against any view, only for occlusion
+	//! @param [in] commands_set which set of commands to write
+	//! @param [in] occlusion how to test meshes for occlusion, if at all;
+	//!             reading |occlusion.drawn_commands_set| needs a
+	//!             `glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT)` after
+	//!             it was written
+	void cull(GLuint cull_program, std::vector<glm::mat4> const& world_to_clip_matrices,
+	          size_t commands_set = 0u, occlusion_test const& occlusion = occlusion_test());
+
+	//! \brief Return how many meshes were found occluded by the last call
+	//!        to `cull()` for |commands_set|.
+	//!
+	//! This reads the count back from the GPU, and therefore waits for
+	//! the culling to be done.
+	size_t get_occluded_nb(size_t commands_set = 0u) const;
+
+	//! \brief Draw the packed meshes using the commands written by the
+	//!        last call to `cull()` for |commands_set|.
+	//!
+	//! The texture arrays used by each batch are bound and their
+	//! `has_<name>` uniforms set the same way `Node::render()` does for
+	//! individual textures.
+	//!
+	//! @param [in] view_projection Matrix transforming from world-space to clip-space
+	//! @param [in] program OpenGL shader program to use
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms
+	//! @param [in] commands_set which set of commands to draw with
+	void render(glm::mat4 const& view_projection, GLuint program,
+	            std::function<void (GLuint)> const& set_uniforms = [](GLuint /*programID*/){},
+	            size_t commands_set = 0u) const;
+
+	//! \brief Return the number of meshes which were packed.
+	size_t get_objects_nb() const;
+
+	//! \brief Return the number of batches, i.e. of multi-draws issued
+	//!        by each call to `render()`.
+	size_t get_batches_nb() const;
+
+	//! \brief Return the number of distinct materials among the packed
+	//!        meshes.
+	size_t get_materials_nb() const;
+
+private:
+	// Layouts shared with cull_indirect_draws.comp, following std430.
+	struct ObjectData {
+		glm::vec4 sphere;           //!< model-space center, and radius
+		glm::vec4 min_corner;       //!< model-space box, w unused
+		glm::vec4 max_corner;
+		GLuint indices_nb;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint padding;
+	};
+	struct DrawElementsIndirectCommand {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+	struct InstanceData {
+		glm::mat4 vertex_model_to_world;
+		glm::mat4 normal_model_to_world;
+	};
+
+	// Meshes sharing a vertex layout, and their shared buffers
+	struct Pool {
+		GLuint vao;
+		GLuint vbo;
+		GLuint ibo;
+		bool has_quantized_vertices;
+	};
+
+	struct Texture {
+		GLuint array;
+		UniformLocation sampler_location;
+		UniformLocation presence_location; //!< location of the `has_<name>` uniform
+	};
+
+	// Contiguous range of objects from the same pool, using the same
+	// texture arrays
+	struct Batch {
+		size_t pool;
+		size_t first_object;
+		size_t objects_nb;
+		std::vector<Texture> textures;
+		std::string name;
+	};
+
+	void release();
+
+	std::vector<Pool> _pools;
+	std::vector<Batch> _batches;
+	std::vector<InstanceData> _instances;  //!< one per object
+	std::vector<size_t> _object_indices;   //!< object index of each mesh, or `invalid_object`
+	size_t _materials_nb{ 0u };
+	static constexpr size_t invalid_object = ~size_t(0u);
+
+	GLuint _objects_bo{ 0u };              //!< `ObjectData`, one per object
+	GLuint _instances_bo{ 0u };            //!< `InstanceData`, one per object
+	GLuint _material_layers_bo{ 0u };      //!< `glm::ivec4` of texture layers, one per object
+	std::vector<GLuint> _commands_bos;     //!< `DrawElementsIndirectCommand`, one per object, for each set
+	std::vector<GLuint> _occluded_nb_bos;  //!< a single `GLuint` for each set
+
+	// Uniforms
+	UniformLocation _world_to_clip_location{ "world_to_clip" };
+	UniformLocation _views_nb_location{ "views_nb" };
+	UniformLocation _objects_nb_location{ "objects_nb" };
+	UniformLocation _has_previous_commands_location{ "has_previous_commands" };
+	UniformLocation _use_occlusion_culling_location{ "use_occlusion_culling" };
+	UniformLocation _hiz_texture_location{ "hiz_texture" };
+	UniformLocation _hiz_world_to_clip_location{ "hiz_world_to_clip" };
+	UniformLocation _vertex_world_to_clip_location{ "vertex_world_to_clip" };
+	UniformLocation _has_quantized_vertices_location{ "has_quantized_vertices" };
+};
@@ -0,0 +1,205 @@
+#include "instanced_node.hpp"
+#include "helpers.hpp"
+
+#include "core/Log.h"
+#include "core/opengl.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstddef>
+
+InstancedNode::~InstancedNode()
+{
+	glDeleteBuffers(1, &_instance_bo);
+	_instance_bo = 0u;
+
+	glDeleteVertexArrays(1, &_vao);
+	_vao = 0u;
+}
+
+void
+InstancedNode::render(glm::mat4 const& view_projection) const
+{
+	if (_vao == 0u || _program == nullptr || *_program == 0u || _instances.empty())
+		return;
+
+	utils::opengl::debug::beginDebugGroup(_name);
+
+	if (_are_instances_dirty) {
+		auto const instances_size = _instances.size() * sizeof(InstanceData);
+		glBindBuffer(GL_ARRAY_BUFFER, _instance_bo);
+		if (_instances.size() > _instance_bo_capacity) {
+			glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instances_size), _instances.data(), GL_DYNAMIC_DRAW);
+			_instance_bo_capacity = _instances.size();
+		} else {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(instances_size), _instances.data());
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+		_are_instances_dirty = false;
+	}
+
+	auto const program = *_program;
+	glUseProgram(program);
+
+	_set_uniforms(program);
+
+	glUniformMatrix4fv(_vertex_world_to_clip_location(program), 1, GL_FALSE, glm::value_ptr(view_projection));
+	glUniform1i(_has_quantized_vertices_location(program), _has_quantized_vertices ? 1 : 0);
+
+	_textures.bind(program);
+
+	auto const instances_nb = static_cast<GLsizei>(_instances.size());
+	glBindVertexArray(_vao);
+	if (_has_indices)
+		glDrawElementsInstanced(_drawing_mode, _indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0), instances_nb);
+	else
+		glDrawArraysInstanced(_drawing_mode, 0, _vertices_nb, instances_nb);
+	glBindVertexArray(0u);
+
+	_textures.unbind(program);
+
+	glUseProgram(0u);
+
+	utils::opengl::debug::endDebugGroup();
+}
+
+void
+InstancedNode::set_geometry(bonobo::mesh_data const& shape)
+{
+	if (shape.vao == 0u) {
+		LogError("Geometry \"%s\" has no vertex array object; this operation will be discarded.", shape.name.c_str());
+		return;
+	}
+
+	_vertices_nb = static_cast<GLsizei>(shape.vertices_nb);
+	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
+	_drawing_mode = shape.drawing_mode;
+	_has_indices = shape.ibo != 0u;
+	_has_quantized_vertices = shape.layout.format == bonobo::vertex_format_t::quantized;
+	_name = std::string("Render ") + shape.name + std::string(" (instanced)");
+
+	if (_vao == 0u)
+		glGenVertexArrays(1, &_vao);
+	if (_instance_bo == 0u)
+		glGenBuffers(1, &_instance_bo);
+	utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, _vao, shape.name + " instanced VAO");
+	utils::opengl::debug::nameObject(GL_BUFFER, _instance_bo, shape.name + " instance data");
+
+	// Retrieve the per-vertex attributes set up by whoever created the
+	// shape, so that they can be replicated as is.
+	struct VertexAttribute {
+		GLuint index;
+		GLint size;
+		GLint type;
+		GLint normalized;
+		GLint integer;
+		GLint stride;
+		GLint buffer;
+		GLvoid* pointer;
+	};
+	std::vector<VertexAttribute> vertex_attributes;
+	GLint element_buffer = 0;
+
+	glBindVertexArray(shape.vao);
+	for (GLuint i = 0u; i < static_cast<GLuint>(bonobo::shader_bindings::instance_model_to_world); ++i) {
+		GLint is_enabled = GL_FALSE;
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &is_enabled);
+		if (is_enabled == GL_FALSE)
+			continue;
+
+		VertexAttribute attribute{ i, 0, 0, 0, 0, 0, 0, nullptr };
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &attribute.size);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &attribute.type);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &attribute.normalized);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &attribute.integer);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &attribute.stride);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &attribute.buffer);
+		glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &attribute.pointer);
+		vertex_attributes.push_back(attribute);
+	}
+	glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &element_buffer);
+
+	glBindVertexArray(_vao);
+	for (auto const& attribute : vertex_attributes) {
+		glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(attribute.buffer));
+		glEnableVertexAttribArray(attribute.index);
+		if (attribute.integer != GL_FALSE)
+			glVertexAttribIPointer(attribute.index, attribute.size, static_cast<GLenum>(attribute.type),
+			                       attribute.stride, attribute.pointer);
+		else
+			glVertexAttribPointer(attribute.index, attribute.size, static_cast<GLenum>(attribute.type),
+			                      static_cast<GLboolean>(attribute.normalized), attribute.stride, attribute.pointer);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLuint>(element_buffer));
+
+	// A mat4 attribute takes up four consecutive binding points, one per
+	// column.
+	glBindBuffer(GL_ARRAY_BUFFER, _instance_bo);
+	auto const set_matrix_attribute = [](GLuint const first_binding, std::size_t const offset) {
+		for (GLuint column = 0u; column < 4u; ++column) {
+			glEnableVertexAttribArray(first_binding + column);
+			glVertexAttribPointer(first_binding + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			                      reinterpret_cast<GLvoid const*>(offset + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(first_binding + column, 1u);
+		}
+	};
+	set_matrix_attribute(static_cast<GLuint>(bonobo::shader_bindings::instance_model_to_world),
+	                     offsetof(InstanceData, vertex_model_to_world));
+	set_matrix_attribute(static_cast<GLuint>(bonobo::shader_bindings::instance_normal_model_to_world),
+	                     offsetof(InstanceData, normal_model_to_world));
+
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+	// The buffer will be (re)allocated on the next render.
+	_instance_bo_capacity = 0u;
+	_are_instances_dirty = !_instances.empty();
+
+	_textures.clear();
+	for (auto const& binding : shape.bindings)
+		add_texture(binding.first, binding.second, GL_TEXTURE_2D);
+}
+
+void
+InstancedNode::set_program(GLuint const* const program, std::function<void (GLuint)> const& set_uniforms)
+{
+	if (program == nullptr) {
+		LogError("Program can not be a null pointer; this operation will be discarded.");
+		return;
+	}
+
+	_program = program;
+	_set_uniforms = set_uniforms;
+}
+
+void
+InstancedNode::set_name(std::string const& name)
+{
+	_name = std::string("Render ") + name;
+}
+
+void
+InstancedNode::add_texture(std::string const& name, GLuint tex_id, GLenum type)
+{
+	_textures.add(name, tex_id, type);
+}
+
+void
+InstancedNode::clear_instances()
+{
+	_are_instances_dirty = _are_instances_dirty || !_instances.empty();
+	_instances.clear();
+}
+
+void
+InstancedNode::add_instance(glm::mat4 const& world)
+{
+	_instances.push_back({ world, glm::transpose(glm::inverse(world)) });
+	_are_instances_dirty = true;
+}
+
+size_t
+InstancedNode::get_instances_nb() const
+{
+	return _instances.size();
+}
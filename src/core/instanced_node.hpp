@@ -0,0 +1,123 @@
+#pragma once
+
+#include "TextureBindings.hpp"
+#include "UniformCache.hpp"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	struct mesh_data;
+}
+
+//! \brief Renders many copies of the same mesh, with the same program and
+//!        textures, using a single instanced draw call.
+//!
+//! Each instance only carries its own model-to-world transform; the
+//! matching normal transform is computed when the instance is added. Both
+//! are uploaded to an instance buffer and fed to the vertex shader as
+//! per-instance attributes, starting at the binding points
+//! `bonobo::shader_bindings::instance_model_to_world` and
+//! `bonobo::shader_bindings::instance_normal_model_to_world`; see
+//! `shaders/EDAF80/phong_instanced.vert` for an example.
+class InstancedNode
+{
+public:
+	InstancedNode() = default;
+	~InstancedNode();
+
+	InstancedNode(InstancedNode const&) = delete;
+	InstancedNode& operator=(InstancedNode const&) = delete;
+
+	//! \brief Render all instances of this node.
+	//!
+	//! The instance buffer is only re-uploaded if instances were added or
+	//! removed since the previous call.
+	//!
+	//! @param [in] view_projection Matrix transforming from world-space to clip-space
+	void render(glm::mat4 const& view_projection) const;
+
+	//! \brief Set the geometry shared by all instances.
+	//!
+	//! A vertex array object is created with the same vertex attributes
+	//! as the one from |shape|, extended with the per-instance ones; the
+	//! buffers of |shape| are shared, not copied.
+	//!
+	//! @param [in] shape OpenGL data to use as geometry
+	void set_geometry(bonobo::mesh_data const& shape);
+
+	//! \brief Set the program used by all instances.
+	//!
+	//! @param [in] program pointer to the program OpenGL shader program to
+	//!             use; the pointer should not be null.
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms
+	void set_program(GLuint const* const program,
+	                 std::function<void (GLuint)> const& set_uniforms = [](GLuint /*programID*/){});
+
+	//! \brief Set the name of this node, used for debug groups.
+	//!
+	//! @param [in] name the name used when creating the debug group during
+	//!             rendering; it will automatically be prefixed by "Render ".
+	void set_name(std::string const& name);
+
+	//! \brief Add a texture shared by all instances.
+	//!
+	//! @param [in] name the variable name used by the attached OpenGL
+	//!                  shader program
+	//! @param [in] tex_id the name of an OpenGL texture
+	//! @param [in] type the type of texture, i.e. GL_TEXTURE_2D,
+	//!                  GL_TEXTURE_CUBE_MAP, etc.
+	void add_texture(std::string const& name, GLuint tex_id, GLenum type);
+
+	//! \brief Remove all instances.
+	void clear_instances();
+
+	//! \brief Add an instance.
+	//!
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space for that instance
+	void add_instance(glm::mat4 const& world);
+
+	//! \brief Return the number of instances currently added.
+	size_t get_instances_nb() const;
+
+private:
+	struct InstanceData {
+		glm::mat4 vertex_model_to_world;
+		glm::mat4 normal_model_to_world;
+	};
+
+	// Geometry data
+	GLuint _vao{ 0u };
+	GLsizei _vertices_nb{ 0u };
+	GLsizei _indices_nb{ 0u };
+	GLenum _drawing_mode{ GL_TRIANGLES };
+	bool _has_indices{ false };
+	bool _has_quantized_vertices{ false };
+
+	// Instance data
+	GLuint _instance_bo{ 0u };
+	std::vector<InstanceData> _instances;
+	mutable size_t _instance_bo_capacity{ 0u };
+	mutable bool _are_instances_dirty{ false };
+
+	// Program data
+	GLuint const* _program{ nullptr };
+	std::function<void (GLuint)> _set_uniforms;
+	UniformLocation _vertex_world_to_clip_location{ "vertex_world_to_clip" };
+	UniformLocation _has_quantized_vertices_location{ "has_quantized_vertices" };
+
+	// Textures data
+	TextureBindings _textures;
+
+	// Debug data
+	std::string _name{"Render un-named instanced node"};
+};
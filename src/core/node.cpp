@@ -28,19 +28,15 @@ Node::render(glm::mat4 const& view_projection, glm::mat4 const& world, GLuint pr
 
 	set_uniforms(program);
 
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "normal_model_to_world"), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(view_projection));
-
-	for (size_t i = 0u; i < _textures.size(); ++i) {
-		auto const& texture = _textures[i];
-		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
-		glBindTexture(std::get<2>(texture), std::get<1>(texture));
-		glUniform1i(glGetUniformLocation(program, std::get<0>(texture).c_str()), static_cast<GLint>(i));
-
-		std::string texture_presence_var_name = "has_" + std::get<0>(texture);
-		glUniform1i(glGetUniformLocation(program, texture_presence_var_name.c_str()), 1);
-	}
+	glUniformMatrix4fv(_vertex_model_to_world_location(program), 1, GL_FALSE, glm::value_ptr(world));
+	glUniformMatrix4fv(_normal_model_to_world_location(program), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+	// Programs including "common/shared_uniforms.glsl" read it from their
+	// "ViewData" block instead, and have no such uniform: the upload is
+	// then ignored, as for any location of -1.
+	glUniformMatrix4fv(_vertex_world_to_clip_location(program), 1, GL_FALSE, glm::value_ptr(view_projection));
+	glUniform1i(_has_quantized_vertices_location(program), _has_quantized_vertices ? 1 : 0);
+
+	_textures.bind(program);
 
 	glBindVertexArray(_vao);
 	if (_has_indices)
@@ -49,27 +45,42 @@ Node::render(glm::mat4 const& view_projection, glm::mat4 const& world, GLuint pr
 		glDrawArrays(_drawing_mode, 0, _vertices_nb);
 	glBindVertexArray(0u);
 
-	for (auto const& texture : _textures) {
-		glBindTexture(std::get<2>(texture), 0);
-		glUniform1i(glGetUniformLocation(program, std::get<0>(texture).c_str()), 0);
-
-		std::string texture_presence_var_name = "has_" + std::get<0>(texture);
-		glUniform1i(glGetUniformLocation(program, texture_presence_var_name.c_str()), 0);
-	}
+	_textures.unbind(program);
 
 	glUseProgram(0u);
 
 	utils::opengl::debug::endDebugGroup();
 }
 
+void
+Node::render_depth(glm::mat4 const& view_projection, glm::mat4 const& world, GLuint program) const
+{
+	auto const vao = _positions_vao != 0u ? _positions_vao : _vao;
+	if (vao == 0u || program == 0u)
+		return;
+
+	glUniformMatrix4fv(_vertex_model_to_world_location(program), 1, GL_FALSE, glm::value_ptr(world));
+	glUniformMatrix4fv(_vertex_world_to_clip_location(program), 1, GL_FALSE, glm::value_ptr(view_projection));
+
+	glBindVertexArray(vao);
+	if (_has_indices)
+		glDrawElements(_drawing_mode, _indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
+	else
+		glDrawArrays(_drawing_mode, 0, _vertices_nb);
+	glBindVertexArray(0u);
+}
+
 void
 Node::set_geometry(bonobo::mesh_data const& shape)
 {
 	_vao = shape.vao;
+	_positions_vao = shape.positions_vao;
 	_vertices_nb = static_cast<GLsizei>(shape.vertices_nb);
 	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
 	_drawing_mode = shape.drawing_mode;
 	_has_indices = shape.ibo != 0u;
+	_has_quantized_vertices = shape.layout.format == bonobo::vertex_format_t::quantized;
+	_bounds = shape.bounds;
 	_name = std::string("Render ") + shape.name;
 
 	if (!shape.bindings.empty()) {
@@ -111,24 +122,13 @@ Node::set_indices_nb(size_t const& indices_nb)
 void
 Node::add_texture(std::string const& name, GLuint tex_id, GLenum type)
 {
-	GLint max_combined_texture_image_units{-1};
-	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_combined_texture_image_units);
-	std::size_t const max_active_texture_count
-		= (max_combined_texture_image_units > 0) ? static_cast<std::size_t>(max_combined_texture_image_units)
-		                                         : 80; // OpenGL 4.x guarantees at least 80.
-
-	if (_textures.size() >= max_active_texture_count) {
-		LogWarning("Trying to add more textures to an object than supported (%llu); the texture %s with ID %u will **not** be added. If you really need that many textures, do not use the `Node` class and roll your own solution instead.",
-		           max_active_texture_count, name.c_str(), tex_id);
-		return;
-	}
-	if (tex_id == 0u) {
-		LogWarning("0 is not a valid texture ID; the texture %s (with ID %u) will **not** be added.",
-		           name.c_str(), tex_id);
-		return;
-	}
+	_textures.add(name, tex_id, type);
+}
 
-	_textures.emplace_back(name, tex_id, type);
+bool
+Node::has_texture(std::string const& name) const
+{
+	return _textures.has(name);
 }
 
 void
@@ -166,3 +166,21 @@ Node::get_transform()
 {
 	return _transform;
 }
+
+bonobo::bounding_volume const&
+Node::get_bounds() const
+{
+	return _bounds;
+}
+
+bonobo::bounding_volume
+Node::get_world_bounds(glm::mat4 const& parent_transform) const
+{
+	auto const world = parent_transform * _transform.GetMatrix();
+
+	auto bounds = bonobo::transformBounds(_bounds, world);
+	for (auto const child : _children)
+		bounds = bonobo::mergeBounds(bounds, child->get_world_bounds(world));
+
+	return bounds;
+}
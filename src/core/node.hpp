@@ -1,6 +1,9 @@
 #pragma once
 
+#include "frustum.hpp"
 #include "TRSTransform.h"
+#include "TextureBindings.hpp"
+#include "UniformCache.hpp"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -8,7 +11,6 @@
 
 #include <functional>
 #include <string>
-#include <tuple>
 #include <vector>
 
 namespace bonobo
@@ -45,6 +47,23 @@ public:
 	            GLuint program,
 	            std::function<void (GLuint)> const& set_uniforms = [](GLuint /*programID*/){}) const;
 
+	//! \brief Render the positions of this node alone, for depth-only
+	//!        passes.
+	//!
+	//! Unlike `render()`, this neither binds textures nor sets any uniform
+	//! but the transforms, and uses the position-only vertex stream of the
+	//! geometry if it has one (see `bonobo::mesh_data::positions_vao`), so
+	//! it is only suited to opaque geometry: see `has_texture()` to tell
+	//! alpha-tested geometry apart. The program is not bound either, so
+	//! that it can be bound once for many nodes.
+	//!
+	//! @param [in] view_projection Matrix transforming from world-space to clip-space
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space
+	//! @param [in] program OpenGL shader program currently in use
+	void render_depth(glm::mat4 const& view_projection, glm::mat4 const& world,
+	                  GLuint program) const;
+
 	//! \brief Set the geometry of this node.
 	//!
 	//! A node without any geometry will not render itself, but its
@@ -96,6 +115,10 @@ public:
 	//!                  GL_TEXTURE_CUBE_MAP, etc.
 	void add_texture(std::string const& name, GLuint tex_id, GLenum type);
 
+	//! \brief Return whether a texture was added to this node under a
+	//!        given name, e.g. `opacity_texture`.
+	bool has_texture(std::string const& name) const;
+
 	//! \brief Add a child to this node.
 	//!
 	//! @param [in] child pointer to the child to add; the pointer has to
@@ -121,20 +144,48 @@ public:
 	TRSTransformf const& get_transform() const;
 	TRSTransformf& get_transform();
 
+	//! \brief Return the bounds of this node's geometry, in model-space.
+	//!
+	//! @return the bounds given by `set_geometry()`, or an empty volume
+	//!         if the node has no geometry
+	bonobo::bounding_volume const& get_bounds() const;
+
+	//! \brief Return the bounds of this node and all of its descendants,
+	//!        in world-space.
+	//!
+	//! @param [in] parent_transform Matrix transforming from parent-space
+	//!             to world-space
+	//! @return a volume enclosing the world-space bounds of the geometry
+	//!         of this node and of all its descendants
+	bonobo::bounding_volume get_world_bounds(glm::mat4 const& parent_transform = glm::mat4(1.0f)) const;
+
 private:
+	// The render queue reads the geometry, program and texture data
+	// directly, to sort and batch draws without going through `render()`.
+	friend class RenderQueue;
+
 	// Geometry data
 	GLuint _vao{ 0u };
+	GLuint _positions_vao{ 0u };
 	GLsizei _vertices_nb{ 0u };
 	GLsizei _indices_nb{ 0u };
 	GLenum _drawing_mode{ GL_TRIANGLES };
 	bool _has_indices{ false };
+	bool _has_quantized_vertices{ false };
+	bonobo::bounding_volume _bounds;
 
 	// Program data
 	GLuint const* _program{ nullptr };
 	std::function<void (GLuint)> _set_uniforms;
 
 	// Textures data
-	std::vector<std::tuple<std::string, GLuint, GLenum>> _textures;
+	TextureBindings _textures;
+
+	// Uniform locations, resolved once per program
+	UniformLocation _vertex_model_to_world_location{ "vertex_model_to_world" };
+	UniformLocation _normal_model_to_world_location{ "normal_model_to_world" };
+	UniformLocation _vertex_world_to_clip_location{ "vertex_world_to_clip" };
+	UniformLocation _has_quantized_vertices_location{ "has_quantized_vertices" };
 
 	// Transformation data
 	TRSTransformf _transform;
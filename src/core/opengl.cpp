@@ -180,6 +180,12 @@ source_and_build_shader(GLuint id, std::string const& source)
 	glShaderSource(id, 1, &char_source, NULL);
 
 	glCompileShader(id);
+	return check_shader_compilation(id);
+}
+
+bool
+check_shader_compilation(GLuint id)
+{
 	GLint state = GLint(0);
 	glGetShaderiv(id, GL_COMPILE_STATUS, &state);
 	auto const wasCompilationSuccessful = state != GL_FALSE;
@@ -226,6 +232,12 @@ bool
 link_program(GLuint id)
 {
 	glLinkProgram(id);
+	return check_program_linking(id);
+}
+
+bool
+check_program_linking(GLuint id)
+{
 	GLint state = GLint(0);
 	glGetProgramiv(id, GL_LINK_STATUS, &state);
 	auto const wasLinkingSuccessful = state != GL_FALSE;
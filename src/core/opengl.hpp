@@ -67,8 +67,10 @@ namespace shader
 {
 
 bool source_and_build_shader(GLuint id, std::string const& source);
+bool check_shader_compilation(GLuint id);
 GLuint generate_shader(GLenum type, std::string const& source);
 bool link_program(GLuint id);
+bool check_program_linking(GLuint id);
 void reload_program(GLuint id, std::vector<GLuint> const& ids, std::vector<std::string> const& sources);
 GLuint generate_program(std::vector<GLuint> const& shaders_id);
 
@@ -0,0 +1,192 @@
+#include "render_queue.hpp"
+
+#include "node.hpp"
+
+#include "core/Log.h"
+#include "core/opengl.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+void
+RenderQueue::add(Node const& node, glm::mat4 const& parent_transform)
+{
+	auto const world = parent_transform * node._transform.GetMatrix();
+
+	if (node._vao != 0u && node._program != nullptr && *node._program != 0u)
+		_items.push_back({ 0u, &node, *node._program, get_texture_set_id(node), world,
+		                   bonobo::transformBounds(node._bounds, world) });
+
+	for (auto const child : node._children)
+		add(*child, world);
+}
+
+void
+RenderQueue::flush(glm::mat4 const& view_projection)
+{
+	_stats = Stats();
+
+	Frustum const frustum(view_projection);
+	auto const first_culled = std::partition(_items.begin(), _items.end(),
+	                                         [&frustum](DrawItem const& item){ return frustum.intersects(item.world_bounds); });
+	_stats.culled_nb = static_cast<size_t>(std::distance(first_culled, _items.end()));
+	_items.erase(first_culled, _items.end());
+
+	// Depths are positive, so the bits of their IEEE 754 representation
+	// sort in the same order as their values; keeping the upper 16 bits
+	// (sign, exponent and 7 bits of mantissa) is plenty to sort
+	// front-to-back within a batch.
+	for (auto& item : _items) {
+		auto const depth = std::max((view_projection * item.world[3]).w, 0.0f);
+		std::uint32_t depth_bits = 0u;
+		std::memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+		// Program and VAO names, and texture set IDs, are truncated to 16
+		// bits: a collision only makes the sorting less effective, as binds
+		// are elided by comparing the full values.
+		item.key = (static_cast<std::uint64_t>(item.program & 0xffffu) << 48)
+		         | (static_cast<std::uint64_t>(item.texture_set_id & 0xffffu) << 32)
+		         | (static_cast<std::uint64_t>(item.node->_vao & 0xffffu) << 16)
+		         | static_cast<std::uint64_t>(depth_bits >> 16);
+	}
+	std::stable_sort(_items.begin(), _items.end(),
+	                 [](DrawItem const& a, DrawItem const& b){ return a.key < b.key; });
+
+	GLuint current_program = 0u;
+	GLuint current_vao = 0u;
+	Node const* current_textures_node = nullptr;
+	std::uint32_t current_texture_set_id = 0u;
+
+	// Mirror what `Node::render()` does after drawing, but only once a
+	// texture set is no longer used with the current program.
+	auto const reset_texture_uniforms = [&current_program, &current_textures_node](){
+		if (current_textures_node == nullptr)
+			return;
+		current_textures_node->_textures.set_uniforms(current_program, false);
+		current_textures_node = nullptr;
+	};
+
+	size_t naive_texture_binds_nb = 0u;
+	for (auto const& item : _items) {
+		auto const& node = *item.node;
+		auto const program = item.program;
+
+		utils::opengl::debug::beginDebugGroup(node._name);
+
+		if (program != current_program) {
+			reset_texture_uniforms();
+			glUseProgram(program);
+			++_stats.program_binds_nb;
+			current_program = program;
+		}
+
+		node._set_uniforms(program);
+
+		auto const normal_model_to_world = glm::transpose(glm::inverse(item.world));
+		glUniformMatrix4fv(node._vertex_model_to_world_location(program), 1, GL_FALSE, glm::value_ptr(item.world));
+		glUniformMatrix4fv(node._normal_model_to_world_location(program), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+		glUniformMatrix4fv(node._vertex_world_to_clip_location(program), 1, GL_FALSE, glm::value_ptr(view_projection));
+		glUniform1i(node._has_quantized_vertices_location(program), node._has_quantized_vertices ? 1 : 0);
+
+		if (current_textures_node == nullptr || item.texture_set_id != current_texture_set_id) {
+			reset_texture_uniforms();
+			auto const& textures = node._textures.get();
+			for (size_t i = 0u; i < textures.size(); ++i)
+				bind_texture(static_cast<GLenum>(i), textures[i].type, textures[i].id);
+			node._textures.set_uniforms(program, true);
+			current_textures_node = &node;
+			current_texture_set_id = item.texture_set_id;
+		}
+		naive_texture_binds_nb += 2u * node._textures.get().size();
+
+		if (node._vao != current_vao) {
+			glBindVertexArray(node._vao);
+			++_stats.vao_binds_nb;
+			current_vao = node._vao;
+		}
+
+		if (node._has_indices)
+			glDrawElements(node._drawing_mode, node._indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
+		else
+			glDrawArrays(node._drawing_mode, 0, node._vertices_nb);
+		++_stats.draws_nb;
+
+		utils::opengl::debug::endDebugGroup();
+	}
+
+	reset_texture_uniforms();
+	if (current_vao != 0u) {
+		glBindVertexArray(0u);
+		++_stats.vao_binds_nb;
+	}
+	for (size_t i = 0u; i < _bound_textures.size(); ++i)
+		bind_texture(static_cast<GLenum>(i), _bound_textures[i].first, 0u);
+	_bound_textures.clear();
+	if (current_program != 0u) {
+		glUseProgram(0u);
+		++_stats.program_binds_nb;
+	}
+
+	// `Node::render()` binds and unbinds the program, the VAO and every
+	// texture for each draw.
+	auto const naive_binds_nb = 2u * _stats.draws_nb;
+	_stats.program_binds_saved_nb = naive_binds_nb - std::min(naive_binds_nb, _stats.program_binds_nb);
+	_stats.vao_binds_saved_nb = naive_binds_nb - std::min(naive_binds_nb, _stats.vao_binds_nb);
+	_stats.texture_binds_saved_nb = naive_texture_binds_nb - std::min(naive_texture_binds_nb, _stats.texture_binds_nb);
+
+	_items.clear();
+}
+
+void
+RenderQueue::clear()
+{
+	_items.clear();
+}
+
+RenderQueue::Stats const&
+RenderQueue::get_stats() const
+{
+	return _stats;
+}
+
+std::uint32_t
+RenderQueue::get_texture_set_id(Node const& node)
+{
+	TextureSet texture_set;
+	texture_set.reserve(node._textures.get().size());
+	for (auto const& texture : node._textures.get())
+		texture_set.emplace_back(texture.sampler_location.GetName(), texture.type, texture.id);
+
+	auto const texture_set_it = _texture_set_ids.find(texture_set);
+	if (texture_set_it != _texture_set_ids.end())
+		return texture_set_it->second;
+
+	// IDs have to stay unique, as `flush()` only rebinds textures when the
+	// ID changes.
+	auto const id = static_cast<std::uint32_t>(_texture_set_ids.size());
+	_texture_set_ids.emplace(std::move(texture_set), id);
+	return id;
+}
+
+void
+RenderQueue::bind_texture(GLenum const unit, GLenum const type, GLuint const id)
+{
+	if (_bound_textures.size() <= unit)
+		_bound_textures.resize(unit + 1u, std::make_pair(GL_TEXTURE_2D, 0u));
+
+	auto& bound_texture = _bound_textures[unit];
+	if (bound_texture.first == type && bound_texture.second == id)
+		return;
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	if (bound_texture.first != type && bound_texture.second != 0u) {
+		glBindTexture(bound_texture.first, 0u);
+		++_stats.texture_binds_nb;
+	}
+	glBindTexture(type, id);
+	++_stats.texture_binds_nb;
+	bound_texture = std::make_pair(type, id);
+}
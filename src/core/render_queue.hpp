@@ -0,0 +1,90 @@
+#pragma once
+
+#include "frustum.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+class Node;
+
+//! \brief Collects the draws of a frame, sorts them to minimise OpenGL
+//!        state changes, and submits them while skipping redundant binds.
+//!
+//! Draws whose world-space bounds lie outside the view frustum are
+//! dropped before anything else. The remaining ones are sorted by a
+//! 64-bit key made of, from most to least
+//! significant, the shader program, the set of textures, the vertex array
+//! object, and the view depth (front-to-back). When submitting, programs,
+//! textures and vertex arrays are only bound when they differ from what
+//! the previous draw used, and are only unbound once all draws are done.
+//!
+//! Typical usage, once per frame:
+//!
+//!     queue.clear();
+//!     queue.add(scene_root);
+//!     queue.flush(camera.GetWorldToClipMatrix());
+class RenderQueue
+{
+public:
+	//! \brief Number of draws and binds issued during the last flush,
+	//!        compared to calling `Node::render()` on every node.
+	struct Stats {
+		size_t draws_nb{ 0u };
+		size_t culled_nb{ 0u };          //!< draws skipped by frustum culling
+		size_t program_binds_nb{ 0u };
+		size_t program_binds_saved_nb{ 0u };
+		size_t texture_binds_nb{ 0u };
+		size_t texture_binds_saved_nb{ 0u };
+		size_t vao_binds_nb{ 0u };
+		size_t vao_binds_saved_nb{ 0u };
+	};
+
+	//! \brief Add a node and all of its descendants to the queue.
+	//!
+	//! Nodes without geometry or without program are only traversed.
+	//!
+	//! @param [in] node the root of the hierarchy to add
+	//! @param [in] parent_transform Matrix transforming from parent-space
+	//!             to world-space
+	void add(Node const& node, glm::mat4 const& parent_transform = glm::mat4(1.0f));
+
+	//! \brief Sort and render all queued draws, then empty the queue.
+	//!
+	//! @param [in] view_projection Matrix transforming from world-space to clip-space
+	void flush(glm::mat4 const& view_projection);
+
+	//! \brief Remove all queued draws without rendering them.
+	void clear();
+
+	//! \brief Retrieve the statistics of the last call to `flush()`.
+	Stats const& get_stats() const;
+
+private:
+	struct DrawItem {
+		std::uint64_t key;
+		Node const* node;
+		GLuint program;
+		std::uint32_t texture_set_id;
+		glm::mat4 world;
+		bonobo::bounding_volume world_bounds;
+	};
+
+	// A texture set is identified by the sampler name, target and name of
+	// each of its textures, in texture unit order.
+	using TextureSet = std::vector<std::tuple<std::string, GLenum, GLuint>>;
+
+	std::uint32_t get_texture_set_id(Node const& node);
+	void bind_texture(GLenum unit, GLenum type, GLuint id);
+
+	std::vector<DrawItem> _items;
+	std::vector<std::pair<GLenum, GLuint>> _bound_textures;
+	std::map<TextureSet, std::uint32_t> _texture_set_ids;
+	Stats _stats;
+};
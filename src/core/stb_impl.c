@@ -1,3 +1,6 @@
 #define STBI_WINDOWS_UTF8
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
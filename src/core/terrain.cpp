@@ -0,0 +1,362 @@
+#include "terrain.hpp"
+#include "helpers.hpp"
+
+#include "core/frustum.hpp"
+#include "core/Log.h"
+#include "core/MeshOptimizer.hpp"
+#include "core/opengl.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	//! \brief Hash the global grid coordinates of a vertex into a value in
+	//!        [0, 1].
+	float hashVertex(std::uint32_t const i, std::uint32_t const j, std::uint32_t const seed)
+	{
+		auto hash = seed ^ (i * 0x9e3779b1u) ^ (j * 0x85ebca77u);
+		hash ^= hash >> 16;
+		hash *= 0x7feb352du;
+		hash ^= hash >> 15;
+		hash *= 0x846ca68bu;
+		hash ^= hash >> 16;
+		return static_cast<float>(hash) / static_cast<float>(0xffffffffu);
+	}
+
+	float distanceToBox(glm::vec3 const& point, glm::vec3 const& min_corner, glm::vec3 const& max_corner)
+	{
+		return glm::length(glm::max(glm::max(min_corner - point, point - max_corner), glm::vec3(0.0f)));
+	}
+}
+
+constexpr unsigned int Terrain::max_lods_nb;
+
+Terrain::~Terrain()
+{
+	glDeleteBuffers(1, &_ibo);
+	_ibo = 0u;
+
+	glDeleteBuffers(1, &_bo);
+	_bo = 0u;
+
+	glDeleteVertexArrays(1, &_vao);
+	_vao = 0u;
+}
+
+void
+Terrain::create(Settings const& settings)
+{
+	auto const start_time = std::chrono::high_resolution_clock::now();
+
+	auto const lods_nb = std::max(1u, std::min(settings.lods_nb, max_lods_nb));
+	auto const coarsest_step = 1u << (lods_nb - 1u);
+	if (settings.tiles_per_side == 0u || settings.tile_edges_nb == 0u || settings.tile_edges_nb % coarsest_step != 0u) {
+		LogError("Terrain tiles need a number of edges (%u) which is a multiple of %u; the terrain will not be created.",
+		         settings.tile_edges_nb, coarsest_step);
+		return;
+	}
+
+	_settings = settings;
+	_settings.lods_nb = lods_nb;
+
+	auto const tiles_per_side = settings.tiles_per_side;
+	auto const tile_edges_nb = settings.tile_edges_nb;
+	auto const tile_vertices_per_side = tile_edges_nb + 1u;
+	auto const tile_vertices_nb = tile_vertices_per_side * tile_vertices_per_side;
+	if (tile_vertices_nb > 0xffffu) {
+		LogError("Terrain tiles of %u edges need more vertices than 16-bit indices can address; the terrain will not be created.",
+		         tile_edges_nb);
+		return;
+	}
+	auto const edges_per_side = tiles_per_side * tile_edges_nb;
+	auto const delta = glm::vec2(settings.width, settings.height) / static_cast<float>(edges_per_side);
+	auto const start = -0.5f * glm::vec2(settings.width, settings.height);
+
+	//
+	// Vertices, tile after tile
+	//
+	auto const vertices_nb = static_cast<size_t>(tiles_per_side) * tiles_per_side * tile_vertices_nb;
+	std::vector<glm::vec3> vertices(vertices_nb);
+	std::vector<glm::vec3> texcoords(vertices_nb);
+	_tiles.resize(static_cast<size_t>(tiles_per_side) * tiles_per_side);
+	size_t index = 0u;
+	for (unsigned int tile_x = 0u; tile_x < tiles_per_side; ++tile_x) {
+		for (unsigned int tile_z = 0u; tile_z < tiles_per_side; ++tile_z) {
+			auto& tile = _tiles[tile_x * tiles_per_side + tile_z];
+			tile.base_vertex = static_cast<GLint>(index);
+			tile.min_corner = glm::vec3(std::numeric_limits<float>::max());
+			tile.max_corner = glm::vec3(std::numeric_limits<float>::lowest());
+			for (unsigned int i = 0u; i < tile_vertices_per_side; ++i) {
+				for (unsigned int j = 0u; j < tile_vertices_per_side; ++j) {
+					auto const global_i = tile_x * tile_edges_nb + i;
+					auto const global_j = tile_z * tile_edges_nb + j;
+					auto const random = hashVertex(global_i, global_j, settings.seed);
+					vertices[index] = glm::vec3(start.x + static_cast<float>(global_i) * delta.x,
+					                            (2.0f * random - 1.0f) * settings.max_random,
+					                            start.y + static_cast<float>(global_j) * delta.y);
+					texcoords[index] = glm::vec3(static_cast<float>(global_i) / static_cast<float>(edges_per_side),
+					                             static_cast<float>(global_j) / static_cast<float>(edges_per_side),
+					                             0.0f);
+					tile.min_corner = glm::min(tile.min_corner, vertices[index]);
+					tile.max_corner = glm::max(tile.max_corner, vertices[index]);
+					++index;
+				}
+			}
+		}
+	}
+
+	//
+	// Indices, for each LOD and each set of edges to stitch
+	//
+	std::vector<GLushort> indices;
+	_index_ranges.assign(lods_nb, {});
+	for (unsigned int lod = 0u; lod < lods_nb; ++lod) {
+		auto const step = 1u << lod;
+		for (unsigned int mask = 0u; mask < 16u; ++mask) {
+			// Along a stitched edge, every other vertex is collapsed onto
+			// the previous one, so that the edge only goes through the
+			// vertices of the coarser neighbour.
+			auto const get_index = [mask, step, tile_vertices_per_side, tile_edges_nb](unsigned int i, unsigned int j){
+				if (((mask & 0x1u) != 0u && i == 0u) || ((mask & 0x2u) != 0u && i == tile_edges_nb))
+					j -= j % (2u * step);
+				if (((mask & 0x4u) != 0u && j == 0u) || ((mask & 0x8u) != 0u && j == tile_edges_nb))
+					i -= i % (2u * step);
+				return static_cast<GLuint>(i * tile_vertices_per_side + j);
+			};
+
+			std::vector<GLuint> range;
+			auto const add_triangle = [&range](GLuint const a, GLuint const b, GLuint const c){
+				if (a == b || b == c || c == a)
+					return;
+				range.insert(range.end(), { a, b, c });
+			};
+			for (unsigned int i = 0u; i < tile_edges_nb; i += step) {
+				for (unsigned int j = 0u; j < tile_edges_nb; j += step) {
+					auto const v00 = get_index(i, j);
+					auto const v01 = get_index(i, j + step);
+					auto const v10 = get_index(i + step, j);
+					auto const v11 = get_index(i + step, j + step);
+					add_triangle(v00, v01, v11);
+					add_triangle(v00, v11, v10);
+				}
+			}
+			MeshOptimizer::OptimizeVertexCache(range, tile_vertices_nb);
+
+			auto& index_range = _index_ranges[lod][mask];
+			index_range.offset = indices.size() * sizeof(GLushort);
+			index_range.count = static_cast<GLsizei>(range.size());
+			for (auto const vertex : range)
+				indices.push_back(static_cast<GLushort>(vertex));
+		}
+	}
+
+	//
+	// Upload
+	//
+	if (_vao == 0u)
+		glGenVertexArrays(1, &_vao);
+	assert(_vao != 0u);
+	glBindVertexArray(_vao);
+
+	bonobo::vertex_attributes_view attributes;
+	attributes.vertices_nb = vertices_nb;
+	attributes.vertices = vertices.data();
+	attributes.texcoords = texcoords.data();
+	bonobo::vertex_layout layout;
+	auto const data = bonobo::packVertices(bonobo::vertex_format_t::quantized, attributes, layout);
+
+	if (_bo == 0u)
+		glGenBuffers(1, &_bo);
+	assert(_bo != 0u);
+	glBindBuffer(GL_ARRAY_BUFFER, _bo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.size()), reinterpret_cast<GLvoid const*>(data.data()), GL_STATIC_DRAW);
+	bonobo::setupVertexAttributes(layout);
+
+	if (_ibo == 0u)
+		glGenBuffers(1, &_ibo);
+	assert(_ibo != 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(GLushort)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
+
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+
+	utils::opengl::debug::nameObject(GL_VERTEX_ARRAY, _vao, "Terrain VAO");
+	utils::opengl::debug::nameObject(GL_BUFFER, _bo, "Terrain VBO");
+	utils::opengl::debug::nameObject(GL_BUFFER, _ibo, "Terrain IBO");
+
+	_lods.assign(_tiles.size(), 0u);
+	_are_visible.assign(_tiles.size(), false);
+	_draws.clear();
+	_stats = Stats();
+	_stats.tiles_nb = _tiles.size();
+	_stats.vertices_nb = vertices_nb;
+
+	auto const end_time = std::chrono::high_resolution_clock::now();
+	LogInfo("Terrain of %u×%u tiles with %u LODs (%zu vertices, %.1f MiB of vertex data and %.1f MiB of indices) created in %.3f ms",
+	        tiles_per_side, tiles_per_side, lods_nb, vertices_nb,
+	        static_cast<float>(data.size()) / (1024.0f * 1024.0f),
+	        static_cast<float>(indices.size() * sizeof(GLushort)) / (1024.0f * 1024.0f),
+	        std::chrono::duration<float, std::milli>(end_time - start_time).count());
+}
+
+void
+Terrain::update(glm::mat4 const& view_projection, glm::vec3 const& camera_position)
+{
+	_draws.clear();
+	if (_vao == 0u)
+		return;
+
+	auto const world = _transform.GetMatrix();
+	// Tiles are tested against the frustum planes in model-space.
+	Frustum const frustum(view_projection * world);
+	auto const local_camera_position = glm::vec3(glm::inverse(world) * glm::vec4(camera_position, 1.0f));
+	auto const tiles_per_side = _settings.tiles_per_side;
+	auto const coarsest_lod = _settings.lods_nb - 1u;
+
+	// Select the LOD of every tile, visible or not, as visible tiles need
+	// to know the LOD of their neighbours.
+	for (size_t t = 0u; t < _tiles.size(); ++t) {
+		auto const& tile = _tiles[t];
+		_are_visible[t] = frustum.intersects_box(tile.min_corner, tile.max_corner);
+		auto const distance = distanceToBox(local_camera_position, tile.min_corner, tile.max_corner);
+		auto const lod = distance < _settings.lod_distance ? 0.0f : std::floor(std::log2(distance / _settings.lod_distance)) + 1.0f;
+		_lods[t] = static_cast<unsigned int>(std::min(lod, static_cast<float>(coarsest_lod)));
+	}
+
+	// Neighbours may only differ by one LOD, for stitching to work.
+	auto const for_each_neighbour = [tiles_per_side](size_t const t, auto const& f){
+		auto const tile_x = static_cast<unsigned int>(t / tiles_per_side);
+		auto const tile_z = static_cast<unsigned int>(t % tiles_per_side);
+		if (tile_x > 0u)
+			f(t - tiles_per_side, 0x1u);
+		if (tile_x + 1u < tiles_per_side)
+			f(t + tiles_per_side, 0x2u);
+		if (tile_z > 0u)
+			f(t - 1u, 0x4u);
+		if (tile_z + 1u < tiles_per_side)
+			f(t + 1u, 0x8u);
+	};
+	for (bool has_changed = true; has_changed;) {
+		has_changed = false;
+		for (size_t t = 0u; t < _tiles.size(); ++t) {
+			for_each_neighbour(t, [this, t, &has_changed](size_t const n, unsigned int /*edge*/){
+				if (_lods[t] > _lods[n] + 1u) {
+					_lods[t] = _lods[n] + 1u;
+					has_changed = true;
+				}
+			});
+		}
+	}
+
+	auto const tile_edges_nb = _settings.tile_edges_nb;
+	_stats.tiles_drawn_nb = 0u;
+	_stats.tiles_per_lod_nb.fill(0u);
+	_stats.vertices_submitted_nb = 0u;
+	_stats.triangles_submitted_nb = 0u;
+
+	for (size_t t = 0u; t < _tiles.size(); ++t) {
+		if (!_are_visible[t])
+			continue;
+
+		auto const lod = _lods[t];
+		unsigned int mask = 0u;
+		for_each_neighbour(t, [this, lod, &mask](size_t const n, unsigned int const edge){
+			if (_lods[n] > lod)
+				mask |= edge;
+		});
+
+		auto const& range = _index_ranges[lod][mask];
+		_draws.push_back({ range, _tiles[t].base_vertex });
+
+		auto const lod_vertices_per_side = static_cast<size_t>(tile_edges_nb >> lod) + 1u;
+		++_stats.tiles_drawn_nb;
+		++_stats.tiles_per_lod_nb[lod];
+		_stats.vertices_submitted_nb += lod_vertices_per_side * lod_vertices_per_side;
+		_stats.triangles_submitted_nb += static_cast<size_t>(range.count) / 3u;
+	}
+}
+
+void
+Terrain::render(glm::mat4 const& view_projection) const
+{
+	if (_vao == 0u || _program == nullptr || *_program == 0u)
+		return;
+
+	utils::opengl::debug::beginDebugGroup(_name);
+
+	auto const program = *_program;
+	glUseProgram(program);
+
+	_set_uniforms(program);
+
+	auto const world = _transform.GetMatrix();
+	auto const normal_model_to_world = glm::transpose(glm::inverse(world));
+	glUniformMatrix4fv(_vertex_model_to_world_location(program), 1, GL_FALSE, glm::value_ptr(world));
+	glUniformMatrix4fv(_normal_model_to_world_location(program), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+	glUniformMatrix4fv(_vertex_world_to_clip_location(program), 1, GL_FALSE, glm::value_ptr(view_projection));
+	glUniform1i(_has_quantized_vertices_location(program), 1);
+
+	_textures.bind(program);
+
+	glBindVertexArray(_vao);
+	for (auto const& draw : _draws)
+		glDrawElementsBaseVertex(GL_TRIANGLES, draw.range.count, GL_UNSIGNED_SHORT,
+		                         reinterpret_cast<GLvoid const*>(draw.range.offset), draw.base_vertex);
+	glBindVertexArray(0u);
+
+	_textures.unbind(program);
+
+	glUseProgram(0u);
+
+	utils::opengl::debug::endDebugGroup();
+}
+
+void
+Terrain::set_program(GLuint const* const program, std::function<void (GLuint)> const& set_uniforms)
+{
+	if (program == nullptr) {
+		LogError("Program can not be a null pointer; this operation will be discarded.");
+		return;
+	}
+
+	_program = program;
+	_set_uniforms = set_uniforms;
+}
+
+void
+Terrain::set_name(std::string const& name)
+{
+	_name = std::string("Render ") + name;
+}
+
+void
+Terrain::add_texture(std::string const& name, GLuint tex_id, GLenum type)
+{
+	_textures.add(name, tex_id, type);
+}
+
+Terrain::Stats const&
+Terrain::get_stats() const
+{
+	return _stats;
+}
+
+TRSTransformf const&
+Terrain::get_transform() const
+{
+	return _transform;
+}
+
+TRSTransformf&
+Terrain::get_transform()
+{
+	return _transform;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "TRSTransform.h"
+#include "TextureBindings.hpp"
+#include "UniformCache.hpp"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+//! \brief Randomly displaced ground, split into square tiles which are
+//!        frustum culled and drawn at a level of detail (LOD) depending
+//!        on their distance to the camera.
+//!
+//! All tiles live in a single vertex buffer, at full resolution; each LOD
+//! only uses every 2^lod-th vertex along both axes, through index
+//! buffers shared by all tiles. Neighbouring tiles are kept within one
+//! LOD of each other, and the vertices of a tile lying on an edge shared
+//! with a coarser tile are collapsed onto the coarser tile's vertices, so
+//! that no cracks appear between tiles.
+//!
+//! Heights are derived from a hash of the global grid coordinates of each
+//! vertex and a seed, so the same seed always gives the same ground, and
+//! tiles agree on the heights of the vertices they share.
+//!
+//! Vertices only carry positions and texture coordinates, stored with
+//! `bonobo::vertex_format_t::quantized`.
+class Terrain
+{
+public:
+	//! \brief Maximum number of levels of detail.
+	static constexpr unsigned int max_lods_nb = 6u;
+
+	struct Settings {
+		float width{ 400.0f };              //!< extent along the x-axis
+		float height{ 400.0f };             //!< extent along the z-axis
+		unsigned int tiles_per_side{ 16u };
+		//! \brief Edges along each side of a tile at the finest LOD; it has
+		//!        to be a multiple of 2^(lods_nb - 1).
+		unsigned int tile_edges_nb{ 96u };
+		unsigned int lods_nb{ 5u };         //!< at most `max_lods_nb`
+		float max_random{ 0.0f };           //!< heights are in [-max_random, max_random]
+		//! \brief Tiles closer than this distance, in model space, use the
+		//!        finest LOD; each doubling of the distance uses the next
+		//!        coarser one.
+		float lod_distance{ 20.0f };
+		std::uint32_t seed{ 0u };
+	};
+
+	struct Stats {
+		size_t tiles_nb{ 0u };
+		size_t tiles_drawn_nb{ 0u };
+		std::array<size_t, max_lods_nb> tiles_per_lod_nb{};
+		size_t vertices_submitted_nb{ 0u };  //!< vertices used by the drawn tiles
+		size_t triangles_submitted_nb{ 0u };
+		size_t vertices_nb{ 0u };            //!< vertices of all tiles at the finest LOD
+	};
+
+	Terrain() = default;
+	~Terrain();
+
+	Terrain(Terrain const&) = delete;
+	Terrain& operator=(Terrain const&) = delete;
+
+	//! \brief Generate the vertices of all tiles, and the index buffers of
+	//!        all LODs.
+	//!
+	//! @param [in] settings how to build the terrain
+	void create(Settings const& settings);
+
+	//! \brief Select the tiles intersecting the view frustum, and the LOD
+	//!        of each of them; to be called whenever the view or the
+	//!        transform of the terrain changes, before `render()`.
+	//!
+	//! @param [in] view_projection Matrix transforming from world-space to clip-space
+	//! @param [in] camera_position position of the camera in world-space,
+	//!             used to select the LOD of each tile
+	void update(glm::mat4 const& view_projection, glm::vec3 const& camera_position);
+
+	//! \brief Render the tiles selected by the latest call to `update()`.
+	//!
+	//! @param [in] view_projection Matrix transforming from world-space to clip-space
+	void render(glm::mat4 const& view_projection) const;
+
+	//! \brief Set the program used by all tiles.
+	//!
+	//! @param [in] program pointer to the program OpenGL shader program to
+	//!             use; the pointer should not be null.
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms
+	void set_program(GLuint const* const program,
+	                 std::function<void (GLuint)> const& set_uniforms = [](GLuint /*programID*/){});
+
+	//! \brief Set the name of this terrain, used for debug groups.
+	//!
+	//! @param [in] name the name used when creating the debug group during
+	//!             rendering; it will automatically be prefixed by "Render ".
+	void set_name(std::string const& name);
+
+	//! \brief Add a texture shared by all tiles.
+	//!
+	//! @param [in] name the variable name used by the attached OpenGL
+	//!                  shader program
+	//! @param [in] tex_id the name of an OpenGL texture
+	//! @param [in] type the type of texture, i.e. GL_TEXTURE_2D,
+	//!                  GL_TEXTURE_CUBE_MAP, etc.
+	void add_texture(std::string const& name, GLuint tex_id, GLenum type);
+
+	//! \brief Return the statistics of the latest call to `update()`.
+	Stats const& get_stats() const;
+
+	//! \brief Return the model-to-world transformation of the terrain.
+	TRSTransformf const& get_transform() const;
+	TRSTransformf& get_transform();
+
+private:
+	//! \brief Part of the index buffer used to draw a tile at a given LOD,
+	//!        with a given set of edges stitched to coarser neighbours.
+	struct IndexRange {
+		size_t offset{ 0u }; //!< in bytes
+		GLsizei count{ 0 };
+	};
+
+	struct Tile {
+		glm::vec3 min_corner;
+		glm::vec3 max_corner;
+		GLint base_vertex;
+	};
+
+	// Geometry data
+	GLuint _vao{ 0u };
+	GLuint _bo{ 0u };
+	GLuint _ibo{ 0u };
+	Settings _settings;
+	std::vector<Tile> _tiles;
+	//! \brief Indexed by LOD, then by a mask of the edges to stitch: -x,
+	//!        +x, -z and +z, from the least significant bit.
+	std::vector<std::array<IndexRange, 16u>> _index_ranges;
+
+	struct Draw {
+		IndexRange range;
+		GLint base_vertex;
+	};
+
+	// Per-frame data, written by `update()`
+	std::vector<unsigned int> _lods;
+	std::vector<bool> _are_visible;
+	std::vector<Draw> _draws;
+	Stats _stats;
+
+	// Program data
+	GLuint const* _program{ nullptr };
+	std::function<void (GLuint)> _set_uniforms;
+	UniformLocation _vertex_model_to_world_location{ "vertex_model_to_world" };
+	UniformLocation _normal_model_to_world_location{ "normal_model_to_world" };
+	UniformLocation _vertex_world_to_clip_location{ "vertex_world_to_clip" };
+	UniformLocation _has_quantized_vertices_location{ "has_quantized_vertices" };
+
+	// Textures data
+	TextureBindings _textures;
+
+	// Transformation data
+	TRSTransformf _transform;
+
+	// Debug data
+	std::string _name{"Render terrain"};
+};
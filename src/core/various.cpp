@@ -2,6 +2,7 @@
 
 #include "core/Log.h"
 
+#include <array>
 #include <fstream>
 #include <iostream>
 #include <limits>
@@ -88,3 +89,33 @@ utils::slurp_file(std::string const& path)
 
   return std::string(content.get());
 }
+
+std::uint64_t
+utils::hash_file(std::string const& path)
+{
+  std::ifstream file(utils::widen(path), std::ios::binary);
+  if (!file.is_open())
+    return 0u;
+
+  std::uint64_t hash = 14695981039346656037ull;
+  std::array<char, 64u * 1024u> buffer;
+  while (file) {
+    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    hash = utils::hash_data(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+  }
+
+  // 0 is reserved for files which could not be read.
+  return hash != 0u ? hash : 1u;
+}
+
+std::uint64_t
+utils::hash_data(void const* data, size_t size, std::uint64_t hash)
+{
+  auto const bytes = static_cast<std::uint8_t const*>(data);
+  for (size_t i = 0u; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
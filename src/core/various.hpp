@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include <cstdint>
+
 
 namespace utils
 {
@@ -17,4 +19,20 @@ inline std::string const& widen(std::string const& utf8) { return utf8; }
 
 std::string slurp_file(std::string const& path);
 
+//! \brief Compute a 64-bit FNV-1a hash of the content of a file.
+//!
+//! @return the hash, or 0 if the file could not be read
+std::uint64_t hash_file(std::string const& path);
+
+//! \brief Continue a 64-bit FNV-1a hash over a range of bytes.
+//!
+//! Hashing several ranges one after the other, feeding the result of
+//! each call to the next, gives the same result as hashing them at once.
+//!
+//! @param [in] data the bytes to hash
+//! @param [in] size the number of bytes to hash
+//! @param [in] hash the hash of the preceding bytes, if any
+//! @return the updated hash
+std::uint64_t hash_data(void const* data, size_t size, std::uint64_t hash = 14695981039346656037ull);
+
 } // end of namespace
@@ -0,0 +1,79 @@
+#include "files.hpp"
+
+#include "core/various.hpp"
+
+#if defined(_WIN32)
+#	include <Windows.h>
+#else
+#	include <dirent.h>
+#	include <sys/stat.h>
+#endif
+
+bool
+tools::is_directory(std::string const& path)
+{
+#if defined(_WIN32)
+	auto const attributes = ::GetFileAttributesW(utils::widen(path).c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+	struct stat path_stat;
+	return ::stat(path.c_str(), &path_stat) == 0 && S_ISDIR(path_stat.st_mode);
+#endif
+}
+
+void
+tools::list_files(std::string const& folder, std::vector<std::string>& files)
+{
+	std::vector<std::string> entries;
+#if defined(_WIN32)
+	WIN32_FIND_DATAA entry;
+	HANDLE const search = ::FindFirstFileA((folder + "/*").c_str(), &entry);
+	if (search == INVALID_HANDLE_VALUE)
+		return;
+	do {
+		entries.emplace_back(entry.cFileName);
+	} while (::FindNextFileA(search, &entry));
+	::FindClose(search);
+#else
+	DIR* const directory = ::opendir(folder.c_str());
+	if (directory == nullptr)
+		return;
+	while (auto const entry = ::readdir(directory))
+		entries.emplace_back(entry->d_name);
+	::closedir(directory);
+#endif
+
+	for (auto const& entry : entries) {
+		if (entry == "." || entry == "..")
+			continue;
+
+		auto const path = folder + "/" + entry;
+		if (is_directory(path))
+			list_files(path, files);
+		else
+			files.push_back(path);
+	}
+}
+
+std::vector<std::string>
+tools::expand_inputs(std::vector<std::string> const& inputs)
+{
+	std::vector<std::string> files;
+	for (auto const& input : inputs) {
+		if (is_directory(input))
+			list_files(input, files);
+		else
+			files.push_back(input);
+	}
+	return files;
+}
+
+std::string
+tools::get_extension(std::string const& path)
+{
+	auto const dot_position = path.rfind('.');
+	auto const slash_position = path.find_last_of("/\\");
+	if (dot_position == std::string::npos || (slash_position != std::string::npos && dot_position < slash_position))
+		return "";
+	return path.substr(dot_position);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//! \brief Helpers shared by the command-line tools.
+namespace tools
+{
+	//! \brief Check whether a path exists and is a folder.
+	bool is_directory(std::string const& path);
+
+	//! \brief Recursively list all files found in a folder.
+	//!
+	//! @param [in] folder the folder to search
+	//! @param [out] files where the paths of the files found are appended
+	void list_files(std::string const& folder, std::vector<std::string>& files);
+
+	//! \brief Expand a list of files and folders given on the command line
+	//!        into a list of files.
+	std::vector<std::string> expand_inputs(std::vector<std::string> const& inputs);
+
+	//! \brief Retrieve the extension of a path, including the dot, or an
+	//!        empty string if it has none.
+	std::string get_extension(std::string const& path);
+}
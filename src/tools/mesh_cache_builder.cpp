@@ -0,0 +1,85 @@
+// Builds the mesh caches used by `bonobo::loadObjects()` ahead of time, so
+// that even the first run of an assignment can skip Assimp.
+//
+// Usage: MeshCacheBuilder [--force] [file or folder]…
+//
+// Folders are searched recursively for files Assimp can import; without
+// any argument, the whole resources folder is processed. Caches which are
+// already up to date are left untouched, unless `--force` is given.
+
+#include "files.hpp"
+
+#include "config.hpp"
+#include "core/MeshCache.hpp"
+
+#include <assimp/Importer.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+	bool force = false;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; ++i) {
+		std::string const argument(argv[i]);
+		if (argument == "--force")
+			force = true;
+		else
+			inputs.push_back(argument);
+	}
+	if (inputs.empty())
+		inputs.push_back(config::resources_path(""));
+
+	auto const files = tools::expand_inputs(inputs);
+
+	Assimp::Importer importer;
+	size_t built_nb = 0u;
+	size_t up_to_date_nb = 0u;
+	size_t failed_nb = 0u;
+	for (auto const& file : files) {
+		auto const extension = tools::get_extension(file);
+		if (extension.empty() || extension == ".meshcache" || !importer.IsExtensionSupported(extension))
+			continue;
+
+		auto const cache_path = MeshCache::GetPath(file);
+		std::string error;
+		if (!force) {
+			MeshCache::Scene cached_scene;
+			if (MeshCache::Read(cache_path, file, cached_scene, error)) {
+				std::printf("Up to date: %s\n", cache_path.c_str());
+				++up_to_date_nb;
+				continue;
+			}
+		}
+
+		auto const start_time = std::chrono::high_resolution_clock::now();
+
+		MeshCache::Scene scene;
+		if (!MeshCache::Build(file, scene, error) || !MeshCache::Write(cache_path, scene, error)) {
+			std::fprintf(stderr, "Failed: %s\n", error.c_str());
+			++failed_nb;
+			continue;
+		}
+
+		size_t vertices_nb = 0u;
+		for (auto const& mesh : scene.meshes) {
+			if (!mesh->error.empty())
+				std::fprintf(stderr, "Skipped: %s\n", mesh->error.c_str());
+			else
+				vertices_nb += mesh->vertices_nb;
+		}
+
+		auto const end_time = std::chrono::high_resolution_clock::now();
+		std::printf("Built: %s (%zu meshes, %zu vertices, %zu textures) in %.3f s\n",
+		            cache_path.c_str(), scene.meshes.size(), vertices_nb, scene.texture_paths.size(),
+		            std::chrono::duration<float>(end_time - start_time).count());
+		++built_nb;
+	}
+
+	std::printf("%zu caches built, %zu up to date, %zu failed.\n", built_nb, up_to_date_nb, failed_nb);
+
+	return failed_nb == 0u ? 0 : 1;
+}
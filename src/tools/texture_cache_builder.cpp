@@ -0,0 +1,179 @@
+// Builds the compressed texture caches used by `bonobo::loadTexture2D()`
+// and `bonobo::loadObjects()` ahead of time, and reports how much VRAM they
+// save compared to uploading the decoded images as RGBA8.
+//
+// Usage: TextureCacheBuilder [--force] [file or folder]…
+//
+// Folders are searched recursively for images stb can decode; without any
+// argument, the planets and Sponza textures are processed. Caches which
+// are already up to date are left untouched, unless `--force` is given.
+//
+// Images which the scene files among the inputs use as normal maps get
+// the normal map cache the scene loader reads (see
+// `TextureCache::Usage::normal_map`); all others get a colour cache.
+// Normal maps which are only loaded as such by the assignments themselves
+// still get their cache built at run time.
+
+#include "files.hpp"
+
+#include "config.hpp"
+#include "core/MeshCache.hpp"
+#include "core/TextureCache.hpp"
+#include "core/various.hpp"
+
+#include <assimp/Importer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+	bool isImage(std::string const& path)
+	{
+		auto extension = tools::get_extension(path);
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+		               [](char c){ return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+		static std::array<char const*, 6> const extensions{ { ".bmp", ".jpeg", ".jpg", ".png", ".tga", ".psd" } };
+		return std::find(extensions.begin(), extensions.end(), extension) != extensions.end();
+	}
+
+	float toMiB(size_t const size)
+	{
+		return static_cast<float>(size) / (1024.0f * 1024.0f);
+	}
+
+	// Scene files may separate folders with backslashes.
+	std::string normalisePath(std::string path)
+	{
+		std::replace(path.begin(), path.end(), '\\', '/');
+		return path;
+	}
+
+	// Add the paths of the textures |scene_path| binds to normal maps,
+	// spelled the way the scene loader does, to |normal_maps|; the
+	// materials are taken from its mesh cache when up to date.
+	void collectNormalMaps(std::string const& scene_path, Assimp::Importer& importer,
+	                       std::unordered_set<std::string>& normal_maps)
+	{
+		MeshCache::Scene scene;
+		std::string error;
+		if (!MeshCache::Read(MeshCache::GetPath(scene_path), scene_path, scene, error)) {
+			scene = MeshCache::Scene();
+			auto const assimp_scene = MeshCache::Import(importer, scene_path, scene.dependencies, error);
+			if (assimp_scene == nullptr) {
+				std::fprintf(stderr, "Skipped: %s\n", error.c_str());
+				return;
+			}
+			std::vector<std::string> errors;
+			std::vector<std::string> warnings;
+			MeshCache::CollectMaterials(*assimp_scene, scene, errors, warnings);
+		}
+
+		auto const separator = scene_path.find_last_of("/\\");
+		auto const folder = (separator != std::string::npos ? scene_path.substr(0u, separator) : ".") + "/";
+		for (auto const& material_textures : scene.materials_textures) {
+			for (auto const& texture : material_textures) {
+				if (texture.binding_name == "normals_texture")
+					normal_maps.insert(normalisePath(folder + scene.texture_paths[texture.texture_index]));
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool force = false;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; ++i) {
+		std::string const argument(argv[i]);
+		if (argument == "--force")
+			force = true;
+		else
+			inputs.push_back(argument);
+	}
+	if (inputs.empty()) {
+		inputs.push_back(config::resources_path("planets"));
+		inputs.push_back(config::resources_path("sponza"));
+	}
+
+	// Normal maps are looked for in all inputs first, as a scene and its
+	// textures need not be given together.
+	Assimp::Importer importer;
+	std::unordered_set<std::string> normal_maps;
+	for (auto const& file : tools::expand_inputs(inputs)) {
+		auto const extension = tools::get_extension(file);
+		if (!extension.empty() && extension != ".meshcache" && !isImage(file) && importer.IsExtensionSupported(extension))
+			collectNormalMaps(file, importer, normal_maps);
+	}
+
+	size_t built_nb = 0u;
+	size_t up_to_date_nb = 0u;
+	size_t failed_nb = 0u;
+	size_t total_uncompressed_size = 0u;
+	size_t total_compressed_size = 0u;
+	std::vector<std::string> report;
+	for (auto const& input : inputs) {
+		size_t uncompressed_size = 0u;
+		size_t compressed_size = 0u;
+		size_t textures_nb = 0u;
+		for (auto const& file : tools::expand_inputs({ input })) {
+			if (!isImage(file))
+				continue;
+
+			auto const usage = normal_maps.count(normalisePath(file)) != 0u ? TextureCache::Usage::normal_map
+			                                                              : TextureCache::Usage::colour;
+			auto const cache_path = TextureCache::GetPath(file, usage);
+			auto const source_hash = utils::hash_file(file);
+			std::string error;
+			TextureCache::Texture texture;
+			if (!force && TextureCache::Read(cache_path, source_hash, usage, texture, error)) {
+				std::printf("Up to date: %s\n", cache_path.c_str());
+				++up_to_date_nb;
+			} else {
+				auto const start_time = std::chrono::high_resolution_clock::now();
+
+				if (source_hash == 0u || !TextureCache::Build(file, usage, texture, error) || !TextureCache::Write(cache_path, texture, source_hash, error)) {
+					std::fprintf(stderr, "Failed: %s\n", source_hash == 0u ? ("Failed to read \"" + file + "\"").c_str() : error.c_str());
+					++failed_nb;
+					continue;
+				}
+
+				auto const end_time = std::chrono::high_resolution_clock::now();
+				std::printf("Built: %s (%ux%u, %zu levels) in %.3f s\n",
+				            cache_path.c_str(), texture.width, texture.height, texture.levels.size(),
+				            std::chrono::duration<float>(end_time - start_time).count());
+				++built_nb;
+			}
+
+			uncompressed_size += TextureCache::GetUncompressedSize(texture.width, texture.height);
+			compressed_size += texture.GetSize();
+			++textures_nb;
+		}
+
+		char line[512];
+		std::snprintf(line, sizeof(line), "%s: %zu textures, %.1f MiB as RGBA8, %.1f MiB compressed, %.1f MiB saved",
+		              input.c_str(), textures_nb, toMiB(uncompressed_size), toMiB(compressed_size),
+		              toMiB(uncompressed_size - compressed_size));
+		report.emplace_back(line);
+		total_uncompressed_size += uncompressed_size;
+		total_compressed_size += compressed_size;
+	}
+
+	std::printf("%zu caches built, %zu up to date, %zu failed.\n\n", built_nb, up_to_date_nb, failed_nb);
+
+	std::printf("VRAM used, including the full mipmap chains:\n");
+	for (auto const& line : report)
+		std::printf("  %s\n", line.c_str());
+	std::printf("  Total: %.1f MiB as RGBA8, %.1f MiB compressed, %.1f MiB saved\n",
+	            toMiB(total_uncompressed_size), toMiB(total_compressed_size),
+	            toMiB(total_uncompressed_size - total_compressed_size));
+
+	return failed_nb == 0u ? 0 : 1;
+}